@@ -0,0 +1,104 @@
+/*
+ * battery.c
+ *
+ *  Supply voltage monitor. See battery.h.
+ */
+
+#include <battery.h>
+
+#include <msp430.h>
+
+#if BATTERY
+
+// VCC/2 against VREF+ = 1.5 V, 64 ADC10OSC clocks (~13 us) of sampling.
+#define ADC_ON (SREF_1 + ADC10SHT_3 + REFON + ADC10ON)
+
+unsigned char battery_level;
+static unsigned int filtered;			// reading << BATTERY_FILTER
+static unsigned char count;				// samples into the interval
+static volatile unsigned int reading;	// from the ISR, 0 if none
+
+static char levelFor(unsigned int v);
+
+void batteryInit(void){
+	unsigned int v;
+
+	ADC10CTL1 = INCH_11 + ADC10SSEL_0 + ADC10DIV_0;
+	ADC10CTL0 = ADC_ON;
+	__delay_cycles(30);					// reference settling
+	ADC10CTL0 |= ENC + ADC10SC;
+	while (!(ADC10CTL0 & ADC10IFG));
+	v = ADC10MEM;
+	ADC10CTL0 &= ~ENC;
+	ADC10CTL0 = 0;
+
+	filtered = v << BATTERY_FILTER;
+	battery_level = levelFor(v);
+}
+
+/*
+ * batteryTick
+ * Flow:
+ * 1. A reading came in: filter it and update the level.
+ * 2. Count the sample. One sample before the reading, with the LEDs
+ *    off, switch the reference on so it has settled (it needs ~30 us)
+ *    by the start.
+ * 3. At the end of the interval, start the conversion, unless the LEDs
+ *    are on: then switch the reference off again and go back to the
+ *    sample before, so it is never on through a stop.
+ */
+char batteryTick(char leds_on){
+	char level = battery_level;
+
+	if (reading){
+		filtered += reading - (filtered >> BATTERY_FILTER);
+		reading = 0;
+		battery_level = levelFor(filtered >> BATTERY_FILTER);
+	}
+
+	if (count < BATTERY_INTERVAL - 2){
+		count++;
+	} else if (leds_on){
+		ADC10CTL0 = 0;
+		count = BATTERY_INTERVAL - 2;
+	} else if (count == BATTERY_INTERVAL - 2){
+		ADC10CTL0 = ADC_ON;
+		count++;
+	} else {
+		ADC10CTL0 = ADC_ON + ADC10IE;
+		ADC10CTL0 |= ENC + ADC10SC;
+		count = 0;
+	}
+	return battery_level != level;
+}
+
+char batteryBlink(void){
+	return battery_level != BATTERY_OK
+			&& (count == 0 || (count == 2 && battery_level == BATTERY_CRITICAL));
+}
+
+static char levelFor(unsigned int v){
+	if (v < BATTERY_RAW(BATTERY_CRIT_MV)
+			|| (battery_level == BATTERY_CRITICAL && v < BATTERY_RAW(BATTERY_CRIT_MV + BATTERY_HYST_MV))){
+		return BATTERY_CRITICAL;
+	}
+	if (v < BATTERY_RAW(BATTERY_LOW_MV)
+			|| (battery_level != BATTERY_OK && v < BATTERY_RAW(BATTERY_LOW_MV + BATTERY_HYST_MV))){
+		return BATTERY_LOW;
+	}
+	return BATTERY_OK;
+}
+
+/*
+ * ADC10 ISR
+ * Stores the reading and powers the ADC and the reference down. Does not
+ * wake main(): the reading waits for the next sample.
+ */
+#pragma vector=ADC10_VECTOR
+__interrupt void ADC10(void){
+	reading = ADC10MEM;
+	ADC10CTL0 &= ~ENC;
+	ADC10CTL0 = 0;
+}
+
+#endif
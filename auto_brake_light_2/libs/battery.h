@@ -0,0 +1,83 @@
+/*
+ * battery.h
+ *
+ *  Supply voltage monitor and power governor.
+ *
+ *  Every BATTERY_INTERVAL samples the ADC10 measures VCC/2 against the
+ *  internal 1.5 V reference (so anything above 3.0 V reads as full). The
+ *  conversion is started from the sample loop and finishes while main()
+ *  sleeps; the ADC10 interrupt stores the result and switches the ADC and
+ *  reference off again, and the next batteryTick() filters it. Readings
+ *  are only started with the LEDs off, so the sag under the LED current
+ *  does not trip the governor.
+ *
+ *  The filtered voltage picks a level, with BATTERY_HYST_MV of hysteresis
+ *  on the way back up. main() applies it (the governor):
+ *
+ *    level      sample rate         brake LEDs  features      indication
+ *    OK         5 Hz                2           all           -
+ *    LOW        BATTERY_LOW_WAKE    2           no temp comp  1 blip per interval
+ *    CRITICAL   BATTERY_CRIT_WAKE   1           no ride log   2 blips per interval
+ *
+ *  The ride log stops at CRITICAL because flash programming needs
+ *  VCC >= 2.2 V. The detector filters count samples, so at the lower
+ *  rates they react more slowly; braking is still detected.
+ *
+ *  Uses ADC10_VECTOR.
+ */
+
+#ifndef BATTERY_H_
+#define BATTERY_H_
+
+#include <config.h>
+
+#ifndef BATTERY_INTERVAL
+#define BATTERY_INTERVAL 64		// samples between readings
+#endif
+#ifndef BATTERY_LOW_MV
+#define BATTERY_LOW_MV 2600
+#endif
+#ifndef BATTERY_CRIT_MV
+#define BATTERY_CRIT_MV 2300
+#endif
+#ifndef BATTERY_HYST_MV
+#define BATTERY_HYST_MV 100
+#endif
+// LP_WAKE_CTRL values (see mpu6050.h) for the LOW and CRITICAL levels.
+#ifndef BATTERY_LOW_WAKE
+#define BATTERY_LOW_WAKE 1		// 2.5 Hz
+#endif
+#ifndef BATTERY_CRIT_WAKE
+#define BATTERY_CRIT_WAKE 0		// 1.25 Hz
+#endif
+
+#define BATTERY_FILTER 2		// log2 of the readings averaged (exponential)
+
+// ADC10 reading of VCC/2 against 1.5 V, for a supply of mv millivolts.
+#define BATTERY_RAW(mv) ((unsigned int)((mv) * 1023L / 3000))
+
+#if BATTERY_INTERVAL < 4 || BATTERY_INTERVAL > 255
+#error BATTERY_INTERVAL must be 4 to 255 samples
+#endif
+
+#define BATTERY_OK 0
+#define BATTERY_LOW 1
+#define BATTERY_CRITICAL 2
+
+#if BATTERY
+extern unsigned char battery_level;
+
+// Takes a first reading, blocking (~50 us), and sets battery_level.
+void batteryInit(void);
+// Once per sample. Returns 1 if battery_level changed.
+char batteryTick(char leds_on);
+// Whether the low battery indication is due this sample.
+char batteryBlink(void);
+#else
+#define battery_level BATTERY_OK
+#define batteryInit()
+#define batteryTick(leds_on) 0
+#define batteryBlink() 0
+#endif
+
+#endif /* BATTERY_H_ */
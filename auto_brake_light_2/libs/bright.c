@@ -0,0 +1,130 @@
+/*
+ * bright.c
+ *
+ *  Brake light intensity. See bright.h.
+ */
+
+#include <bright.h>
+
+#include <msp430.h>
+
+#if BRIGHTNESS
+
+#if BRIGHT_LEVELS != 16
+#error duty_table has 16 entries
+#endif
+
+static const unsigned int duty_table[BRIGHT_LEVELS] = {
+	BRIGHT_DUTY(0), BRIGHT_DUTY(1), BRIGHT_DUTY(2), BRIGHT_DUTY(3),
+	BRIGHT_DUTY(4), BRIGHT_DUTY(5), BRIGHT_DUTY(6), BRIGHT_DUTY(7),
+	BRIGHT_DUTY(8), BRIGHT_DUTY(9), BRIGHT_DUTY(10), BRIGHT_DUTY(11),
+	BRIGHT_DUTY(12), BRIGHT_DUTY(13), BRIGHT_DUTY(14), BRIGHT_DUTY(15)
+};
+
+static char leds;				// pins being driven
+static unsigned int duty;		// on time, SMCLK ticks
+static char on;					// in the on part of the period
+static char flash;				// hard stop pattern instead of PWM
+static unsigned char ticks;		// flash: periods into the half flash
+
+static void start(unsigned int t);
+
+/*
+ * brightOn
+ * Flow:
+ * 1. Hard stop: start flashing, or keep an already running flash going
+ *    (restarting it every sample would break up the pattern).
+ * 2. Otherwise pick the step: (magnitude - threshold) >> BRIGHT_SHIFT,
+ *    limited to 'cap'. threshold is the one the detector switched on
+ *    at, so the first step starts where the light does on any road.
+ * 3. The PWM already runs that step on these pins: leave it be, for the
+ *    same reason.
+ * 4. Top step: plain on. Anything lower: PWM from the table.
+ */
+void brightOn(char pins, int z, int threshold, unsigned char cap){
+	unsigned int mag = z < 0 ? -(unsigned int)z : z;
+	unsigned char level = BRIGHT_LEVELS - 1;
+
+	if (mag >= BRIGHT_HARD){
+		if (!flash || pins != leds){
+			brightOff();
+			leds = pins;
+			flash = 1;
+			ticks = 0;
+			start(BRIGHT_PERIOD);
+		}
+		return;
+	}
+
+	if (mag <= (unsigned int)threshold){
+		level = 0;
+	} else if ((mag - threshold) >> BRIGHT_SHIFT < BRIGHT_LEVELS){
+		level = (mag - threshold) >> BRIGHT_SHIFT;
+	}
+	if (level > cap){
+		level = cap;
+	}
+
+	if (level != BRIGHT_LEVELS - 1 && !flash && brightBusy()
+			&& pins == leds && duty == duty_table[level]){
+		return;
+	}
+
+	brightOff();
+	leds = pins;
+	if (level == BRIGHT_LEVELS - 1){
+		P1OUT |= pins;
+	} else {
+		duty = duty_table[level];
+		start(duty);
+	}
+}
+
+void brightOff(void){
+	CCTL1 = 0;
+	flash = 0;
+	P1OUT &= ~leds;
+}
+
+char brightBusy(void){
+	return CCTL1 & CCIE;
+}
+
+static void start(unsigned int t){
+	P1OUT |= leds;
+	on = 1;
+	CCR1 = TAR + t;
+	CCTL1 = CCIE;		// also clears a stale CCIFG
+}
+
+/*
+ * Timer A1 ISR (CCR1 is the only source enabled)
+ * Flow:
+ * 1. Flash: every BRIGHT_FLASH periods, toggle the LEDs.
+ * 2. PWM: end of the on time, LEDs off until the end of the period;
+ *    end of the period, LEDs on for 'duty'.
+ * The next compare is set from TAR, not from CCR1: if the ISR was held
+ * off (flash writes, other ISRs) that stretches one period instead of
+ * waiting for the timer to wrap around.
+ */
+#pragma vector=TIMERA1_VECTOR
+__interrupt void TIMERA1(void){
+	CCTL1 &= ~CCIFG;
+	if (flash){
+		CCR1 = TAR + BRIGHT_PERIOD;
+		if (++ticks >= BRIGHT_FLASH){
+			ticks = 0;
+			P1OUT ^= leds;
+		}
+	} else if (on){
+		P1OUT &= ~leds;
+		CCR1 = TAR + (BRIGHT_PERIOD - duty);
+		on = 0;
+	} else {
+		P1OUT |= leds;
+		CCR1 = TAR + duty;
+		on = 1;
+	}
+}
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * bright.h
+ *
+ *  Brake light intensity: the harder the braking, the brighter the light,
+ *  and a flashing light for a hard stop.
+ *
+ *  The magnitude of the detector's smoothed, compensated z picks one of
+ *  BRIGHT_LEVELS steps, BRIGHT_SHIFT counts apart from the detection
+ *  threshold up. Each step is a duty cycle from a table built at compile
+ *  time (BRIGHT_DUTY): the steps are even in perceived brightness, from
+ *  BRIGHT_MIN/255 up to full, and the eye's response is approximated by
+ *  the mean of a square and a cube (close to gamma 2.4). Per sample that
+ *  is a subtract, a shift and a table read. From BRIGHT_HARD up, the
+ *  light flashes at full brightness instead, ~4 Hz.
+ *
+ *  LED2/LED4 (P1.4, P1.3) are not Timer_A output pins, so the CCR1
+ *  interrupt switches them. Timer_A must be running from SMCLK in
+ *  continuous mode, and SMCLK must stay on while brightBusy(): sleep in
+ *  LPM0 rather than LPM3. The top step is plain on, without the timer,
+ *  so a full brake light still lets main() sleep in LPM3.
+ *
+ *  Uses TIMERA1_VECTOR (CCR1).
+ */
+
+#ifndef BRIGHT_H_
+#define BRIGHT_H_
+
+#include <config.h>
+#include <detect.h>
+
+#define BRIGHT_PERIOD 4000		// SMCLK ticks, 250 Hz: no visible flicker
+#define BRIGHT_LEVELS 16
+#ifndef BRIGHT_SHIFT
+#define BRIGHT_SHIFT 9			// 512 counts per step: full at ~0.6 g (+-2 g range)
+#endif
+#ifndef BRIGHT_MIN
+#define BRIGHT_MIN 160			// perceived brightness of the first step, of 255 (~32% duty)
+#endif
+#ifndef BRIGHT_HARD
+#define BRIGHT_HARD 10000		// magnitude for the hard stop flash, ~0.6 g
+#endif
+#define BRIGHT_FLASH 31			// PWM periods per half flash, ~125 ms
+
+// Perceived brightness of step i, 0 to 255, and the duty for it.
+#define BRIGHT_L(i) (BRIGHT_MIN + (255L - BRIGHT_MIN) * (i) / (BRIGHT_LEVELS - 1))
+#define BRIGHT_LIN(l) (((l) * (l) * 255L + (l) * (l) * (l)) / (2L * 255 * 255))
+#define BRIGHT_DUTY(i) ((unsigned int)(BRIGHT_PERIOD * BRIGHT_LIN(BRIGHT_L(i)) / 255))
+
+#if BRIGHTNESS
+// Light 'pins' for a braking magnitude of z over 'threshold', at most
+// step 'cap'.
+void brightOn(char pins, int z, int threshold, unsigned char cap);
+void brightOff(void);
+char brightBusy(void);
+#else
+#define brightOn(pins, z, threshold, cap) (P1OUT |= (pins))
+#define brightOff()
+#define brightBusy() 0
+#endif
+
+#endif /* BRIGHT_H_ */
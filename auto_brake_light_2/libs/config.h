@@ -0,0 +1,87 @@
+/*
+ * config.h
+ *
+ *  Feature profiles.
+ *
+ *  Every optional stage has a switch here; a stage that is off is not
+ *  compiled at all (its .c file and every call to it are under the
+ *  switch), so it costs no flash, RAM or cycles. CONFIG_PROFILE picks a
+ *  set of switches, and any switch given on the command line wins over
+ *  the profile:
+ *
+ *    -DCONFIG_PROFILE=PROFILE_MINIMAL -DBATTERY=1
+ *
+ *    profile   battery brightness temp_comp corner noise bump ridelog telemetry fifo
+ *    MINIMAL   -       -          -         -      -     1    -       -         -
+ *    STANDARD  -       -          -         -      -     1    -       -         -
+ *    LOGGER    -       -          -         -      -     1    x       -         -
+ *    DEBUG     -       -          -         -      -     1    -       x         -
+ *    FIFO      -       -          -         -      -     1    -       -         x
+ *    FULL      x       x          x         x      x     3    -       -         -
+ *
+ *  bump is BUMP_WINDOW, the length of the bump median (1 is off). At 3
+ *  it is ~110 bytes of flash, more than MINIMAL has left, so it is off
+ *  on the MCU for now.
+ *  STANDARD is the default and the build that goes on the bike, and
+ *  LOGGER, DEBUG and FIFO are STANDARD plus one feature. A stage joins
+ *  STANDARD only once tools/footprint.sh shows it fitting: 2 KB of
+ *  flash and 128 bytes of RAM with the stack. None of them has yet, so
+ *  STANDARD is MINIMAL for now. FULL has every stage and is for the
+ *  host tools (replay, tune, batch build it with
+ *  -DCONFIG_PROFILE=PROFILE_FULL to evaluate the stages); it does not
+ *  fit the G2231. The tuning values of each stage stay in its own
+ *  header. tools/footprint.sh builds every profile and checks flash,
+ *  RAM and stack against tools/footprint.txt.
+ */
+
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#define PROFILE_MINIMAL 1		// detector and LEDs only
+#define PROFILE_STANDARD 2
+#define PROFILE_LOGGER 3		// data capture rides
+#define PROFILE_DEBUG 4			// bench work with the telemetry decoder
+#define PROFILE_FIFO 5			// FIFO batches instead of an INT per sample
+#define PROFILE_FULL 6			// every stage, host tools and simulator only
+
+#ifndef CONFIG_PROFILE
+#define CONFIG_PROFILE PROFILE_STANDARD
+#endif
+
+#if CONFIG_PROFILE >= PROFILE_MINIMAL && CONFIG_PROFILE <= PROFILE_FIFO
+#define CFG_FULL 0
+#elif CONFIG_PROFILE == PROFILE_FULL
+#define CFG_FULL 1
+#else
+#error CONFIG_PROFILE must be one of the PROFILE_ values
+#endif
+
+#ifndef BATTERY
+#define BATTERY CFG_FULL		// supply monitor and power governor (battery.h)
+#endif
+#ifndef BRIGHTNESS
+#define BRIGHTNESS CFG_FULL		// PWM brightness and hard stop flash (bright.h); 0 is plain on/off
+#endif
+#ifndef TEMP_COMP
+#define TEMP_COMP CFG_FULL		// temperature compensation of the offsets (tempcomp.h)
+#endif
+#ifndef CORNER_REJECT
+#define CORNER_REJECT CFG_FULL	// lateral axis gates z in corners (detect.h)
+#endif
+#ifndef NOISE_ADAPT
+#define NOISE_ADAPT CFG_FULL	// threshold follows the road noise (detect.h)
+#endif
+#ifndef BUMP_WINDOW
+#define BUMP_WINDOW (CFG_FULL ? 3 : 1)	// samples in the bump median, 1 is off (detect.h)
+#endif
+#ifndef RIDELOG
+#define RIDELOG (CONFIG_PROFILE == PROFILE_LOGGER)		// ride log in info flash (ridelog.h)
+#endif
+#ifndef TELEMETRY
+#define TELEMETRY (CONFIG_PROFILE == PROFILE_DEBUG)		// frames on TELEMETRY_PIN (telemetry.h)
+#endif
+#ifndef FIFO_BATCH
+#define FIFO_BATCH (CONFIG_PROFILE == PROFILE_FIFO)		// FIFO and decimator (decim.h)
+#endif
+
+#endif /* CONFIG_H_ */
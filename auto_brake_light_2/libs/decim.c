@@ -0,0 +1,91 @@
+/*
+ * decim.c
+ *
+ *  CIC decimator. See decim.h.
+ */
+
+#include <decim.h>
+
+#if FIFO_BATCH
+
+static void chanInit(decim_chan *c){
+	unsigned char k;
+
+	for (k = 0; k < DECIM_ORDER; k++){
+		c->integ[k] = 0;
+		c->comb[k] = 0;
+	}
+}
+
+void decimInit(decim_state *s){
+	chanInit(&s->x);
+#if CORNER_REJECT
+	chanInit(&s->y);
+#endif
+	chanInit(&s->z);
+	s->phase = 0;
+	s->warm = DECIM_ORDER - 1;
+}
+
+static void integrate(decim_chan *c, int in){
+	unsigned long acc = (long)in;
+	unsigned char k;
+
+	for (k = 0; k < DECIM_ORDER; k++){
+		c->integ[k] += acc;
+		acc = c->integ[k];
+	}
+}
+
+static int comb(decim_chan *c){
+	unsigned long acc = c->integ[DECIM_ORDER - 1];
+	unsigned long prev;
+	unsigned char k;
+
+	for (k = 0; k < DECIM_ORDER; k++){
+		prev = c->comb[k];
+		c->comb[k] = acc;
+		acc -= prev;
+	}
+	return (int)((long)acc >> DECIM_GAIN_SHIFT);
+}
+
+/*
+ * decimPush
+ * Flow:
+ * 1. Integrate the sample.
+ * 2. Every DECIM_RATE samples, run the combs and scale by the gain.
+ * 3. The first DECIM_ORDER - 1 outputs cover samples from before
+ *    decimInit (zeros), so they are dropped.
+ */
+char decimPush(decim_state *s, accel_data *data){
+	int x, z;
+#if CORNER_REJECT
+	int y;
+
+	integrate(&s->y, data->y);
+#endif
+	integrate(&s->x, data->x);
+	integrate(&s->z, data->z);
+	if (++s->phase < DECIM_RATE){
+		return 0;
+	}
+	s->phase = 0;
+	x = comb(&s->x);
+#if CORNER_REJECT
+	y = comb(&s->y);
+#endif
+	z = comb(&s->z);
+	if (s->warm){
+		s->warm--;
+		return 0;
+	}
+	data->x = x;
+#if CORNER_REJECT
+	data->y = y;
+#endif
+	data->z = z;
+	return 1;
+}
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ * decim.h
+ *
+ *  Multi-rate front end for FIFO batches (FIFO_BATCH in main.c).
+ *
+ *  With FIFO_BATCH the sensor samples continuously at a multiple of the
+ *  decision rate into its FIFO, with the DLPF as the analogue-side
+ *  anti-aliasing filter, and main() drains the FIFO whenever it wakes.
+ *  A CIC decimator per axis (DECIM_ORDER integrators at the sensor rate,
+ *  DECIM_ORDER combs at the decision rate) turns every DECIM_RATE samples
+ *  into one output for detectStep(), so the detector, smoothing included,
+ *  runs at the decision rate only. Per sample that is DECIM_ORDER 32 bit
+ *  adds per axis; the gain of DECIM_RATE^DECIM_ORDER is a shift.
+ *
+ *  The integrators wrap around (unsigned long): a CIC only needs them
+ *  wide enough for the output, 16 + DECIM_ORDER * DECIM_SHIFT bits, and
+ *  the wraps cancel in the combs.
+ *
+ *  Costs against the INT driven mode: the sensor draws ~500 uA instead
+ *  of cycle mode's few tens (see tools/battlife), the CIC adds
+ *  DECIM_ORDER * (DECIM_RATE - 1) / 2 samples of group delay, and the
+ *  state is 16 * DECIM_ORDER bytes of RAM (24 * DECIM_ORDER with
+ *  CORNER_REJECT, which needs y decimated too). The governor's wake rate
+ *  (LP_WAKE_CTRL) does not apply, the sensor is not in cycle mode.
+ */
+
+#ifndef DECIM_H_
+#define DECIM_H_
+
+#include <config.h>
+#include <detect.h>
+
+#ifndef DECIM_SHIFT
+#define DECIM_SHIFT 3		// log2 of the decimation rate
+#endif
+#ifndef DECIM_ORDER
+#define DECIM_ORDER 2		// 1 is a plain average of each batch
+#endif
+#define DECIM_RATE (1 << DECIM_SHIFT)
+#define DECIM_GAIN_SHIFT (DECIM_ORDER * DECIM_SHIFT)
+
+// Sensor side. Sample rate 1 kHz / (1 + FIFO_DIV) (DLPF on).
+#ifndef FIFO_DIV
+#define FIFO_DIV 24			// 40 Hz: 5 Hz decisions at DECIM_SHIFT 3, as in the INT mode
+#endif
+#ifndef FIFO_DLPF
+#define FIFO_DLPF 5			// DLPF_CFG: accelerometer bandwidth 10 Hz, below the 20 Hz Nyquist
+#endif
+#define FIFO_SIZE 1024
+#ifndef FIFO_CHUNK
+#define FIFO_CHUNK 4		// samples per FIFO_R_W burst, 6 bytes of stack each
+#endif
+#define FIFO_WAKE WDT_ADLY_16		// ACLK/512: ~43 ms (25 to 130 ms) from the VLO
+#define FIFO_EMPTY_WAKES 8			// wakes in a row with nothing in the FIFO before it counts as a failure
+
+#if DECIM_ORDER < 1 || DECIM_ORDER > 4
+#error DECIM_ORDER must be 1 to 4
+#endif
+#if DECIM_GAIN_SHIFT > 16
+#error DECIM_ORDER * DECIM_SHIFT must be 16 or less (32 bit integrators)
+#endif
+#if FIFO_DLPF < 1 || FIFO_DLPF > 6
+#error FIFO_DLPF must be 1 to 6 (0 and 7 change the 1 kHz base rate)
+#endif
+
+typedef struct decim_chan_struct{
+	unsigned long integ[DECIM_ORDER];
+	unsigned long comb[DECIM_ORDER];	// previous comb inputs
+} decim_chan;
+
+typedef struct decim_state_struct{
+	decim_chan x;
+#if CORNER_REJECT
+	decim_chan y;
+#endif
+	decim_chan z;
+	unsigned char phase;	// samples into the current output
+	unsigned char warm;		// outputs still to drop while the combs fill
+} decim_state;
+
+void decimInit(decim_state *s);
+// One sample in. Returns 1 when an output is due, with it in data->x and
+// data->z, and data->y with CORNER_REJECT (without, y is left as it came in).
+char decimPush(decim_state *s, accel_data *data);
+
+#endif /* DECIM_H_ */
@@ -0,0 +1,234 @@
+/*
+ * detect.c
+ *
+ *  Brake detection pipeline. See detect.h.
+ *
+ *  The flow for each sample:
+ *  0. Temperature compensation (using the periodically updated offsets)
+ *  1. Pitch compensation (using the periodically updated comp_x/comp_z)
+ *  1a. Cornering rejection (lateral axis against z)
+ *  2. Bump compensation (streaming median)
+ *  3. Noise floor (threshold for the level detector)
+ *  4. Smoothing (two-sample weighted average)
+ *  5. Level detector
+ */
+
+#include <detect.h>
+
+#include <stdlib.h>
+
+#if BUMP_WINDOW > 1
+static dev_int bumpReject(detect_state *d, dev_int z);
+#endif
+
+void detectInit(detect_state *d){
+#if TEMP_COMP
+	d->off_x = 0;
+	d->off_z = 0;
+#if CORNER_REJECT
+	d->off_y = 0;
+#endif
+#endif
+	d->comp_x = 0;
+	d->comp_z = 0;
+#if CORNER_REJECT
+	d->comp_y = 0;
+	d->lat = 0;
+	d->corner = 0;
+#endif
+	d->cur_z = 0;
+#if NOISE_ADAPT
+	d->noise = (dev_uint)(NOISE_REF >> NOISE_SCALE) << NOISE_WINDOW;
+	d->threshold = DETECTION_THRESHOLD;
+#endif
+	d->state = DETECT_IDLE;
+#if BUMP_WINDOW > 1
+	for (d->bump_idx = 0; d->bump_idx < BUMP_WINDOW; d->bump_idx++){
+		d->bump[d->bump_idx] = 0;
+	}
+	d->bump_idx = 0;
+#endif
+
+#ifdef DETECT_TUNABLE
+	d->param.accel_coeff = ACCEL_COEFF;
+	d->param.comp_coeff = COMP_COEFF;
+	d->param.threshold = DETECTION_THRESHOLD;
+#endif
+}
+
+/*
+ * detectUpdatePitch
+ * Periodic pitch compensation.
+ * 1. Calculate current compensation amount from the accel reading.
+ * 1a. Also update comp_x for fast compensation.
+ * 2. Update smoothed compensation amount (two-sample weighted average).
+ */
+void detectUpdatePitch(detect_state *d, const accel_data *data){
+	int coeff = DETECT_PARAM(d, comp_coeff, COMP_COEFF);
+
+#if TEMP_COMP
+	d->comp_x = smoothFilter(d->comp_x, data->x - d->off_x, coeff);
+	d->comp_z = smoothFilter(d->comp_z, data->z - d->off_z, coeff);
+#else
+	d->comp_x = smoothFilter(d->comp_x, data->x, coeff);
+	d->comp_z = smoothFilter(d->comp_z, data->z, coeff);
+#endif
+#if CORNER_REJECT && TEMP_COMP
+	d->comp_y = smoothFilter(d->comp_y, data->y - d->off_y, coeff);
+#elif CORNER_REJECT
+	d->comp_y = smoothFilter(d->comp_y, data->y, coeff);
+#endif
+}
+
+#if TEMP_COMP
+/*
+ * detectUpdateTemperature
+ * Refreshes the zero-g offsets from a raw TEMP_OUT reading.
+ * Only needs calling occasionally.
+ */
+void detectUpdateTemperature(detect_state *d, dev_int raw_temp){
+	d->off_x = tempcompOffset(tempcomp_x, raw_temp);
+	d->off_z = tempcompOffset(tempcomp_z, raw_temp);
+#if CORNER_REJECT
+	d->off_y = tempcompOffset(tempcomp_y, raw_temp);
+#endif
+}
+#endif
+
+/*
+ * detectStep
+ * Runs one sample through the pipeline and returns the new state.
+ * data->z is overwritten with the compensated, de-bumped value
+ * (and data->x, and data->y with CORNER_REJECT, with the temperature
+ * compensated ones).
+ */
+char detectStep(detect_state *d, accel_data *data){
+#if TEMP_COMP
+	data->x -= d->off_x;
+	data->z -= d->off_z;
+#if CORNER_REJECT
+	data->y -= d->off_y;
+#endif
+#endif
+	data->z -= d->comp_z;
+	if (d->comp_x){
+		data->z -= d->comp_z / d->comp_x * data->z;    // z_n = tan(theta) * z = g_z/g_x*z
+	}
+#if CORNER_REJECT
+	{
+		dev_int lat;
+
+		// Half scale, so that y - comp_y cannot overflow.
+		d->lat += ((data->y >> 1) - (d->comp_y >> 1) - d->lat) >> CORNER_SMOOTH;
+		lat = abs(d->lat);
+		if (lat > (CORNER_THRESHOLD >> 1) && (lat >> CORNER_DOMINANCE) > (abs(d->cur_z) >> 1)){
+			d->corner = CORNER_HOLD + 1;
+		}
+		if (d->corner){
+			d->corner--;
+			data->z >>= CORNER_ATTEN;
+		}
+	}
+#endif
+#if BUMP_WINDOW > 1
+	data->z = bumpReject(d, data->z);
+#endif
+#if NOISE_ADAPT
+	{
+		// Half scale, so that z - cur_z cannot overflow.
+		dev_uint r = (dev_uint)abs((data->z >> 1) - (d->cur_z >> 1)) >> (NOISE_SCALE - 1);
+		dev_uint n = d->noise >> NOISE_WINDOW;
+
+		dev_int t = DETECT_PARAM(d, threshold, DETECTION_THRESHOLD) - (NOISE_REF << NOISE_GAIN)
+				+ ((dev_int)n << (NOISE_SCALE + NOISE_GAIN));
+
+		if (t < NOISE_THRESHOLD_MIN){
+			t = NOISE_THRESHOLD_MIN;
+		} else if (t > NOISE_THRESHOLD_MAX){
+			t = NOISE_THRESHOLD_MAX;
+		}
+		d->threshold = t;
+
+		if (d->state == DETECT_IDLE){
+			// n + 1: a mean that has decayed to 0 can still grow again.
+			if (r > ((n + 1) << NOISE_CLIP)){
+				r = (n + 1) << NOISE_CLIP;
+			}
+			if (r > NOISE_INPUT_MAX){
+				r = NOISE_INPUT_MAX;
+			}
+			d->noise += r - n;
+		}
+	}
+#endif
+	d->cur_z = smoothFilter(d->cur_z, data->z, DETECT_PARAM(d, accel_coeff, ACCEL_COEFF));
+
+	// One compare both engages and releases, so both follow the noise.
+	if (abs(d->cur_z) > detectThreshold(d)){
+		d->state = DETECT_BRAKE;
+	} else {
+		d->state = DETECT_IDLE;
+	}
+
+	return d->state;
+}
+
+/*
+ * smoothFilter
+ * prev/coeff*(coeff-1) + curr/coeff, for a power of two coeff (detect.h).
+ * The divisions are done as repeated halvings, which truncate the same
+ * way as one /coeff. Kept out of line: one copy instead of one per
+ * caller, and no call to the divide routine.
+ */
+__attribute__((noinline)) dev_int smoothFilter(dev_int prev, dev_int curr, dev_int coeff){
+	dev_int k;
+
+	for (k = coeff; k > 1; k >>= 1){
+		prev /= 2;
+		curr /= 2;
+	}
+	return prev * (coeff - 1) + curr;
+}
+
+#if BUMP_WINDOW > 1
+// Median of three: a and b in order, then b clamped to [a, c].
+static dev_int median3(dev_int a, dev_int b, dev_int c){
+	if (a > b){
+		dev_int t = a; a = b; b = t;
+	}
+	if (c < b){
+		b = (c > a) ? c : a;
+	}
+	return b;
+}
+
+/*
+ * bumpReject
+ * Streaming median of the last BUMP_WINDOW samples.
+ * Flow:
+ * 1. Overwrite the oldest sample in the circular buffer.
+ * 2. Return the median from a fixed compare network: no sorting, no
+ *    division, and the same compares every sample. For 5 it is the
+ *    median of the fifth sample, the larger of the two pair minimums
+ *    and the smaller of the two pair maximums.
+ */
+static dev_int bumpReject(detect_state *d, dev_int z){
+	dev_int *b = d->bump;
+
+	b[d->bump_idx] = z;
+	if (++d->bump_idx == BUMP_WINDOW){
+		d->bump_idx = 0;
+	}
+
+#if BUMP_WINDOW == 3
+	return median3(b[0], b[1], b[2]);
+#else
+	{
+		dev_int lo0 = b[0] < b[1] ? b[0] : b[1], hi0 = b[0] < b[1] ? b[1] : b[0];
+		dev_int lo1 = b[2] < b[3] ? b[2] : b[3], hi1 = b[2] < b[3] ? b[3] : b[2];
+
+		return median3(lo0 > lo1 ? lo0 : lo1, hi0 < hi1 ? hi0 : hi1, b[4]);
+	}
+#endif
+}
+#endif
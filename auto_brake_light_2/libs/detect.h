@@ -0,0 +1,194 @@
+/*
+ * detect.h
+ *
+ *  Brake detection pipeline.
+ *
+ *  Everything between "here are some accelerometer counts" and
+ *  "should the light be on" lives here, so that it can be compiled
+ *  both for the MSP430 and for the host-side replay tools in tools/.
+ *  Nothing in here may touch a peripheral register.
+ *
+ *  Parameters are compile-time constants on the MCU. Host tools build
+ *  with DETECT_TUNABLE defined, which turns them into fields of
+ *  detect_state.param so that they can be changed between runs.
+ *
+ *  Values are dev_int (devint.h): int on the MCU, and a checked 16 bit
+ *  type when the host build wants device-exact arithmetic.
+ */
+
+#ifndef DETECT_H_
+#define DETECT_H_
+
+#include <config.h>
+#include <devint.h>
+#include <tempcomp.h>
+
+// filter coefficients, powers of two (see smoothFilter())
+#ifndef ACCEL_COEFF
+#define ACCEL_COEFF 8
+#endif
+#ifndef COMP_COEFF
+#define COMP_COEFF 16
+#endif
+#if (ACCEL_COEFF & (ACCEL_COEFF - 1)) || (COMP_COEFF & (COMP_COEFF - 1))
+#error ACCEL_COEFF and COMP_COEFF must be powers of two
+#endif
+
+#ifndef DETECTION_THRESHOLD
+#define DETECTION_THRESHOLD 2000
+#endif
+
+// Adaptive noise floor.
+// One fixed threshold is either too dull on smooth tarmac or too eager
+// on cobbles. With NOISE_ADAPT the level detector's threshold follows
+// the road: noise is the mean |z - cur_z| (the part of the compensated
+// signal the smoothing takes out), and the threshold is
+//   threshold + (noise - NOISE_REF) * 2^NOISE_GAIN
+// held to NOISE_THRESHOLD_MIN..MAX, so DETECTION_THRESHOLD is the value
+// at NOISE_REF. The mean is an EMA over 2^NOISE_WINDOW samples, kept as
+// a running sum in 16 bits of RAM. It only learns while the light is
+// off, and each sample is clipped to 2^NOISE_CLIP times the current
+// mean, so a braking onset (a large residual for a few samples) barely
+// moves it before the level detector has seen it. Shifts, adds and
+// compares only. The level detector engages and releases on the same
+// compare, so both follow the noise, and the brightness steps count up
+// from the same threshold (detectThreshold()).
+// The defaults come from tune over the ridegen corpora (96 x 900 s
+// rides, mixed, mount, cobbles, stop) on the FULL profile, ACCEL_COEFF
+// and COMP_COEFF as shipped: at the same false trigger rate the adaptive
+// threshold has 3 to 6 samples less onset latency than a fixed one
+// from 140 to 310 false triggers an hour. At DETECTION_THRESHOLD 2000
+// it is 17.3 samples at 256/h, against 18.0 at 295/h fixed. NOISE_REF
+// 1200..2400 and NOISE_GAIN 1 were all further off the fixed curve.
+#ifndef NOISE_WINDOW
+#define NOISE_WINDOW 8			// 256 samples, ~50 s at 5 Hz
+#endif
+#ifndef NOISE_CLIP
+#define NOISE_CLIP 2
+#endif
+#ifndef NOISE_REF
+#define NOISE_REF 1600			// noise the fixed threshold was tuned for
+#endif
+#ifndef NOISE_GAIN
+#define NOISE_GAIN 0
+#endif
+#ifndef NOISE_THRESHOLD_MIN
+#define NOISE_THRESHOLD_MIN 1500
+#endif
+#ifndef NOISE_THRESHOLD_MAX
+#define NOISE_THRESHOLD_MAX 4000	// ~0.25 g: a hard stop still gets through on cobbles
+#endif
+#define NOISE_SCALE 5			// the sum counts in units of 2^NOISE_SCALE
+#define NOISE_INPUT_MAX (0xFFFF >> NOISE_WINDOW)	// keeps the sum in 16 bits
+
+// Samples between pitch compensation updates.
+#ifndef PITCH_INTERVAL
+#define PITCH_INTERVAL 10
+#endif
+
+// Cornering rejection.
+// The lean does not cancel all of the cornering force, and the extra load
+// on the frame reaches z through the mounting pitch: a false brake light
+// on fast corners. This stage watches the lateral axis (y less comp_y,
+// the mounting roll, tracked with the pitch). While |lateral| is above
+// CORNER_THRESHOLD and over 2^CORNER_DOMINANCE times |z|, and for
+// CORNER_HOLD samples after, z is scaled by 2^-CORNER_ATTEN. Braking in
+// a corner still gets through: z then dominates. Compares and shifts only; 5 bytes of RAM (7 with TEMP_COMP).
+#ifndef CORNER_THRESHOLD
+#define CORNER_THRESHOLD 2000		// ~0.12 g at +-2 g
+#endif
+#ifndef CORNER_DOMINANCE
+#define CORNER_DOMINANCE 1
+#endif
+#ifndef CORNER_ATTEN
+#define CORNER_ATTEN 2
+#endif
+#ifndef CORNER_SMOOTH
+#define CORNER_SMOOTH 2
+#endif
+#ifndef CORNER_HOLD
+#define CORNER_HOLD 0
+#endif
+
+// Bump and pothole rejection.
+// A streaming median over the last BUMP_WINDOW compensated samples, run
+// before the smoothing and the level detector. A single-sample spike can
+// never be the median, so it never reaches smoothFilter() (at 5, neither
+// can two in a row). Costs (BUMP_WINDOW-1)/2 samples of delay and
+// 2 * BUMP_WINDOW + 1 bytes of RAM. BUMP_WINDOW (1, 3 or 5; 1 compiles
+// the stage out) is a switch in config.h.
+// Measured with tools/cyclebench.sh (bench430, 128 samples, detectStep
+// self time against BUMP_WINDOW 1): ~52 cycles per sample at 3, ~86 at 5.
+// Built with a clang/LLVM 14 MSP430 compiler in place of
+// msp430-elf-gcc; re-run with it.
+#if BUMP_WINDOW != 1 && BUMP_WINDOW != 3 && BUMP_WINDOW != 5
+#error BUMP_WINDOW must be 1, 3 or 5
+#endif
+
+// Detector output states. Values match the old state machine in main().
+#define DETECT_BRAKE 1
+#define DETECT_IDLE 2
+
+typedef struct accel_data_struct{
+	dev_int x;
+	dev_int y;
+	dev_int z;
+} accel_data;
+
+#ifdef DETECT_TUNABLE
+typedef struct detect_param_struct{
+	int accel_coeff;
+	int comp_coeff;
+	int threshold;
+} detect_param;
+#define DETECT_PARAM(d, name, def) ((d)->param.name)
+#else
+#define DETECT_PARAM(d, name, def) (def)
+#endif
+
+typedef struct detect_state_struct{
+#if TEMP_COMP
+	dev_int off_x;		// temperature dependent zero-g offsets, see tempcomp.h
+	dev_int off_z;
+#if CORNER_REJECT
+	dev_int off_y;
+#endif
+#endif
+	dev_int comp_x;		// smoothed pitch compensation amounts
+	dev_int comp_z;
+#if CORNER_REJECT
+	dev_int comp_y;		// smoothed mounting roll
+	dev_int lat;		// smoothed lateral, half scale
+	char corner;		// samples left in the current corner
+#endif
+	dev_int cur_z;		// smoothed, compensated z
+#if NOISE_ADAPT
+	dev_uint noise;		// mean |z - cur_z| << NOISE_WINDOW, in 2^NOISE_SCALE counts
+	dev_int threshold;	// level detector threshold for the last sample
+#endif
+#if BUMP_WINDOW > 1
+	dev_int bump[BUMP_WINDOW];	// circular buffer for the median
+	unsigned char bump_idx;
+#endif
+	char state;
+#ifdef DETECT_TUNABLE
+	detect_param param;
+#endif
+} detect_state;
+
+// Threshold the level detector used on the last sample.
+#if NOISE_ADAPT
+#define detectThreshold(d) ((d)->threshold)
+#else
+#define detectThreshold(d) DETECT_PARAM(d, threshold, DETECTION_THRESHOLD)
+#endif
+
+void detectInit(detect_state *d);
+void detectUpdatePitch(detect_state *d, const accel_data *data);
+#if TEMP_COMP
+void detectUpdateTemperature(detect_state *d, dev_int raw_temp);
+#endif
+char detectStep(detect_state *d, accel_data *data);
+dev_int smoothFilter(dev_int prev, dev_int curr, dev_int coeff);
+
+#endif /* DETECT_H_ */
@@ -0,0 +1,30 @@
+/*
+ * devint.h
+ *
+ *  Integer types for code that is shared with the host tools.
+ *
+ *  On the MSP430 these are just int and unsigned int (16 bits). On a
+ *  host, plain int is 32 bits, so overflow, sign extension and the like
+ *  quietly behave differently there. Building as C++ with MSP_CHECKED
+ *  defined swaps in the checked 16 bit model from tools/msp16.hpp,
+ *  which reproduces what the device computes and counts every hazard
+ *  (see tools/check16.cpp).
+ *
+ *  Use these for values that go through arithmetic. Counters, indices
+ *  and flags can stay char / unsigned char.
+ */
+
+#ifndef DEVINT_H_
+#define DEVINT_H_
+
+#if defined(MSP_CHECKED) && defined(__cplusplus)
+#include <msp16.hpp>
+typedef msp16::i16 dev_int;
+typedef msp16::u16 dev_uint;
+using msp16::abs;
+#else
+typedef int dev_int;
+typedef unsigned int dev_uint;
+#endif
+
+#endif /* DEVINT_H_ */
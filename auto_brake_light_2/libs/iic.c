@@ -4,114 +4,129 @@
  *  Created on: 7 Nov 2015
  *      Author: ed
  *
- *  Uses USI_VECTOR
+ *  Uses USI_VECTOR, WDT_VECTOR
  *   Heavy use of msp430g2x21_usi_12.c - code example provided by TI for
  * 	the implementation of the i2c state machine.
  *
+ *  Every transfer runs against a timeout on the watchdog interval timer
+ *  (see iic.h for the recovery rules).
+ *
  */
 
 #include <iic.h>
 
 #include <msp430.h>
+#include <pcbv1.h>
 
 // I2C COMMS
-void Master_Transmit(void);
-char Master_Recieve(void);
-
-void Setup_USI_Master_TX(void);
-void Setup_USI_Master_RX(void);
-
-void Data_TX (void);
-void Data_RX (void);
+static void Setup_USI_Master(void);
+static void iicRun(char transmit, char reg, char *buf, char n);
 
 // State variables
-char I2C_State, Bytecount, Transmit = 0;
-char curr_data = 0;			// data to send
-char curr_reg_address = 0; // target of transmission! (address)
-char slave_address_sent = 0;	// flag, used when reading a register.
-char curr_output = 0;		// this is data received from the slave upon reading a register.
+static unsigned char I2C_State = 0;
+static char Transmit;			// writing (else reading) the registers
+static char curr_reg_address;	// target of transmission! (address)
+static char slave_address_sent;	// flag, set once a read has sent the repeated start
+static char *iic_buf;			// bytes to write after the register address, or where received bytes go
+static char iic_len;			// bytes of iic_buf left
 
-#define number_of_bytes 2  // change this later..
+// Fault handling, see iic.h
+static volatile char iic_done;		// state machine got to the stop condition
+static volatile char iic_ticks;		// watchdog ticks since the transfer started
+static char iic_result;				// IIC_OK or IIC_NACK, set by the state machine
+char iic_fault = 0;
+iic_counters iic_errors;
 
+static char iicTransfer(char ticks);
+static void iicBusClear(void);
 
+
+/*
+ * USI ISR
+ * The I2C state machine. Even states act on a completed bit count:
+ * 0 (repeated) start and slave address, 2/10 clock in the slave's
+ * (N)Ack, 4 act on the address (N)Ack, 6 (N)Ack a received byte,
+ * 12 act on a data (N)Ack, 8 and 14 send the stop.
+ * Every NACK and the end of a write go through 12 into 8, so the stop
+ * is set up in one place.
+ */
 #pragma vector = USI_VECTOR
 __interrupt void USI_TXRX (void){
 
 
 	switch(I2C_State){
-		case 0: // Generate Start Condition & send address to slave
-			Bytecount = 0;
-			USISRL = 0x00;                // Generate Start Condition...
+		case 0: // Generate (repeated) Start Condition & send address to slave
+			USISRL = 0x00;                // While clock is high, force SDA low.
 			USICTL0 |= USIGE+USIOE;
 			USICTL0 &= ~USIGE;
-			USISRL = slave_i2c_address;		// Send slave address + write first!
-			USICNT = 8;
-			// USICNT = (USICNT & 0xE0) + 0x08; // Bit counter = 8, TX Address
+			USISRL = slave_i2c_address + slave_address_sent;	// Send slave address + write first, + read after the repeated start
+			USICNT = 8;                   // Bit counter = 8, TX Address
 			I2C_State = 2;              	  // next state: rcv address (N)Ack
 			break;
 
 		case 2: // Receive Address Ack/Nack bit
+		case 10: // Receive Data Ack/Nack bit
 			USICTL0 &= ~USIOE;            // SDA = input
 			USICNT |= 0x01;               // Bit counter=1, receive (N)Ack bit
-			I2C_State = 4;                // Go to next state: check (N)Ack
+			I2C_State += 2;               // Go to next state: check (N)Ack (4 or 12)
 			break;
 
 		case 4: // Process Address Ack/Nack & handle data TX
-
-			if (USISRL & 0x01)            // If Nack received...
-			{ // Send stop...
-				USICTL0 |= USIOE;             // SDA = output
-				USISRL = 0x00;
-				USICNT |=  0x01;            // Bit counter=1, SCL high, SDA low
-				I2C_State = 14;             // Go to next state: generate Stop
-			}
-			else
-			{ // Ack received, TX adress to slave...
-				if (slave_address_sent == 1){
+			if (!(USISRL & 0x01)){        // Ack received
+				if (slave_address_sent){
 					// Now, the slave will start sending data.
-					// This should really only happen if
-					// transmit == 0..
-					Data_RX();
-				} else{
-					// Send the slave address across.
+					USICTL0 &= ~USIOE;                // SDA = input
+					USICNT |= 0x08;                   // Bit counter = 8, RX data
+					I2C_State = 6;                    // Next state: Test data and (N)Ack
+				} else {
+					// Send the register address across.
 					USICTL0 |= USIOE;             // SDA = output
-					USISRL = curr_reg_address;            // Load data byte
+					USISRL = curr_reg_address;    // Load data byte
 					USICNT |=  0x08;              // Bit counter = 8, start TX
-					Bytecount++;
-					I2C_State = 10;               // next state: receive data (N)Ac
+					I2C_State = 10;               // next state: receive data (N)Ack
 				}
-
-
+				break;
 			}
-			break;
-
-		case 5: // Generate repeated start condition
+			// Nack received: case 12 sees it too, and sends the stop
+			/* fall through */
 
-			USISRL = 0x00;                // While clock is high, force SDA low.
-			USICTL0 |= USIGE+USIOE;
-			USICTL0 &= ~USIGE;
-
-			USICTL0 |= USIOE;	// make sure that the output is enabled.
-
-			// Now send slave address.
-			USISRL = slave_i2c_address + 1;		// Send slave address + read.
-			USICNT =  8; // Bit counter = 8, TX Address
+		case 12: // Process Data Ack/Nack & send the next byte, a repeated start or Stop
+			USICTL0 |= USIOE;             // SDA = output
 
-			slave_address_sent = 1; // Set flag, so that data is sent in state 4.
-			I2C_State = 2;              	  // next state: rcv address (N)Ack
+			if (USISRL & 0x01){			// Nack on the address, a register or data byte: stop
+				iic_result = IIC_NACK;
+			} else if (!Transmit){
+				// prepare a repeated start transmission.
+				USISRL = 0xFF;
+				USICNT = 1;
+				slave_address_sent = 1;
+				I2C_State = 0;
+				break;
+			} else if (iic_len){
+				USISRL = *iic_buf++;          // Load data byte
+				iic_len--;
+				USICNT |= 0x08;               // Bit counter = 8, start TX
+				I2C_State = 10;               // next state: receive data (N)Ack
+				break;
+			}
+			// Nack, or the last byte is out
+			/* fall through */
 
+		case 8: // Prep Stop Condition
+			USICTL0 |= USIOE;             // SDA = output
+			USISRL = 0x00;
+			USICNT |=  0x01;              // Bit counter= 1, SCL high, SDA low
+			I2C_State = 14;               // Go to next state: generate Stop
 			break;
 
 		case 6: // Send Data Ack/Nack bit
 			USICTL0 |= USIOE;             // SDA = output
-			curr_output = USISRL;		// grab output
-
+			*iic_buf++ = USISRL;		// grab output
 
-			if (Bytecount <= number_of_bytes-2)
+			if (--iic_len)
 			{                             // If this is not the last byte
 				USISRL = 0x00;              // Send Ack
 				I2C_State = 4;              // Go to next state: data/rcv again
-				Bytecount++;
 			}
 
 			else //last byte: send NACK
@@ -123,49 +138,13 @@ __interrupt void USI_TXRX (void){
 			USICNT |= 0x01;               // Bit counter = 1, send (N)Ack bit
 			break;
 
-		case 8: // Prep Stop Condition
-			USICTL0 |= USIOE;             // SDA = output
-			USISRL = 0x00;
-			USICNT |=  0x01;              // Bit counter= 1, SCL high, SDA low
-			I2C_State = 14;               // Go to next state: generate Stop
-			break;
-
-		case 10: // Receive Data Ack/Nack bit
-			USICTL0 &= ~USIOE;            // SDA = input
-			USICNT |= 0x01;               // Bit counter = 1, receive (N)Ack bit
-			I2C_State = 12;               // Go to next state: check (N)Ack
-			break;
-
-		case 12: // Process Data Ack/Nack & send Stop
-			USICTL0 |= USIOE;
-
-			if (Transmit == 1){
-				if (Bytecount == number_of_bytes){// If last byte
-					USISRL = 0x00;
-					I2C_State = 14;               // Go to next state: generate Stop
-					USICNT |=  0x01;             // set count=1 to trigger next state
-					Bytecount++;
-				}else{
-					Data_TX();                  // TX byte
-				}
-			} else {
-				// prepare a repeated start transmission.
-
-				USICTL0 |= USIOE;
-				USISRL = 0xFF;
-				USICNT = 1;
-
-				I2C_State = 5;
-			}
-
-			break;
-
 		case 14:// Generate Stop Condition
 			USISRL = 0x0FF;               // USISRL = 1 to release SDA
 			USICTL0 |= USIGE;             // Transparent latch enabled
 			USICTL0 &= ~(USIGE+USIOE);    // Latch/SDA output disabled
 			I2C_State = 0;                // Reset state machine for next xmt
 			slave_address_sent = 0;		// Reset flag
+			iic_done = 1;
 			LPM0_EXIT;                    // Exit active for next transfer
 			break;
 		}
@@ -174,24 +153,9 @@ __interrupt void USI_TXRX (void){
 }
 
 
-void Data_TX (void){
-	USISRL = curr_data;          // Load data byte
-	USICNT = (USICNT & 0xE0) + 8;              // Bit counter = 8, start TX
-	I2C_State = 10;               // next state: receive data (N)Ack
-	Bytecount++;
-}
-
-void Data_RX (void){
-	USICTL0 &= ~USIOE;                  // SDA = input --> redundant
-	USICNT  = (USICNT & 0xE0) + 8;                    // Bit counter = 8, RX data
-	I2C_State = 6;                      // Next state: Test data and (N)Ack
-}
-
-void Setup_USI_Master_TX (void)
+static void Setup_USI_Master(void)
 {
 	_disable_interrupts();
-	Bytecount = 0;
-	Transmit = 1;
 	USICTL0 = USIPE6+USIPE7+USIMST+USISWRST;  // Port & USI mode setup
 	USICTL1 = USII2C+USIIE;                   // Enable I2C mode & USI interrupt
 	USICKCTL = USIDIV_7+USISSEL_2+USICKPL;    // USI clk: SCL = SMCLK/128
@@ -201,44 +165,145 @@ void Setup_USI_Master_TX (void)
 	_enable_interrupts();
 }
 
-void Setup_USI_Master_RX (void)
-{
+/*
+ * iicRun
+ * One read or write of n bytes, starting at register reg, retried up to
+ * IIC_RETRIES times. Nothing at all while iic_fault is set.
+ */
+static void iicRun(char transmit, char reg, char *buf, char n){
+	char attempt;
+
+	if (iic_fault){
+		return;
+	}
+	Transmit = transmit;
+	curr_reg_address = reg;
+	for (attempt = 0; attempt < IIC_RETRIES; attempt++){
+		Setup_USI_Master();
+		iic_buf = buf;
+		iic_len = n;
+		// About 1.2 ms per byte at SMCLK/128: one more tick per 4 bytes.
+		if (iicTransfer(IIC_TIMEOUT_TICKS + (n >> 2)) == IIC_OK){
+			return;
+		}
+	}
+	iic_errors.failures++;
+	iic_fault = 1;
+}
+
+/*
+ * iicTransfer
+ * Runs one transfer set up by Setup_USI_Master.
+ * Flow:
+ * 1. Start the watchdog interval timer, then the state machine.
+ * 2. Sleep in LPM0 until the stop condition or 'ticks' watchdog ticks.
+ *    (Interrupts off around the check, so a wake-up between the check
+ *    and the sleep is not lost.)
+ * 3. Timed out: the bus is stuck, clear it and reset the USI.
+ * 4. Delay between comm cycles (IIC_GAP_CYCLES).
+ */
+static char iicTransfer(char ticks){
+	iic_done = 0;
+	iic_result = IIC_OK;
+	iic_ticks = 0;
+	WDTCTL = WDT_MDLY_8;
+	IFG1 &= ~WDTIFG;
+	IE1 |= WDTIE;
+
+	USICTL1 |= USIIFG;                      // Set flag and start communication
 	_disable_interrupts();
-	Bytecount = 0;
-	Transmit = 0;
-	USICTL0 = USIPE6+USIPE7+USIMST+USISWRST;  // Port & USI mode setup
-	USICTL1 = USII2C+USIIE;                   // Enable I2C mode & USI interrupt
-	USICKCTL = USIDIV_7+USISSEL_2+USICKPL;    // USI clks: SCL = SMCLK/128
-	USICNT |= USIIFGCC;                       // Disable automatic clear control
-	USICTL0 &= ~USISWRST;                     // Enable USI
-	USICTL1 &= ~USIIFG;                       // Clear pending flag
+	while (!iic_done && iic_ticks < ticks){
+		_BIS_SR(LPM0_bits + GIE);           // CPU off, await USI interrupt
+		_disable_interrupts();
+	}
+	WDTCTL = WDTPW + WDTHOLD;
+	IE1 &= ~WDTIE;
+
+	if (!iic_done){
+		iic_result = IIC_TIMEOUT;
+		iicBusClear();
+	}
+	if (iic_result == IIC_NACK){
+		iic_errors.nacks++;
+	}
 	_enable_interrupts();
-
+	__delay_cycles(IIC_GAP_CYCLES);         // Delay between comm cycles
+	return iic_result;
 }
 
-void Master_Transmit(void){
-	Setup_USI_Master_TX();
-    USICTL1 |= USIIFG;                      // Set flag and start communication
-    LPM0;                                   // CPU off, await USI interrupt
-    __delay_cycles(10000);                  // Delay between comm cycles
+/*
+ * iicBusClear
+ * Gets a slave that stopped half way through a byte (and so may be
+ * holding SDA low) back to idle.
+ * Flow:
+ * 1. Soft reset the USI and take SCL/SDA back as plain GPIO. The lines
+ *    are driven open-drain by hand: low = output 0, high = input (the
+ *    pull-ups do the rest).
+ * 2. Clock SCL up to nine times, until the slave lets go of SDA.
+ * 3. Send a STOP: SDA low, SCL high, SDA high.
+ * 4. Reset the state machine. The next Setup_USI_Master gives the pins
+ *    back to the USI.
+ * No delays between the edges: every P1DIR write is a bis.b/bic.b of a
+ * non-constant-generator immediate to an absolute address, 5 cycles, so
+ * at 1 MHz the edges are at least 5 us apart, over the 4.7 us minimum
+ * of standard mode. A faster MCLK needs __delay_cycles() back in.
+ */
+static void iicBusClear(void){
+	char i;
+
+	iic_errors.timeouts++;
+	USICTL0 |= USISWRST;
+	USICTL0 &= ~(USIPE6 + USIPE7);
+	P1OUT &= ~(SCL_PIN + SDA_PIN);
+	P1DIR &= ~(SCL_PIN + SDA_PIN);
+
+	for (i = 0; i < 9 && !(P1IN & SDA_PIN); i++){
+		P1DIR |= SCL_PIN;
+		P1DIR &= ~SCL_PIN;
+	}
+
+	P1DIR |= SCL_PIN;
+	P1DIR |= SDA_PIN;
+	P1DIR &= ~SCL_PIN;
+	P1DIR &= ~SDA_PIN;
+
+	I2C_State = 0;
+	slave_address_sent = 0;
 }
-char Master_Recieve(void){
-  Setup_USI_Master_RX();
-  USICTL1 |= USIIFG;                        // Set flag and start communication
-  LPM0;                                     // CPU off, await USI interrupt
-  __delay_cycles(10000);                    // Delay between comm cycles
-  return curr_output;
+
+/*
+ * WDT ISR
+ * Interval timer tick: counts towards the transfer timeout. Also the
+ * sensor watchdog's wake-up in main(), so it leaves any LPM.
+ */
+#pragma vector = WDT_VECTOR
+__interrupt void WDT_TICK(void){
+	iic_ticks++;
+	_BIC_SR_IRQ(LPM3_bits);
 }
 
 // Wrappers for ADXL state machine
+// Once a transfer has failed, the rest fail straight away until the
+// caller clears iic_fault, so a dead sensor costs one failed transfer.
 void iicWrite(char reg, char data){
-	curr_data = data;
-	curr_reg_address = reg;
-	Master_Transmit();
+	iicWriteBurst(reg, &data, 1);
+}
+
+// Register auto-increment: data[i] goes to reg + i.
+void iicWriteBurst(char reg, const char *data, char n){
+	iicRun(1, reg, (char *)data, n);
 }
 
 char iicRead(char reg){
-	slave_address_sent = 0;
-	curr_reg_address = reg;
-	return Master_Recieve();
+	char data = 0;
+
+	iicReadBurst(reg, &data, 1);
+	return data;
+}
+
+// Register auto-increment: data[i] comes from reg + i (FIFO_R_W does not
+// increment, so that is the next n bytes of the FIFO). Master ACKs all
+// but the last byte.
+void iicReadBurst(char reg, char *data, char n){
+	iicRun(0, reg, data, n);
 }
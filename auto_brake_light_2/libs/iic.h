@@ -10,15 +10,64 @@
  *  be sure to write to 'slave_i2c_address'.
  *  Set this to the 7 bit address plus a leading 0 (LSB).
  *
- *  At the moment only supports single byte reads and writes.
+ *  Reads and writes can be a burst to consecutive registers (the
+ *  MPU-6050 increments its register pointer).
+ *
+ *  Faults:
+ *  - A NACK ends the transfer with a stop condition.
+ *  - A transfer that has not finished after IIC_TIMEOUT_TICKS of the
+ *    watchdog interval timer (WDT_MDLY_8, 8.2 ms at 1 MHz) is abandoned:
+ *    nine-clock bus clear, STOP and USI soft reset.
+ *  - Either way it is retried, up to IIC_RETRIES attempts. If they all
+ *    fail, iic_fault is set and every later call fails straight away
+ *    (reads return 0) until the caller clears it.
+ *  So each time the caller clears iic_fault, a dead bus can cost it at
+ *  most IIC_RETRIES * (16.4 ms + IIC_GAP_CYCLES), about 80 ms (a
+ *  little more for a long burst).
+ *
+ *  The watchdog is held again after each transfer. Its ISR lives here.
  */
 
 #ifndef IIC_H_
 #define IIC_H_
 
+#include <config.h>
+
+#define IIC_TIMEOUT_TICKS 2		// 16.4 ms, about twice a single byte transfer (bursts get more)
+#define IIC_RETRIES 3
+
+// Idle time after every transfer, in cycles. 10 ms comes with the TI
+// example this driver is based on; the MPU-6050 only needs the bus free
+// time between a STOP and the next START (4.7 us at 100 kHz). FIFO_BATCH
+// drains the FIFO in several transfers per decision, so it does not pay
+// the 10 ms; the INT driven build keeps it until it is tried on the bike.
+#ifndef IIC_GAP_CYCLES
+#if FIFO_BATCH
+#define IIC_GAP_CYCLES 10
+#else
+#define IIC_GAP_CYCLES 10000
+#endif
+#endif
+
+// Transfer results (per attempt)
+#define IIC_OK 0
+#define IIC_NACK 1
+#define IIC_TIMEOUT 2
+
+typedef struct iic_counters_struct{
+	unsigned int nacks;			// attempts NACKed by the slave
+	unsigned int timeouts;		// attempts timed out (and bus cleared)
+	unsigned int failures;		// transfers given up after IIC_RETRIES
+} iic_counters;
+
 // WRAPPERS FOR I2C COMMS FOR ADXL
 void iicWrite(char reg, char data);
+void iicWriteBurst(char reg, const char *data, char n);
 char iicRead(char reg);
+void iicReadBurst(char reg, char *data, char n);	// data is not valid after a failure
+
+extern char iic_fault;			// a transfer failed, sticky: cleared by the caller
+extern iic_counters iic_errors;
 
 char slave_i2c_address; 	// be sure to set this to the 7 bit address shifted left by 1!
 
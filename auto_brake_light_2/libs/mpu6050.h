@@ -15,6 +15,15 @@
 // At 0 degrees: -512 - (340 * 35) = -12412
 #define MPU6050_GET_TEMPERATURE(t) (( (float)t + 12412.0) / 340.0)
 
+// Integer-only versions for the MSP430, which has neither an FPU nor a
+// hardware multiplier. Go the other way instead of dividing: convert
+// degrees to raw counts, which folds to a constant at compile time.
+// Valid over the sensor range without overflowing a 16 bit int.
+#define MPU6050_TEMP_RAW(c) ((c) * 340 - 12412)
+// Build the signed 16 bit reading from TEMP_OUT_H/L (or any _H/_L pair).
+// The low byte must not be sign-extended.
+#define MPU6050_WORD(h, l) ((int)(((unsigned int)(unsigned char)(h) << 8) | (unsigned char)(l)))
+
 // The name of the sensor is "MPU-6050".
 // For program code, I omit the '-',
 // therefor I use the name "MPU6050....".
@@ -39,7 +48,7 @@
 #define MPU6050_MOT_DUR            0x20   // R/W
 #define MPU6050_ZRMOT_THR          0x21   // R/W
 #define MPU6050_ZRMOT_DUR          0x22   // R/W
-//#define MPU6050_FIFO_EN            0x23   // R/W
+#define MPU6050_FIFO_ENABLE        0x23   // R/W  (FIFO_EN; that name is the USER_CTRL bit)
 #define MPU6050_I2C_MST_CTRL       0x24   // R/W
 #define MPU6050_I2C_SLV0_ADDR      0x25   // R/W
 #define MPU6050_I2C_SLV0_REG       0x26   // R/W
@@ -137,8 +146,7 @@
 
 // CONFIG Register
 // DLPF is Digital Low Pass Filter for both gyro and accelerometers.
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_DLPF_CFG0     MPU6050_D0
 #define MPU6050_DLPF_CFG1     MPU6050_D1
 #define MPU6050_DLPF_CFG2     MPU6050_D2
@@ -148,13 +156,13 @@
 
 // Combined definitions for the EXT_SYNC_SET values
 #define MPU6050_EXT_SYNC_SET_0 (0)
-#define MPU6050_EXT_SYNC_SET_1 (1 << (MPU6050_EXT_SYNC_SET0))
-#define MPU6050_EXT_SYNC_SET_2 (1 << (MPU6050_EXT_SYNC_SET1))
-#define MPU6050_EXT_SYNC_SET_3 (1 << (MPU6050_EXT_SYNC_SET1)|1 << (MPU6050_EXT_SYNC_SET0))
-#define MPU6050_EXT_SYNC_SET_4 (1 << (MPU6050_EXT_SYNC_SET2))
-#define MPU6050_EXT_SYNC_SET_5 (1 << (MPU6050_EXT_SYNC_SET2)|1 << (MPU6050_EXT_SYNC_SET0))
-#define MPU6050_EXT_SYNC_SET_6 (1 << (MPU6050_EXT_SYNC_SET2)|1 << (MPU6050_EXT_SYNC_SET1))
-#define MPU6050_EXT_SYNC_SET_7 (1 << (MPU6050_EXT_SYNC_SET2)|1 << (MPU6050_EXT_SYNC_SET1)|1 << (MPU6050_EXT_SYNC_SET0))
+#define MPU6050_EXT_SYNC_SET_1 (MPU6050_EXT_SYNC_SET0)
+#define MPU6050_EXT_SYNC_SET_2 (MPU6050_EXT_SYNC_SET1)
+#define MPU6050_EXT_SYNC_SET_3 (MPU6050_EXT_SYNC_SET1|MPU6050_EXT_SYNC_SET0)
+#define MPU6050_EXT_SYNC_SET_4 (MPU6050_EXT_SYNC_SET2)
+#define MPU6050_EXT_SYNC_SET_5 (MPU6050_EXT_SYNC_SET2|MPU6050_EXT_SYNC_SET0)
+#define MPU6050_EXT_SYNC_SET_6 (MPU6050_EXT_SYNC_SET2|MPU6050_EXT_SYNC_SET1)
+#define MPU6050_EXT_SYNC_SET_7 (MPU6050_EXT_SYNC_SET2|MPU6050_EXT_SYNC_SET1|MPU6050_EXT_SYNC_SET0)
 
 // Alternative names for the combined definitions.
 #define MPU6050_EXT_SYNC_DISABLED     MPU6050_EXT_SYNC_SET_0
@@ -168,13 +176,13 @@
 
 // Combined definitions for the DLPF_CFG values
 #define MPU6050_DLPF_CFG_0 (0)
-#define MPU6050_DLPF_CFG_1 (1 << (MPU6050_DLPF_CFG0))
-#define MPU6050_DLPF_CFG_2 (1 << (MPU6050_DLPF_CFG1))
-#define MPU6050_DLPF_CFG_3 (1 << (MPU6050_DLPF_CFG1)|1 << (MPU6050_DLPF_CFG0))
-#define MPU6050_DLPF_CFG_4 (1 << (MPU6050_DLPF_CFG2))
-#define MPU6050_DLPF_CFG_5 (1 << (MPU6050_DLPF_CFG2)|1 << (MPU6050_DLPF_CFG0))
-#define MPU6050_DLPF_CFG_6 (1 << (MPU6050_DLPF_CFG2)|1 << (MPU6050_DLPF_CFG1))
-#define MPU6050_DLPF_CFG_7 (1 << (MPU6050_DLPF_CFG2)|1 << (MPU6050_DLPF_CFG1)|1 << (MPU6050_DLPF_CFG0))
+#define MPU6050_DLPF_CFG_1 (MPU6050_DLPF_CFG0)
+#define MPU6050_DLPF_CFG_2 (MPU6050_DLPF_CFG1)
+#define MPU6050_DLPF_CFG_3 (MPU6050_DLPF_CFG1|MPU6050_DLPF_CFG0)
+#define MPU6050_DLPF_CFG_4 (MPU6050_DLPF_CFG2)
+#define MPU6050_DLPF_CFG_5 (MPU6050_DLPF_CFG2|MPU6050_DLPF_CFG0)
+#define MPU6050_DLPF_CFG_6 (MPU6050_DLPF_CFG2|MPU6050_DLPF_CFG1)
+#define MPU6050_DLPF_CFG_7 (MPU6050_DLPF_CFG2|MPU6050_DLPF_CFG1|MPU6050_DLPF_CFG0)
 
 // Alternative names for the combined definitions
 // This name uses the bandwidth (Hz) for the accelometer,
@@ -191,8 +199,7 @@
 // GYRO_CONFIG Register
 // The XG_ST, YG_ST, ZG_ST are 1 << s for selftest.
 // The FS_SEL sets the range for the gyro.
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_FS_SEL0 MPU6050_D3
 #define MPU6050_FS_SEL1 MPU6050_D4
 #define MPU6050_ZG_ST   MPU6050_D5
@@ -201,9 +208,9 @@
 
 // Combined definitions for the FS_SEL values
 #define MPU6050_FS_SEL_0 (0)
-#define MPU6050_FS_SEL_1 (1 << (MPU6050_FS_SEL0))
-#define MPU6050_FS_SEL_2 (1 << (MPU6050_FS_SEL1))
-#define MPU6050_FS_SEL_3 (1 << (MPU6050_FS_SEL1)|1 << (MPU6050_FS_SEL0))
+#define MPU6050_FS_SEL_1 (MPU6050_FS_SEL0)
+#define MPU6050_FS_SEL_2 (MPU6050_FS_SEL1)
+#define MPU6050_FS_SEL_3 (MPU6050_FS_SEL1|MPU6050_FS_SEL0)
 
 // Alternative names for the combined definitions
 // The name uses the range in degrees per second.
@@ -215,8 +222,7 @@
 // ACCEL_CONFIG Register
 // The XA_ST, YA_ST, ZA_ST are 1 << s for selftest.
 // The AFS_SEL sets the range for the accelerometer.
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_ACCEL_HPF0 MPU6050_D0
 #define MPU6050_ACCEL_HPF1 MPU6050_D1
 #define MPU6050_ACCEL_HPF2 MPU6050_D2
@@ -228,11 +234,11 @@
 
 // Combined definitions for the ACCEL_HPF values
 #define MPU6050_ACCEL_HPF_0 (0)
-#define MPU6050_ACCEL_HPF_1 (1 << (MPU6050_ACCEL_HPF0))
-#define MPU6050_ACCEL_HPF_2 (1 << (MPU6050_ACCEL_HPF1))
-#define MPU6050_ACCEL_HPF_3 (1 << (MPU6050_ACCEL_HPF1)|1 << (MPU6050_ACCEL_HPF0))
-#define MPU6050_ACCEL_HPF_4 (1 << (MPU6050_ACCEL_HPF2))
-#define MPU6050_ACCEL_HPF_7 (1 << (MPU6050_ACCEL_HPF2)|1 << (MPU6050_ACCEL_HPF1)|1 << (MPU6050_ACCEL_HPF0))
+#define MPU6050_ACCEL_HPF_1 (MPU6050_ACCEL_HPF0)
+#define MPU6050_ACCEL_HPF_2 (MPU6050_ACCEL_HPF1)
+#define MPU6050_ACCEL_HPF_3 (MPU6050_ACCEL_HPF1|MPU6050_ACCEL_HPF0)
+#define MPU6050_ACCEL_HPF_4 (MPU6050_ACCEL_HPF2)
+#define MPU6050_ACCEL_HPF_7 (MPU6050_ACCEL_HPF2|MPU6050_ACCEL_HPF1|MPU6050_ACCEL_HPF0)
 
 // Alternative names for the combined definitions
 // The name uses the Cut-off frequency.
@@ -245,9 +251,9 @@
 
 // Combined definitions for the AFS_SEL values
 #define MPU6050_AFS_SEL_0 (0)
-#define MPU6050_AFS_SEL_1 (1 << (MPU6050_AFS_SEL0))
-#define MPU6050_AFS_SEL_2 (1 << (MPU6050_AFS_SEL1))
-#define MPU6050_AFS_SEL_3 (1 << (MPU6050_AFS_SEL1)|1 << (MPU6050_AFS_SEL0))
+#define MPU6050_AFS_SEL_1 (MPU6050_AFS_SEL0)
+#define MPU6050_AFS_SEL_2 (MPU6050_AFS_SEL1)
+#define MPU6050_AFS_SEL_3 (MPU6050_AFS_SEL1|MPU6050_AFS_SEL0)
 
 // Alternative names for the combined definitions
 // The name uses the full scale range for the accelerometer.
@@ -257,8 +263,7 @@
 #define MPU6050_AFS_SEL_16G MPU6050_AFS_SEL_3
 
 // FIFO_EN Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_SLV0_FIFO_EN  MPU6050_D0
 #define MPU6050_SLV1_FIFO_EN  MPU6050_D1
 #define MPU6050_SLV2_FIFO_EN  MPU6050_D2
@@ -269,8 +274,7 @@
 #define MPU6050_TEMP_FIFO_EN  MPU6050_D7
 
 // I2C_MST_CTRL Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_I2C_MST_CLK0  MPU6050_D0
 #define MPU6050_I2C_MST_CLK1  MPU6050_D1
 #define MPU6050_I2C_MST_CLK2  MPU6050_D2
@@ -282,21 +286,21 @@
 
 // Combined definitions for the I2C_MST_CLK
 #define MPU6050_I2C_MST_CLK_0 (0)
-#define MPU6050_I2C_MST_CLK_1  (1 << (MPU6050_I2C_MST_CLK0))
-#define MPU6050_I2C_MST_CLK_2  (1 << (MPU6050_I2C_MST_CLK1))
-#define MPU6050_I2C_MST_CLK_3  (1 << (MPU6050_I2C_MST_CLK1)|1 << (MPU6050_I2C_MST_CLK0))
-#define MPU6050_I2C_MST_CLK_4  (1 << (MPU6050_I2C_MST_CLK2))
-#define MPU6050_I2C_MST_CLK_5  (1 << (MPU6050_I2C_MST_CLK2)|1 << (MPU6050_I2C_MST_CLK0))
-#define MPU6050_I2C_MST_CLK_6  (1 << (MPU6050_I2C_MST_CLK2)|1 << (MPU6050_I2C_MST_CLK1))
-#define MPU6050_I2C_MST_CLK_7  (1 << (MPU6050_I2C_MST_CLK2)|1 << (MPU6050_I2C_MST_CLK1)|1 << (MPU6050_I2C_MST_CLK0))
-#define MPU6050_I2C_MST_CLK_8  (1 << (MPU6050_I2C_MST_CLK3))
-#define MPU6050_I2C_MST_CLK_9  (1 << (MPU6050_I2C_MST_CLK3)|1 << (MPU6050_I2C_MST_CLK0))
-#define MPU6050_I2C_MST_CLK_10 (1 << (MPU6050_I2C_MST_CLK3)|1 << (MPU6050_I2C_MST_CLK1))
-#define MPU6050_I2C_MST_CLK_11 (1 << (MPU6050_I2C_MST_CLK3)|1 << (MPU6050_I2C_MST_CLK1)|1 << (MPU6050_I2C_MST_CLK0))
-#define MPU6050_I2C_MST_CLK_12 (1 << (MPU6050_I2C_MST_CLK3)|1 << (MPU6050_I2C_MST_CLK2))
-#define MPU6050_I2C_MST_CLK_13 (1 << (MPU6050_I2C_MST_CLK3)|1 << (MPU6050_I2C_MST_CLK2)|1 << (MPU6050_I2C_MST_CLK0))
-#define MPU6050_I2C_MST_CLK_14 (1 << (MPU6050_I2C_MST_CLK3)|1 << (MPU6050_I2C_MST_CLK2)|1 << (MPU6050_I2C_MST_CLK1))
-#define MPU6050_I2C_MST_CLK_15 (1 << (MPU6050_I2C_MST_CLK3)|1 << (MPU6050_I2C_MST_CLK2)|1 << (MPU6050_I2C_MST_CLK1)|1 << (MPU6050_I2C_MST_CLK0))
+#define MPU6050_I2C_MST_CLK_1  (MPU6050_I2C_MST_CLK0)
+#define MPU6050_I2C_MST_CLK_2  (MPU6050_I2C_MST_CLK1)
+#define MPU6050_I2C_MST_CLK_3  (MPU6050_I2C_MST_CLK1|MPU6050_I2C_MST_CLK0)
+#define MPU6050_I2C_MST_CLK_4  (MPU6050_I2C_MST_CLK2)
+#define MPU6050_I2C_MST_CLK_5  (MPU6050_I2C_MST_CLK2|MPU6050_I2C_MST_CLK0)
+#define MPU6050_I2C_MST_CLK_6  (MPU6050_I2C_MST_CLK2|MPU6050_I2C_MST_CLK1)
+#define MPU6050_I2C_MST_CLK_7  (MPU6050_I2C_MST_CLK2|MPU6050_I2C_MST_CLK1|MPU6050_I2C_MST_CLK0)
+#define MPU6050_I2C_MST_CLK_8  (MPU6050_I2C_MST_CLK3)
+#define MPU6050_I2C_MST_CLK_9  (MPU6050_I2C_MST_CLK3|MPU6050_I2C_MST_CLK0)
+#define MPU6050_I2C_MST_CLK_10 (MPU6050_I2C_MST_CLK3|MPU6050_I2C_MST_CLK1)
+#define MPU6050_I2C_MST_CLK_11 (MPU6050_I2C_MST_CLK3|MPU6050_I2C_MST_CLK1|MPU6050_I2C_MST_CLK0)
+#define MPU6050_I2C_MST_CLK_12 (MPU6050_I2C_MST_CLK3|MPU6050_I2C_MST_CLK2)
+#define MPU6050_I2C_MST_CLK_13 (MPU6050_I2C_MST_CLK3|MPU6050_I2C_MST_CLK2|MPU6050_I2C_MST_CLK0)
+#define MPU6050_I2C_MST_CLK_14 (MPU6050_I2C_MST_CLK3|MPU6050_I2C_MST_CLK2|MPU6050_I2C_MST_CLK1)
+#define MPU6050_I2C_MST_CLK_15 (MPU6050_I2C_MST_CLK3|MPU6050_I2C_MST_CLK2|MPU6050_I2C_MST_CLK1|MPU6050_I2C_MST_CLK0)
 
 // Alternative names for the combined definitions
 // The names uses I2C Master Clock Speed in kHz.
@@ -318,13 +322,11 @@
 #define MPU6050_I2C_MST_CLK_364KHZ MPU6050_I2C_MST_CLK_15
 
 // I2C_SLV0_ADDR Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_I2C_SLV0_RW MPU6050_D7
 
 // I2C_SLV0_CTRL Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_I2C_SLV0_LEN0    MPU6050_D0
 #define MPU6050_I2C_SLV0_LEN1    MPU6050_D1
 #define MPU6050_I2C_SLV0_LEN2    MPU6050_D2
@@ -338,13 +340,11 @@
 #define MPU6050_I2C_SLV0_LEN_MASK 0x0F
 
 // I2C_SLV1_ADDR Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_I2C_SLV1_RW MPU6050_D7
 
 // I2C_SLV1_CTRL Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_I2C_SLV1_LEN0    MPU6050_D0
 #define MPU6050_I2C_SLV1_LEN1    MPU6050_D1
 #define MPU6050_I2C_SLV1_LEN2    MPU6050_D2
@@ -358,13 +358,11 @@
 #define MPU6050_I2C_SLV1_LEN_MASK 0x0F
 
 // I2C_SLV2_ADDR Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_I2C_SLV2_RW MPU6050_D7
 
 // I2C_SLV2_CTRL Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_I2C_SLV2_LEN0    MPU6050_D0
 #define MPU6050_I2C_SLV2_LEN1    MPU6050_D1
 #define MPU6050_I2C_SLV2_LEN2    MPU6050_D2
@@ -378,13 +376,11 @@
 #define MPU6050_I2C_SLV2_LEN_MASK 0x0F
 
 // I2C_SLV3_ADDR Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_I2C_SLV3_RW MPU6050_D7
 
 // I2C_SLV3_CTRL Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_I2C_SLV3_LEN0    MPU6050_D0
 #define MPU6050_I2C_SLV3_LEN1    MPU6050_D1
 #define MPU6050_I2C_SLV3_LEN2    MPU6050_D2
@@ -398,13 +394,11 @@
 #define MPU6050_I2C_SLV3_LEN_MASK 0x0F
 
 // I2C_SLV4_ADDR Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_I2C_SLV4_RW MPU6050_D7
 
 // I2C_SLV4_CTRL Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_I2C_MST_DLY0     MPU6050_D0
 #define MPU6050_I2C_MST_DLY1     MPU6050_D1
 #define MPU6050_I2C_MST_DLY2     MPU6050_D2
@@ -418,8 +412,7 @@
 #define MPU6050_I2C_MST_DLY_MASK 0x1F
 
 // I2C_MST_STATUS Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_I2C_SLV0_NACK MPU6050_D0
 #define MPU6050_I2C_SLV1_NACK MPU6050_D1
 #define MPU6050_I2C_SLV2_NACK MPU6050_D2
@@ -430,8 +423,7 @@
 #define MPU6050_PASS_THROUGH  MPU6050_D7
 
 // INT_PIN_CFG Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_CLKOUT_EN       MPU6050_D0
 #define MPU6050_I2C_BYPASS_EN   MPU6050_D1
 #define MPU6050_FSYNC_INT_EN    MPU6050_D2
@@ -442,8 +434,7 @@
 #define MPU6050_INT_LEVEL       MPU6050_D7
 
 // INT_ENABLE Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_DATA_RDY_EN    MPU6050_D0
 #define MPU6050_I2C_MST_INT_EN MPU6050_D3
 #define MPU6050_FIFO_OFLOW_EN  MPU6050_D4
@@ -452,8 +443,7 @@
 #define MPU6050_FF_EN          MPU6050_D7
 
 // INT_STATUS Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_DATA_RDY_INT   MPU6050_D0
 #define MPU6050_I2C_MST_INT    MPU6050_D3
 #define MPU6050_FIFO_OFLOW_INT MPU6050_D4
@@ -462,8 +452,7 @@
 #define MPU6050_FF_INT         MPU6050_D7
 
 // MOT_DETECT_STATUS Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_MOT_ZRMOT MPU6050_D0
 #define MPU6050_MOT_ZPOS  MPU6050_D2
 #define MPU6050_MOT_ZNEG  MPU6050_D3
@@ -473,8 +462,7 @@
 #define MPU6050_MOT_XNEG  MPU6050_D7
 
 // IC2_MST_DELAY_CTRL Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_I2C_SLV0_DLY_EN MPU6050_D0
 #define MPU6050_I2C_SLV1_DLY_EN MPU6050_D1
 #define MPU6050_I2C_SLV2_DLY_EN MPU6050_D2
@@ -483,15 +471,13 @@
 #define MPU6050_DELAY_ES_SHADOW MPU6050_D7
 
 // SIGNAL_PATH_RESET Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_TEMP_RESET  MPU6050_D0
 #define MPU6050_ACCEL_RESET MPU6050_D1
 #define MPU6050_GYRO_RESET  MPU6050_D2
 
 // MOT_DETECT_CTRL Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_MOT_COUNT0      MPU6050_D0
 #define MPU6050_MOT_COUNT1      MPU6050_D1
 #define MPU6050_FF_COUNT0       MPU6050_D2
@@ -501,27 +487,27 @@
 
 // Combined definitions for the MOT_COUNT
 #define MPU6050_MOT_COUNT_0 (0)
-#define MPU6050_MOT_COUNT_1 (1 << (MPU6050_MOT_COUNT0))
-#define MPU6050_MOT_COUNT_2 (1 << (MPU6050_MOT_COUNT1))
-#define MPU6050_MOT_COUNT_3 (1 << (MPU6050_MOT_COUNT1)|1 << (MPU6050_MOT_COUNT0))
+#define MPU6050_MOT_COUNT_1 (MPU6050_MOT_COUNT0)
+#define MPU6050_MOT_COUNT_2 (MPU6050_MOT_COUNT1)
+#define MPU6050_MOT_COUNT_3 (MPU6050_MOT_COUNT1|MPU6050_MOT_COUNT0)
 
 // Alternative names for the combined definitions
 #define MPU6050_MOT_COUNT_RESET MPU6050_MOT_COUNT_0
 
 // Combined definitions for the FF_COUNT
 #define MPU6050_FF_COUNT_0 (0)
-#define MPU6050_FF_COUNT_1 (1 << (MPU6050_FF_COUNT0))
-#define MPU6050_FF_COUNT_2 (1 << (MPU6050_FF_COUNT1))
-#define MPU6050_FF_COUNT_3 (1 << (MPU6050_FF_COUNT1)|1 << (MPU6050_FF_COUNT0))
+#define MPU6050_FF_COUNT_1 (MPU6050_FF_COUNT0)
+#define MPU6050_FF_COUNT_2 (MPU6050_FF_COUNT1)
+#define MPU6050_FF_COUNT_3 (MPU6050_FF_COUNT1|MPU6050_FF_COUNT0)
 
 // Alternative names for the combined definitions
 #define MPU6050_FF_COUNT_RESET MPU6050_FF_COUNT_0
 
 // Combined definitions for the ACCEL_ON_DELAY
 #define MPU6050_ACCEL_ON_DELAY_0 (0)
-#define MPU6050_ACCEL_ON_DELAY_1 (1 << (MPU6050_ACCEL_ON_DELAY0))
-#define MPU6050_ACCEL_ON_DELAY_2 (1 << (MPU6050_ACCEL_ON_DELAY1))
-#define MPU6050_ACCEL_ON_DELAY_3 (1 << (MPU6050_ACCEL_ON_DELAY1)|1 << (MPU6050_ACCEL_ON_DELAY0))
+#define MPU6050_ACCEL_ON_DELAY_1 (MPU6050_ACCEL_ON_DELAY0)
+#define MPU6050_ACCEL_ON_DELAY_2 (MPU6050_ACCEL_ON_DELAY1)
+#define MPU6050_ACCEL_ON_DELAY_3 (MPU6050_ACCEL_ON_DELAY1|MPU6050_ACCEL_ON_DELAY0)
 
 // Alternative names for the ACCEL_ON_DELAY
 #define MPU6050_ACCEL_ON_DELAY_0MS MPU6050_ACCEL_ON_DELAY_0
@@ -530,8 +516,7 @@
 #define MPU6050_ACCEL_ON_DELAY_3MS MPU6050_ACCEL_ON_DELAY_3
 
 // USER_CTRL Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_SIG_COND_RESET MPU6050_D0
 #define MPU6050_I2C_MST_RESET  MPU6050_D1
 #define MPU6050_FIFO_RESET     MPU6050_D2
@@ -540,8 +525,7 @@
 #define MPU6050_FIFO_EN        MPU6050_D6
 
 // PWR_MGMT_1 Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_CLKSEL0      MPU6050_D0
 #define MPU6050_CLKSEL1      MPU6050_D1
 #define MPU6050_CLKSEL2      MPU6050_D2
@@ -552,13 +536,13 @@
 
 // Combined definitions for the CLKSEL
 #define MPU6050_CLKSEL_0 (0)
-#define MPU6050_CLKSEL_1 (1 << (MPU6050_CLKSEL0))
-#define MPU6050_CLKSEL_2 (1 << (MPU6050_CLKSEL1))
-#define MPU6050_CLKSEL_3 (1 << (MPU6050_CLKSEL1)|1 << (MPU6050_CLKSEL0))
-#define MPU6050_CLKSEL_4 (1 << (MPU6050_CLKSEL2))
-#define MPU6050_CLKSEL_5 (1 << (MPU6050_CLKSEL2)|1 << (MPU6050_CLKSEL0))
-#define MPU6050_CLKSEL_6 (1 << (MPU6050_CLKSEL2)|1 << (MPU6050_CLKSEL1))
-#define MPU6050_CLKSEL_7 (1 << (MPU6050_CLKSEL2)|1 << (MPU6050_CLKSEL1)|1 << (MPU6050_CLKSEL0))
+#define MPU6050_CLKSEL_1 (MPU6050_CLKSEL0)
+#define MPU6050_CLKSEL_2 (MPU6050_CLKSEL1)
+#define MPU6050_CLKSEL_3 (MPU6050_CLKSEL1|MPU6050_CLKSEL0)
+#define MPU6050_CLKSEL_4 (MPU6050_CLKSEL2)
+#define MPU6050_CLKSEL_5 (MPU6050_CLKSEL2|MPU6050_CLKSEL0)
+#define MPU6050_CLKSEL_6 (MPU6050_CLKSEL2|MPU6050_CLKSEL1)
+#define MPU6050_CLKSEL_7 (MPU6050_CLKSEL2|MPU6050_CLKSEL1|MPU6050_CLKSEL0)
 
 // Alternative names for the combined definitions
 #define MPU6050_CLKSEL_INTERNAL    MPU6050_CLKSEL_0
@@ -571,8 +555,7 @@
 #define MPU6050_CLKSEL_STOP        MPU6050_CLKSEL_7
 
 // PWR_MGMT_2 Register
-// These are the names for the 1 << s.
-// Use these only with the 1 << () macro.
+// These are the masks for the bits (MPU6050_Dn), not bit numbers.
 #define MPU6050_STBY_ZG       MPU6050_D0
 #define MPU6050_STBY_YG       MPU6050_D1
 #define MPU6050_STBY_XG       MPU6050_D2
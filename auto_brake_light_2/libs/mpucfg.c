@@ -0,0 +1,60 @@
+/*
+ * mpucfg.c
+ *
+ *  MPU-6050 configuration shadow. See mpucfg.h.
+ */
+
+#include <mpucfg.h>
+#include <iic.h>
+
+// The blocks: first register, and first shadow index (the last entry
+// is the end of the shadow).
+static const char block_reg[3] = { MPU6050_SMPLRT_DIV, MPU6050_INT_PIN_CFG, MPU6050_MOT_DETECT_CTRL };
+static const unsigned char block_start[4] = { 0, MPUCFG_INDEX(MPU6050_INT_PIN_CFG), MPUCFG_INDEX(MPU6050_MOT_DETECT_CTRL), MPUCFG_SIZE };
+
+char mpu_shadow[MPUCFG_SIZE];
+static char dirty;		// bit per block
+
+void mpuCfgInit(void){
+	unsigned char i;
+
+	for (i = 0; i < MPUCFG_SIZE; i++){
+		mpu_shadow[i] = 0;
+	}
+	mpu_shadow[MPUCFG_INDEX(MPU6050_PWR_MGMT_1)] = MPU6050_SLEEP;	// power-on values
+	dirty = 7;
+}
+
+void mpuCfgSet(unsigned char index, char mask, char value){
+	char v = (mpu_shadow[index] & ~mask) | (value & mask);
+
+	if (v != mpu_shadow[index]){
+		mpu_shadow[index] = v;
+		dirty |= index < block_start[1] ? 1 : index < block_start[2] ? 2 : 4;
+	}
+}
+
+/*
+ * mpuCfgFlush
+ * One burst write of each block with a dirty register in it, the whole
+ * block; it is clean again unless the write failed. The clean registers
+ * that go out with it cost at most 9 bytes, ~11 ms on the bus, and the
+ * 10 register block only changes when the sensor is set up, with all of
+ * it dirty anyway. The governor's rate change rewrites 4 bytes for 1.
+ */
+char mpuCfgFlush(void){
+	unsigned char b, bit;
+	char n = 0;
+
+	for (b = 0, bit = 1; b < 3; b++, bit <<= 1){
+		if (dirty & bit){
+			iicWriteBurst(block_reg[b], &mpu_shadow[block_start[b]], block_start[b + 1] - block_start[b]);
+			n++;
+			if (iic_fault){
+				return n;
+			}
+			dirty &= ~bit;
+		}
+	}
+	return n;
+}
@@ -0,0 +1,79 @@
+/*
+ * mpucfg.h
+ *
+ *  RAM shadow of the MPU-6050 configuration registers.
+ *
+ *  Settings are changed field by field in the shadow (MPUCFG_FIELD, with
+ *  the field descriptors from mpufield.h) and go out with mpuCfgFlush():
+ *  one burst write per block with a dirty register, so a mode switch that
+ *  touches several registers costs one or two transactions instead of
+ *  one per register, and no read-modify-write. A set that does not
+ *  change the shadow does not dirty it.
+ *
+ *  Shadowed, in three blocks of consecutive addresses:
+ *    SMPLRT_DIV .. ZRMOT_DUR      (0x19 - 0x22: rate, DLPF, ranges, FF/MOT/ZRMOT)
+ *    INT_PIN_CFG, INT_ENABLE      (0x37 - 0x38)
+ *    MOT_DETECT_CTRL .. PWR_MGMT_2 (0x69 - 0x6C)
+ *  USER_CTRL is in the last block only so bursts can run through it.
+ *  The self-clearing reset bits (USER_CTRL, DEVICE_RESET) must not be
+ *  set through the shadow, or every later flush would reset again.
+ *
+ *  mpuCfgInit() loads the power-on values and marks everything dirty:
+ *  the MSP430 can reset without the sensor doing so, so the first flush
+ *  writes all of it (three bursts) rather than trusting the defaults.
+ */
+
+#ifndef MPUCFG_H_
+#define MPUCFG_H_
+
+#include <mpufield.h>
+
+#define MPUCFG_SIZE 16
+
+// Shadow index of a register. Only meaningful for shadowed registers.
+#define MPUCFG_SHADOWED(reg) \
+	(((reg) >= MPU6050_SMPLRT_DIV && (reg) <= MPU6050_ZRMOT_DUR) \
+	|| (reg) == MPU6050_INT_PIN_CFG || (reg) == MPU6050_INT_ENABLE \
+	|| ((reg) >= MPU6050_MOT_DETECT_CTRL && (reg) <= MPU6050_PWR_MGMT_2))
+#define MPUCFG_INDEX(reg) \
+	((reg) <= MPU6050_ZRMOT_DUR ? (reg) - MPU6050_SMPLRT_DIV \
+	: (reg) <= MPU6050_INT_ENABLE ? (reg) - MPU6050_INT_PIN_CFG + 10 \
+	: (reg) - MPU6050_MOT_DETECT_CTRL + 12)
+// Fails to compile for a constant register that is not shadowed.
+#define MPUCFG_CHECK(reg) (sizeof(char[MPUCFG_SHADOWED(reg) ? 1 : -1]) * 0)
+
+/*
+ * MPUCFG_SET(reg, mask, value)
+ * The bits of 'mask' in 'reg' become those of 'value' (already in
+ * position, like the mpu6050.h definitions). reg must be a constant.
+ */
+#define MPUCFG_SET(reg, mask, value) \
+	mpuCfgSet(MPUCFG_INDEX(reg) + MPUCFG_CHECK(reg), (mask), (value))
+
+/*
+ * MPUCFG_FIELD(f, v), MPUCFG_FIELD2(f1, v1, f2, v2)
+ * Field f (an MPU6050_F_ descriptor) becomes v. The register, mask and
+ * shift come from the descriptor, so this is one mpuCfgSet with constant
+ * arguments. Does not compile for a value that does not fit, a read-only
+ * field, an unshadowed register, or (FIELD2) two fields of different
+ * registers. FIELD2 is one call for two fields of the same register.
+ */
+#define MPUCFG_FIELD(f, v) \
+	MPUCFG_SET(MPUF_REG(f), MPUF_MASK(f), MPUF_VAL(f, v))
+#define MPUCFG_FIELD2(f1, v1, f2, v2) \
+	MPUCFG_SET(MPUF_REG(f1) + MPUCFG_SAME(f1, f2), MPUF_MASK(f1) | MPUF_MASK(f2), \
+		MPUF_VAL(f1, v1) | MPUF_VAL(f2, v2))
+#define MPUCFG_SAME(f1, f2) (sizeof(char[MPUF_REG(f1) == MPUF_REG(f2) ? 1 : -1]) * 0)
+
+#define MPUCFG_GET(reg) \
+	(mpu_shadow[MPUCFG_INDEX(reg) + MPUCFG_CHECK(reg)])
+
+extern char mpu_shadow[MPUCFG_SIZE];
+
+void mpuCfgInit(void);
+void mpuCfgSet(unsigned char index, char mask, char value);
+// Writes the dirty registers out. Returns the number of transactions.
+// A failed write (iic_fault) stays dirty for the next flush.
+char mpuCfgFlush(void);
+
+#endif /* MPUCFG_H_ */
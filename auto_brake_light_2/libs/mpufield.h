@@ -0,0 +1,141 @@
+/*
+ * mpufield.h
+ *
+ *  MPU-6050 register fields as compile-time descriptors.
+ *
+ *  A field is (register, shift, width, access):
+ *
+ *      #define MPU6050_F_DLPF_CFG (MPU6050_CONFIG, 0, 3, RW)
+ *
+ *  and everything else is derived from it with constant expressions, so
+ *  a field write is the same mask and shifted constant one would type by
+ *  hand, no table and no code:
+ *
+ *      MPUF_REG(f)          register address
+ *      MPUF_MASK(f)         the field's bits, in position
+ *      MPUF_VAL(f, v)       v shifted into position
+ *      MPUF_GET(f, regval)  the field out of a register value read back
+ *      MPUF_WRITABLE(f)     0, for use inside other checks
+ *
+ *  Misuse fails to compile:
+ *    - MPUF_VAL with a constant that does not fit the width (or is
+ *      negative): negative array size.
+ *    - MPUF_WRITABLE / MPUF_VAL on a read-only field: MPUF_ACCESS_R is
+ *      not defined.
+ *    - a field of one register applied to another: the register comes
+ *      from the descriptor, there is nothing to get wrong.
+ *    - a field name that does not exist: undefined identifier.
+ *  MPUF_VAL wants a constant v; a variable would compile (the check is
+ *  then a VLA) but must be range checked by the caller.
+ *
+ *  Single-bit fields have width 1 and take 0 or 1. For the shadowed
+ *  configuration registers, use MPUCFG_FIELD (mpucfg.h).
+ */
+
+#ifndef MPUFIELD_H_
+#define MPUFIELD_H_
+
+#include <mpu6050.h>
+
+// (register, shift, width, access)
+#define MPU6050_F_SMPLRT_DIV      (MPU6050_SMPLRT_DIV, 0, 8, RW)
+// CONFIG
+#define MPU6050_F_DLPF_CFG        (MPU6050_CONFIG, 0, 3, RW)
+#define MPU6050_F_EXT_SYNC_SET    (MPU6050_CONFIG, 3, 3, RW)
+// GYRO_CONFIG
+#define MPU6050_F_FS_SEL          (MPU6050_GYRO_CONFIG, 3, 2, RW)
+#define MPU6050_F_ZG_ST           (MPU6050_GYRO_CONFIG, 5, 1, RW)
+#define MPU6050_F_YG_ST           (MPU6050_GYRO_CONFIG, 6, 1, RW)
+#define MPU6050_F_XG_ST           (MPU6050_GYRO_CONFIG, 7, 1, RW)
+// ACCEL_CONFIG
+#define MPU6050_F_ACCEL_HPF       (MPU6050_ACCEL_CONFIG, 0, 3, RW)
+#define MPU6050_F_AFS_SEL         (MPU6050_ACCEL_CONFIG, 3, 2, RW)
+#define MPU6050_F_ZA_ST           (MPU6050_ACCEL_CONFIG, 5, 1, RW)
+#define MPU6050_F_YA_ST           (MPU6050_ACCEL_CONFIG, 6, 1, RW)
+#define MPU6050_F_XA_ST           (MPU6050_ACCEL_CONFIG, 7, 1, RW)
+// Free fall, motion, zero motion
+#define MPU6050_F_FF_THR          (MPU6050_FF_THR, 0, 8, RW)
+#define MPU6050_F_FF_DUR          (MPU6050_FF_DUR, 0, 8, RW)
+#define MPU6050_F_MOT_THR         (MPU6050_MOT_THR, 0, 8, RW)
+#define MPU6050_F_MOT_DUR         (MPU6050_MOT_DUR, 0, 8, RW)
+#define MPU6050_F_ZRMOT_THR       (MPU6050_ZRMOT_THR, 0, 8, RW)
+#define MPU6050_F_ZRMOT_DUR       (MPU6050_ZRMOT_DUR, 0, 8, RW)
+// FIFO_EN (not shadowed by mpucfg.h: written once, directly)
+#define MPU6050_F_ACCEL_FIFO_EN   (MPU6050_FIFO_ENABLE, 3, 1, RW)
+#define MPU6050_F_TEMP_FIFO_EN    (MPU6050_FIFO_ENABLE, 7, 1, RW)
+// INT_PIN_CFG
+#define MPU6050_F_CLKOUT_EN       (MPU6050_INT_PIN_CFG, 0, 1, RW)
+#define MPU6050_F_I2C_BYPASS_EN   (MPU6050_INT_PIN_CFG, 1, 1, RW)
+#define MPU6050_F_FSYNC_INT_EN    (MPU6050_INT_PIN_CFG, 2, 1, RW)
+#define MPU6050_F_FSYNC_INT_LEVEL (MPU6050_INT_PIN_CFG, 3, 1, RW)
+#define MPU6050_F_INT_RD_CLEAR    (MPU6050_INT_PIN_CFG, 4, 1, RW)
+#define MPU6050_F_LATCH_INT_EN    (MPU6050_INT_PIN_CFG, 5, 1, RW)
+#define MPU6050_F_INT_OPEN        (MPU6050_INT_PIN_CFG, 6, 1, RW)
+#define MPU6050_F_INT_LEVEL       (MPU6050_INT_PIN_CFG, 7, 1, RW)
+// INT_ENABLE
+#define MPU6050_F_DATA_RDY_EN     (MPU6050_INT_ENABLE, 0, 1, RW)
+#define MPU6050_F_I2C_MST_INT_EN  (MPU6050_INT_ENABLE, 3, 1, RW)
+#define MPU6050_F_FIFO_OFLOW_EN   (MPU6050_INT_ENABLE, 4, 1, RW)
+#define MPU6050_F_ZMOT_EN         (MPU6050_INT_ENABLE, 5, 1, RW)
+#define MPU6050_F_MOT_EN          (MPU6050_INT_ENABLE, 6, 1, RW)
+#define MPU6050_F_FF_EN           (MPU6050_INT_ENABLE, 7, 1, RW)
+// INT_STATUS
+#define MPU6050_F_DATA_RDY_INT    (MPU6050_INT_STATUS, 0, 1, R)
+#define MPU6050_F_I2C_MST_INT     (MPU6050_INT_STATUS, 3, 1, R)
+#define MPU6050_F_FIFO_OFLOW_INT  (MPU6050_INT_STATUS, 4, 1, R)
+#define MPU6050_F_ZMOT_INT        (MPU6050_INT_STATUS, 5, 1, R)
+#define MPU6050_F_MOT_INT         (MPU6050_INT_STATUS, 6, 1, R)
+#define MPU6050_F_FF_INT          (MPU6050_INT_STATUS, 7, 1, R)
+// MOT_DETECT_CTRL
+#define MPU6050_F_MOT_COUNT       (MPU6050_MOT_DETECT_CTRL, 0, 2, RW)
+#define MPU6050_F_FF_COUNT        (MPU6050_MOT_DETECT_CTRL, 2, 2, RW)
+#define MPU6050_F_ACCEL_ON_DELAY  (MPU6050_MOT_DETECT_CTRL, 4, 2, RW)
+// USER_CTRL
+#define MPU6050_F_SIG_COND_RESET  (MPU6050_USER_CTRL, 0, 1, RW)
+#define MPU6050_F_I2C_MST_RESET   (MPU6050_USER_CTRL, 1, 1, RW)
+#define MPU6050_F_FIFO_RESET      (MPU6050_USER_CTRL, 2, 1, RW)
+#define MPU6050_F_I2C_IF_DIS      (MPU6050_USER_CTRL, 4, 1, RW)
+#define MPU6050_F_I2C_MST_EN      (MPU6050_USER_CTRL, 5, 1, RW)
+#define MPU6050_F_FIFO_EN         (MPU6050_USER_CTRL, 6, 1, RW)
+// PWR_MGMT_1
+#define MPU6050_F_CLKSEL          (MPU6050_PWR_MGMT_1, 0, 3, RW)
+#define MPU6050_F_TEMP_DIS        (MPU6050_PWR_MGMT_1, 3, 1, RW)
+#define MPU6050_F_CYCLE           (MPU6050_PWR_MGMT_1, 5, 1, RW)
+#define MPU6050_F_SLEEP           (MPU6050_PWR_MGMT_1, 6, 1, RW)
+#define MPU6050_F_DEVICE_RESET    (MPU6050_PWR_MGMT_1, 7, 1, RW)
+// PWR_MGMT_2
+#define MPU6050_F_STBY_ZG         (MPU6050_PWR_MGMT_2, 0, 1, RW)
+#define MPU6050_F_STBY_YG         (MPU6050_PWR_MGMT_2, 1, 1, RW)
+#define MPU6050_F_STBY_XG         (MPU6050_PWR_MGMT_2, 2, 1, RW)
+#define MPU6050_F_STBY_ZA         (MPU6050_PWR_MGMT_2, 3, 1, RW)
+#define MPU6050_F_STBY_YA         (MPU6050_PWR_MGMT_2, 4, 1, RW)
+#define MPU6050_F_STBY_XA         (MPU6050_PWR_MGMT_2, 5, 1, RW)
+#define MPU6050_F_LP_WAKE_CTRL    (MPU6050_PWR_MGMT_2, 6, 2, RW)
+// WHO_AM_I
+#define MPU6050_F_WHO_AM_I        (MPU6050_WHO_AM_I, 1, 6, R)
+
+// The descriptor is an argument list; MPUF_APPLY hands it to one of the
+// picker macros below (the extra level lets f expand first).
+#define MPUF_APPLY(m, args) m args
+#define MPUF_REG_(reg, shift, width, access)   (reg)
+#define MPUF_SHIFT_(reg, shift, width, access) (shift)
+#define MPUF_WIDTH_(reg, shift, width, access) (width)
+#define MPUF_ACCESS_(reg, shift, width, access) MPUF_ACCESS_##access
+
+#define MPUF_ACCESS_RW 0
+// MPUF_ACCESS_R is deliberately left undefined.
+
+#define MPUF_REG(f)      MPUF_APPLY(MPUF_REG_, f)
+#define MPUF_SHIFT(f)    MPUF_APPLY(MPUF_SHIFT_, f)
+#define MPUF_WIDTH(f)    MPUF_APPLY(MPUF_WIDTH_, f)
+#define MPUF_WRITABLE(f) MPUF_APPLY(MPUF_ACCESS_, f)
+
+#define MPUF_MAX(f)  ((1 << MPUF_WIDTH(f)) - 1)
+#define MPUF_MASK(f) ((char)(MPUF_MAX(f) << MPUF_SHIFT(f)))
+// Fails to compile for a constant v that does not fit the field.
+#define MPUF_FITS(f, v) (sizeof(char[(v) >= 0 && (v) <= MPUF_MAX(f) ? 1 : -1]) * 0)
+#define MPUF_VAL(f, v) \
+	((char)(((v) << MPUF_SHIFT(f)) + MPUF_FITS(f, v) + MPUF_WRITABLE(f)))
+#define MPUF_GET(f, regval) (((unsigned char)(regval) >> MPUF_SHIFT(f)) & MPUF_MAX(f))
+
+#endif /* MPUFIELD_H_ */
@@ -50,6 +50,12 @@ LED definitions
 #define SDA_PIN BIT7
 #define ACCEL_INT BIT0
 
+// Spare pins
+// P1.5 is also TA0.0, so Timer_A can drive it directly.
+#define TELEMETRY_PIN BIT5	// software UART TX, see suart.h
+// P2.6/P2.7 are the crystal pins, GPIO with P2SEL cleared (no crystal fitted).
+#define PROBE_PIN BIT6		// P2.6, latency probe, see probe.h
+
 // some macros to make life a little easier.
 // To reduce the chance of unexpected behaviour, 
 // do not use these macros on the same line as other code.
@@ -0,0 +1,47 @@
+/*
+ * probe.h
+ *
+ *  Latency probe.
+ *
+ *  With LATENCY_PROBE set, PROBE_PIN (P2.6, see pcbv1.h) marks each
+ *  stage of the path from ACCEL_INT to the LEDs, so a scope on P1.0 and
+ *  P2.6 shows where the time goes. Each mark is a single BIS/XOR/BIC on
+ *  P2OUT (4 to 5 cycles). tools/latency finds the same edges in the
+ *  simulator and reports min/mean/max per stage.
+ *
+ *  Edges, per sample:
+ *  0. rise: PORT1 ISR entered
+ *  1. main() awake again
+ *  2. readAccel() done
+ *  3. detectStep() done (includes any pitch/temperature update)
+ *  4. LEDs set
+ *  5. fall: loop done, about to sleep
+ *
+ *  Every pass of the loop toggles 1 to 4, a failed read too (3 and 4
+ *  back to back), so a sample always gives six edges. A watchdog wake
+ *  has no ISR and no 0: its four toggles leave the pin low again, and
+ *  tools/latency only opens a record on the rise that follows ACCEL_INT.
+ */
+
+#ifndef PROBE_H_
+#define PROBE_H_
+
+#include <pcbv1.h>
+
+#ifndef LATENCY_PROBE
+#define LATENCY_PROBE 0
+#endif
+
+#if LATENCY_PROBE
+#define PROBE_INIT()	(P2DIR |= PROBE_PIN, P2OUT &= ~PROBE_PIN)
+#define PROBE_START()	(P2OUT |= PROBE_PIN)
+#define PROBE_MARK()	(P2OUT ^= PROBE_PIN)
+#define PROBE_END()		(P2OUT &= ~PROBE_PIN)
+#else
+#define PROBE_INIT()
+#define PROBE_START()
+#define PROBE_MARK()
+#define PROBE_END()
+#endif
+
+#endif /* PROBE_H_ */
@@ -0,0 +1,222 @@
+/*
+ * ridelog.c
+ *
+ *  On-device ride log. See ridelog.h for the format.
+ */
+
+#include <ridelog.h>
+
+#include <msp430.h>
+
+#if RIDELOG
+
+// Pre-trigger ring. head and tail run freely; the ring size is a power
+// of two, so (head - tail) is the fill level and masking gives the index.
+static unsigned char ring[RIDELOG_RING];
+static unsigned char head, tail;
+static int base_x, base_y, base_z;	// sample just before the oldest one in the ring
+static int last_x, last_y, last_z;	// newest sample in the ring
+
+static unsigned char *wp;		// flash write pointer
+static unsigned char seg_seq;	// seq byte of the segment wp is in
+
+static unsigned char putVarint(unsigned char *out, int d);
+static int ringVarint(void);
+static void logByte(unsigned char b, unsigned char left, unsigned char len);
+static void segStart(unsigned char seg, unsigned char first);
+static void flashErase(unsigned char *seg);
+static void flashWrite(unsigned char *dst, const unsigned char *src, unsigned char n);
+
+#define SEG(i) ((unsigned char *)RIDELOG_SEG_FIRST + (i) * RIDELOG_SEG_SIZE)
+#define SEG_END(p) ((unsigned char *)(((unsigned int)(p) | (RIDELOG_SEG_SIZE - 1)) + 1))
+#define RING_AT(i) ring[(unsigned char)(i) & (RIDELOG_RING - 1)]
+
+/*
+ * ridelogInit
+ * Finds the end of the log in flash.
+ * Flow:
+ * 1. The newest segment is the one whose successor is not seq + 1.
+ * 2. Walk its records by length from 'first' up to the first erased
+ *    byte. A record that runs past the end would have started the next
+ *    segment, so it can only be one cut short by a reset: the next
+ *    commit moves on to a new segment. So does anything that is not a
+ *    record (a length under RIDELOG_HEADER, e.g. flash some other
+ *    firmware left behind), rather than walking it forever.
+ * 3. No valid segment at all: start a fresh log in segment D.
+ */
+void ridelogInit(void){
+	unsigned char i;
+
+	head = tail = 0;
+	base_x = base_y = base_z = last_x = last_y = last_z = 0;
+
+	for (i = 0; i < RIDELOG_SEGS; i++){
+		unsigned char s = SEG(i)[0];
+		unsigned char n = SEG(i + 1 == RIDELOG_SEGS ? 0 : i + 1)[0];
+
+		if (s != 0xFF && n != (s == 254 ? 0 : s + 1)){
+			seg_seq = s;
+			wp = SEG(i) + SEG(i)[1];
+			if (wp < SEG(i) + RIDELOG_SEG_HEADER){
+				wp = SEG(i + 1);
+			}
+			while (wp < SEG(i + 1) && *wp != 0xFF){
+				if (*wp < RIDELOG_HEADER){
+					wp = SEG(i + 1);	// not a record: never written by us
+					break;
+				}
+				wp += *wp;
+			}
+			if (wp > SEG(i + 1)){
+				wp = SEG(i + 1);
+			}
+			return;
+		}
+	}
+
+	seg_seq = 254;		// segStart() bumps it to 0
+	segStart(0, RIDELOG_SEG_HEADER);
+}
+
+/*
+ * ridelogSample
+ * Appends one sample to the pre-trigger ring.
+ * Flow:
+ * 1. Encode the deltas from the previous sample (at most 9 bytes).
+ * 2. Drop the oldest samples until there is room, folding their deltas
+ *    into the base so that the ring can still be decoded.
+ * 3. Copy the encoded sample in.
+ */
+void ridelogSample(int x, int y, int z){
+	unsigned char buf[9];
+	unsigned char n, i;
+
+	n = putVarint(buf, x - last_x);
+	n += putVarint(buf + n, y - last_y);
+	n += putVarint(buf + n, z - last_z);
+	last_x = x;
+	last_y = y;
+	last_z = z;
+
+	while ((unsigned char)(RIDELOG_RING - (unsigned char)(head - tail)) < n){
+		base_x += ringVarint();
+		base_y += ringVarint();
+		base_z += ringVarint();
+	}
+	for (i = 0; i < n; i++){
+		RING_AT(head++) = buf[i];
+	}
+}
+
+/*
+ * ridelogCommit
+ * Appends the current window to the record stream in flash: the header,
+ * then the ring contents oldest first. Called on entering DETECT_BRAKE.
+ * The CPU is held while the flash is busy (about 14.5 ms for the erase
+ * when the record starts a new segment, ~90 us a byte otherwise), so
+ * call this after the LEDs are set.
+ */
+void ridelogCommit(void){
+	unsigned char hdr[RIDELOG_HEADER];
+	unsigned char len = RIDELOG_HEADER + (unsigned char)(head - tail);
+	unsigned char left = len;
+	unsigned char i;
+
+	hdr[0] = len;
+	hdr[1] = base_x;
+	hdr[2] = base_x >> 8;
+	hdr[3] = base_y;
+	hdr[4] = base_y >> 8;
+	hdr[5] = base_z;
+	hdr[6] = base_z >> 8;
+	for (i = 0; i < RIDELOG_HEADER; i++){
+		logByte(hdr[i], left--, len);
+	}
+	for (i = tail; i != head; i++){
+		logByte(RING_AT(i), left--, len);
+	}
+}
+
+/*
+ * logByte
+ * Writes one byte of a record of 'len' bytes, 'left' of them still to
+ * go (this one included). At the end of a segment, starts the next one
+ * first; its 'first' skips what is left of a record already under way.
+ */
+static void logByte(unsigned char b, unsigned char left, unsigned char len){
+	if (wp == SEG_END(wp - 1)){
+		unsigned char next = ((unsigned int)(wp - 1) - RIDELOG_SEG_FIRST) / RIDELOG_SEG_SIZE + 1;
+
+		if (next == RIDELOG_SEGS){
+			next = 0;
+		}
+		segStart(next, RIDELOG_SEG_HEADER + (left == len ? 0 : left));
+	}
+	flashWrite(wp++, &b, 1);
+}
+
+// Erases segment 'seg' (the oldest) and starts it with the next seq.
+static void segStart(unsigned char seg, unsigned char first){
+	unsigned char hdr[RIDELOG_SEG_HEADER];
+
+	seg_seq = (seg_seq == 254) ? 0 : seg_seq + 1;
+	hdr[0] = seg_seq;
+	hdr[1] = first;
+	flashErase(SEG(seg));
+	flashWrite(SEG(seg), hdr, RIDELOG_SEG_HEADER);
+	wp = SEG(seg) + RIDELOG_SEG_HEADER;
+}
+
+/*
+ * putVarint
+ * Zigzag (so small negative deltas stay small) then 7 bits per byte,
+ * high bit set on all but the last byte. Returns the byte count.
+ */
+static unsigned char putVarint(unsigned char *out, int d){
+	unsigned int v = ((unsigned int)d << 1) ^ (unsigned int)(d >> 15);
+	unsigned char n = 0;
+
+	while (v >= 0x80){
+		out[n++] = v | 0x80;
+		v >>= 7;
+	}
+	out[n++] = v;
+	return n;
+}
+
+// Takes one varint off the tail of the ring.
+static int ringVarint(void){
+	unsigned int v = 0;
+	unsigned char shift = 0;
+	unsigned char b;
+
+	do {
+		b = RING_AT(tail++);
+		v |= (unsigned int)(b & 0x7F) << shift;
+		shift += 7;
+	} while (b & 0x80);
+
+	return (int)(v >> 1) ^ -(int)(v & 1);
+}
+
+static void flashErase(unsigned char *seg){
+	FCTL2 = FWKEY + FSSEL_1 + FN1;		// MCLK/3, ~333 kHz flash clock
+	FCTL1 = FWKEY + ERASE;
+	FCTL3 = FWKEY;						// unlock (LOCKA stays set)
+	*seg = 0;							// dummy write starts the erase
+	FCTL1 = FWKEY;
+	FCTL3 = FWKEY + LOCK;
+}
+
+static void flashWrite(unsigned char *dst, const unsigned char *src, unsigned char n){
+	FCTL2 = FWKEY + FSSEL_1 + FN1;
+	FCTL3 = FWKEY;
+	FCTL1 = FWKEY + WRT;
+	while (n--){
+		*dst++ = *src++;
+	}
+	FCTL1 = FWKEY;
+	FCTL3 = FWKEY + LOCK;
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * ridelog.h
+ *
+ *  On-device ride log, for capturing real data to tune thresholds with.
+ *
+ *  Every sample that readAccel() returns goes into a small pre-trigger
+ *  ring in RAM, delta and varint encoded (the axes change slowly, so most
+ *  samples take 3 or 4 bytes instead of 6). When the detector enters
+ *  DETECT_BRAKE the window is committed to the information memory
+ *  segments B-D. Segment A holds the DCO calibration and is never
+ *  touched.
+ *
+ *  Flash layout, per 64 byte segment:
+ *    [seq] [first] [bytes of the record stream ...] [0xFF...]
+ *  The records are one stream across the segments: a record that does
+ *  not fit carries on in the next segment, so a segment is only erased
+ *  once the one before it is full (no padding). seq counts up (mod 255)
+ *  each time a segment is erased and started, so the newest segment can
+ *  be found at reset; first is the offset of the first record that
+ *  starts in the segment (after the tail of one carried over). Records:
+ *    [len] [base x lo, hi] [base y lo, hi] [base z lo, hi] [deltas...]
+ *  where len counts the whole record and the deltas are zigzag varints,
+ *  x, y then z for each sample, relative to the previous sample (the
+ *  first relative to base). tools/logdump decodes a dump of the region
+ *  back into a trace.
+ *
+ *  Wear: an erase per RIDELOG_SEG_DATA bytes logged, spread over the
+ *  three segments, each good for about 10k erases. On the ridegen
+ *  corpora the LOGGER build enters DETECT_BRAKE ~260 times an hour on
+ *  mixed riding and ~1000 on cobbles (false triggers included), with
+ *  ~20 byte records. Mixed riding is ~28 erases per segment per hour,
+ *  ~360 hours of riding; cobbles are ~110 per segment per hour, ~90
+ *  hours. The log holds the last 7 to 9 windows.
+ *
+ *  Cost, from tools/cyclebench.sh on LOGGER against LOGGER with
+ *  RIDELOG 0 (the bench with the log is over 2 KB, so build it for a
+ *  larger part of the same CPU: MCU=msp430g2553): ridelogSample() is
+ *  556 cycles a sample on average, and the bench as a whole 627 more a
+ *  sample with its 4 commits in. A commit is ~1740 cycles of CPU, plus the
+ *  flash hold: ~90 us per byte written, and 4819 flash clocks (~14.5 ms
+ *  at MCLK/3) for the segment erase when the record starts a new one.
+ *  The worst case, a 23 byte record that crosses into a new segment, is
+ *  ~18.5 ms on the brake onset sample, after the LEDs are set. Built
+ *  with a clang/LLVM 14 MSP430 compiler in place of msp430-elf-gcc;
+ *  re-run with it.
+ *
+ *  Off by default: it costs RIDELOG_RING + 17 bytes of RAM and wears the
+ *  flash. Build with RIDELOG 1 for data capture rides.
+ */
+
+#ifndef RIDELOG_H_
+#define RIDELOG_H_
+
+#include <config.h>
+
+#ifndef RIDELOG_RING
+#define RIDELOG_RING 16		// bytes of encoded history, power of two
+#endif
+
+#define RIDELOG_SEG_FIRST 0x1000	// information memory segment D
+#define RIDELOG_SEG_SIZE 64
+#define RIDELOG_SEGS 3				// D, C, B
+#define RIDELOG_SEG_HEADER 2		// seq, first
+#define RIDELOG_SEG_DATA (RIDELOG_SEG_SIZE - RIDELOG_SEG_HEADER)
+#define RIDELOG_HEADER 7			// len, base x, y, z
+
+// A record never covers a whole segment, so every segment after the
+// first has a record start ('first').
+#if RIDELOG_RING & (RIDELOG_RING - 1) || RIDELOG_HEADER + RIDELOG_RING >= RIDELOG_SEG_DATA
+#error RIDELOG_RING must be a power of two, with a record shorter than a segment
+#endif
+
+void ridelogInit(void);
+void ridelogSample(int x, int y, int z);
+void ridelogCommit(void);
+
+#endif /* RIDELOG_H_ */
@@ -0,0 +1,146 @@
+/*
+ * suart.c
+ *
+ *  Timer_A driven software UART, TX only. See suart.h.
+ *
+ *  Uses TIMERA0_VECTOR.
+ *  Based on the bit engine in TI's msp430g2xx1_ta_uart9600.c example.
+ */
+
+#include <suart.h>
+
+#include <msp430.h>
+#include <pcbv1.h>
+
+#if TELEMETRY
+
+static unsigned char frames[2][TEL_FRAME];
+static unsigned char fill;					// buffer main() fills next
+static volatile char pending;				// frames[fill] is queued behind the one on the wire
+static volatile char busy;					// a frame is on the wire
+static volatile char idle;					// main() is in suartSleep()
+static unsigned char *tx_ptr;				// next byte to load
+static unsigned char tx_left;				// bytes left after the current one
+static unsigned int tx_shift;				// current byte with start and stop bits
+static unsigned char tx_bits;				// bits left in tx_shift
+
+static void startFrame(unsigned char buf);
+
+void suartInit(void){
+	CCTL0 = OUT;						// idle high, output mode 0
+	P1SEL |= TELEMETRY_PIN;				// TA0.0 on the pin
+	P1DIR |= TELEMETRY_PIN;
+	fill = 0;
+	pending = 0;
+	busy = 0;
+}
+
+unsigned char *suartBuffer(void){
+	if (pending){
+		return 0;	// one on the wire, one waiting: drop this one
+	}
+	return frames[fill];
+}
+
+/*
+ * suartQueue
+ * Hands frames[fill] over to the ISR.
+ * Flow:
+ * 1. If nothing is on the wire, start sending it now.
+ * 2. Otherwise mark it pending; the ISR starts it when the current
+ *    frame is done.
+ * 3. Either way, main() fills the other buffer next time.
+ */
+void suartQueue(void){
+	unsigned short sr = __get_SR_register() & GIE;
+
+	_BIC_SR(GIE);
+	if (busy){
+		pending = 1;
+	} else {
+		startFrame(fill);
+		fill ^= 1;
+	}
+	_BIS_SR(sr);
+}
+
+char suartBusy(void){
+	return busy;
+}
+
+/*
+ * suartSleep
+ * The main loop's sleep: LPM0 while a frame is going out, LPM3 otherwise.
+ * Returns with interrupts on. Other LPM0 waits (the I2C transfers) must
+ * keep SMCLK, so the ISR only deepens this one, and not if the caller
+ * needs SMCLK itself (keep_smclk).
+ */
+void suartSleep(char keep_smclk){
+	_BIC_SR(GIE);
+	idle = !keep_smclk;
+	if (busy || keep_smclk){
+		_BIS_SR(LPM0_bits + GIE);
+	} else {
+		_BIS_SR(LPM3_bits + GIE);
+	}
+	idle = 0;
+}
+
+static void loadByte(void){
+	tx_shift = ((unsigned int)*tx_ptr++ | 0x100) << 1;	// stop bit, byte, start bit
+	tx_bits = 10;
+}
+
+static void startFrame(unsigned char buf){
+	tx_ptr = frames[buf];
+	tx_left = TEL_FRAME - 1;
+	loadByte();
+	busy = 1;
+	CCR0 = TAR + SUART_BIT_TIME;
+	CCTL0 = OUTMOD_1 + CCIE;			// first compare just sets (keeps idle high)
+}
+
+/*
+ * Timer A0 ISR
+ * Schedules the next bit edge.
+ * Flow:
+ * 1. Move the compare on by one bit time.
+ * 2. Byte finished: load the next one, or the next frame, or stop
+ *    (and deepen the sleep to LPM3 now that SMCLK is not needed).
+ * 3. Output mode set (1) or reset (5) so the pin changes at the compare.
+ */
+#pragma vector=TIMERA0_VECTOR
+__interrupt void TIMERA0(void){
+	CCR0 += SUART_BIT_TIME;
+
+	if (tx_bits == 0){
+		if (tx_left){
+			tx_left--;
+			loadByte();
+		} else if (pending){
+			pending = 0;
+			tx_ptr = frames[fill];
+			tx_left = TEL_FRAME - 1;
+			fill ^= 1;
+			loadByte();
+		} else {
+			busy = 0;
+			CCTL0 = OUT;				// stop bit has gone out, line idles high
+			// If main() is asleep in LPM0 waiting for us, let it drop to LPM3.
+			if (idle && (__get_SR_register_on_exit() & CPUOFF)){
+				__bis_SR_register_on_exit(SCG1 + SCG0);
+			}
+			return;
+		}
+	}
+
+	if (tx_shift & 0x01){
+		CCTL0 &= ~OUTMOD2;				// OUTMOD_1: set
+	} else {
+		CCTL0 |= OUTMOD2;				// OUTMOD_5: reset
+	}
+	tx_shift >>= 1;
+	tx_bits--;
+}
+
+#endif
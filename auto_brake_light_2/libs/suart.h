@@ -0,0 +1,36 @@
+/*
+ * suart.h
+ *
+ *  TX-only software UART, 8N1, on TELEMETRY_PIN (P1.5, which is also the
+ *  TA0.0 output). Bit edges are produced by the Timer_A CCR0 output unit,
+ *  so they land on the exact compare value no matter how late the ISR
+ *  gets to run; the ISR only has to set up the next bit within one bit
+ *  time.
+ *
+ *  Frames are double-buffered: fill the buffer from suartBuffer() and
+ *  hand it over with suartQueue(). One frame can be on the wire while
+ *  the next is being filled. If both buffers are busy, suartBuffer()
+ *  returns 0 and the caller drops the frame: sending never blocks.
+ *
+ *  Timer_A must be running from SMCLK in continuous mode, and SMCLK must
+ *  stay on while suartBusy(), i.e. sleep in LPM0 rather than LPM3.
+ *  suartSleep() is the idle sleep that does this; the ISR deepens it to
+ *  LPM3 when the last frame is out (unless told SMCLK is needed anyway),
+ *  and leaves any other sleep alone.
+ */
+
+#ifndef SUART_H_
+#define SUART_H_
+
+#include <telemetry.h>
+
+#define SUART_BAUD 9600
+#define SUART_BIT_TIME (1000000 / SUART_BAUD)	// SMCLK ticks per bit, 1 MHz DCO
+
+void suartInit(void);
+unsigned char *suartBuffer(void);
+void suartQueue(void);
+char suartBusy(void);
+void suartSleep(char keep_smclk);
+
+#endif /* SUART_H_ */
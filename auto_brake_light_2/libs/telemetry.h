@@ -0,0 +1,49 @@
+/*
+ * telemetry.h
+ *
+ *  Telemetry frame layout, shared between the firmware (main.c) and the
+ *  host-side decoder (tools/teldec.c).
+ *
+ *  One frame per sample, sent by the software UART (suart.c).
+ *  All words are 16 bit two's complement, little endian.
+ *
+ *  Offset	Field
+ *  0		TEL_SYNC
+ *  1		sequence number, +1 per frame sent (gaps mean dropped frames)
+ *  2-3		raw x
+ *  4-5		raw y
+ *  6-7		raw z
+ *  8-9		compensated z (detectStep() output)
+ *  10-11	smoothed z (detect_state.cur_z)
+ *  12		detector state (DETECT_BRAKE / DETECT_IDLE)
+ *  13		frames dropped since the last one sent (saturates at 255)
+ *  14-15	awake cycles for this sample: SMCLK ticks from wake-up to send
+ *  16-17	last raw TEMP_OUT reading, TEL_NO_TEMP without TEMP_COMP
+ *  18		checksum: all 19 bytes sum to 0 mod 256
+ *
+ *  A recording at rest with TEMP_COMP on is what tools/tempcal fits the
+ *  temperature drift from (tempcomp.h).
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <config.h>
+
+#define TEL_SYNC 0xA5
+#define TEL_FRAME 19
+#define TEL_NO_TEMP (-32768)
+
+#define TEL_SEQ 1
+#define TEL_RAW_X 2
+#define TEL_RAW_Y 4
+#define TEL_RAW_Z 6
+#define TEL_COMP_Z 8
+#define TEL_CUR_Z 10
+#define TEL_STATE 12
+#define TEL_DROPPED 13
+#define TEL_CYCLES 14
+#define TEL_TEMP 16
+#define TEL_CHECKSUM 18
+
+#endif /* TELEMETRY_H_ */
@@ -0,0 +1,60 @@
+/*
+ * tempcomp.c
+ *
+ *  Temperature compensation tables and lookup. See tempcomp.h.
+ */
+
+#include <tempcomp.h>
+
+#if TEMP_COMP
+
+// Index of the table point nearest the calibration temperature.
+#define TEMPCOMP_REF ((MPU6050_TEMP_RAW(TEMPCOMP_REF_C) - TEMPCOMP_BASE + (TEMPCOMP_STEP >> 1)) >> TEMPCOMP_SHIFT)
+#define TC(i, drift) (((i) - TEMPCOMP_REF) * (drift))
+#define TC_TABLE(drift) { \
+	TC(0, drift), TC(1, drift), TC(2, drift), TC(3, drift), \
+	TC(4, drift), TC(5, drift), TC(6, drift), TC(7, drift), \
+	TC(8, drift), TC(9, drift), TC(10, drift), TC(11, drift) }
+
+const dev_int tempcomp_x[TEMPCOMP_POINTS] = TC_TABLE(TEMPCOMP_X_DRIFT);
+#if CORNER_REJECT
+const dev_int tempcomp_y[TEMPCOMP_POINTS] = TC_TABLE(TEMPCOMP_Y_DRIFT);
+#endif
+const dev_int tempcomp_z[TEMPCOMP_POINTS] = TC_TABLE(TEMPCOMP_Z_DRIFT);
+
+/*
+ * tempcompOffset
+ * Looks up the offset for a raw temperature reading.
+ * Flow:
+ * 1. Clamp below the first point and at or above the last one.
+ * 2. Upper bits of (raw - base) select the point, the next 4 bits are
+ *    the fraction of the way to the next point.
+ * 3. Linear interpolation, multiplying by the fraction one bit at a
+ *    time with shifts (there is no hardware multiplier).
+ */
+dev_int tempcompOffset(const dev_int *table, dev_int raw){
+	dev_uint u;
+	unsigned char idx, frac;
+	dev_int diff, acc;
+
+	if (raw <= TEMPCOMP_BASE){
+		return table[0];
+	}
+	// Unsigned so that the subtraction can't overflow.
+	u = (dev_uint)raw - (dev_uint)TEMPCOMP_BASE;
+	idx = (unsigned char)(u >> TEMPCOMP_SHIFT);
+	if (idx >= TEMPCOMP_POINTS - 1){
+		return table[TEMPCOMP_POINTS - 1];
+	}
+	frac = (unsigned char)((u >> (TEMPCOMP_SHIFT - 4)) & 0x0F);
+
+	diff = table[idx + 1] - table[idx];
+	acc = table[idx];
+	if (frac & 8) acc += diff >> 1;
+	if (frac & 4) acc += diff >> 2;
+	if (frac & 2) acc += diff >> 3;
+	if (frac & 1) acc += diff >> 4;
+	return acc;
+}
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * tempcomp.h
+ *
+ *  Temperature compensation for the MPU-6050 zero-g offsets.
+ *
+ *  The offsets drift with temperature, so a threshold tuned in the
+ *  workshop misfires on a cold morning. The correction is a small table
+ *  of offsets (in accelerometer counts) indexed by the raw temperature
+ *  reading, with the points TEMPCOMP_STEP raw counts apart so that both
+ *  the lookup and the interpolation are done with shifts only.
+ *
+ *  Refresh the offsets every now and then with tempcompOffset();
+ *  temperature changes far slower than the pitch does.
+ */
+
+#ifndef TEMPCOMP_H_
+#define TEMPCOMP_H_
+
+#include <config.h>
+#include <devint.h>
+#include <mpu6050.h>
+
+#define TEMPCOMP_SHIFT 12							// log2 of the point spacing
+#define TEMPCOMP_STEP (1 << TEMPCOMP_SHIFT)			// 4096 raw counts, about 12 degrees
+#define TEMPCOMP_BASE MPU6050_TEMP_RAW(-40)			// first point, bottom of the sensor range
+#define TEMPCOMP_POINTS 12							// -40 to about +95 degrees
+
+// Offset drift in counts per point, relative to the point nearest
+// TEMPCOMP_REF_C (where the board was calibrated). Linear by default;
+// replace the tables in tempcomp.c with measured values if the part
+// turns out not to be.
+// At 0 the tables are flat and the offsets stay 0: TEMP_COMP then only
+// costs the temperature reads, the tables and the lookups. Measure the
+// drift of the board with tools/tempcal, from a telemetry recording at
+// rest through a temperature sweep, and set the values it prints in
+// config.h. Y is only compensated with CORNER_REJECT, the one stage
+// that reads it.
+#ifndef TEMPCOMP_REF_C
+#define TEMPCOMP_REF_C 20
+#endif
+#ifndef TEMPCOMP_X_DRIFT
+#define TEMPCOMP_X_DRIFT 0
+#endif
+#ifndef TEMPCOMP_Y_DRIFT
+#define TEMPCOMP_Y_DRIFT 0
+#endif
+#ifndef TEMPCOMP_Z_DRIFT
+#define TEMPCOMP_Z_DRIFT 0
+#endif
+
+// How many pitch updates between temperature reads.
+#ifndef TEMPCOMP_INTERVAL
+#define TEMPCOMP_INTERVAL 16
+#endif
+
+extern const dev_int tempcomp_x[TEMPCOMP_POINTS];
+#if CORNER_REJECT
+extern const dev_int tempcomp_y[TEMPCOMP_POINTS];
+#endif
+extern const dev_int tempcomp_z[TEMPCOMP_POINTS];
+
+dev_int tempcompOffset(const dev_int *table, dev_int raw);
+
+#endif /* TEMPCOMP_H_ */
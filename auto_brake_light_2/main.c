@@ -2,28 +2,64 @@
 #include <pcbv1.h>
 #include <iic.h>
 #include <mpu6050.h>
+#include <mpucfg.h>
+#include <detect.h>
+#include <ridelog.h>
+#include <suart.h>
+#include <probe.h>
+#include <battery.h>
+#include <bright.h>
+#include <decim.h>
 //#include <signal.h> 	// for GCC compiler. Used for ISR calls.
 
-// filter coefficients
-#define ACCEL_COEFF 8
-#define COMP_COEFF 16
-
-#define DETECTION_THRESHOLD 2000
-
-// Initial accelerations!
-// Divide by 16
-typedef struct accel_data_struct{
-	int x;
-	int y;
-	int z;
-} accel_data;
+// Filter coefficients and thresholds live in detect.h.
+
+// Sensor faults (the bus side is in iic.h).
+// The watchdog runs from ACLK = VLO (~12 kHz, 4 to 20 kHz): ACLK/8192 is
+// ~0.7 s (0.4 to 2 s), far longer than a sample period.
+#define SENSOR_WATCHDOG WDT_ADLY_250
+// ACLK/32768, ~2.7 s (1.6 to 8 s): for the lower sample rates of the governor.
+#define SENSOR_WATCHDOG_SLOW WDT_ADLY_1000
+#define SENSOR_LOST_COUNT 3		// samples in a row without data before "sensor lost"
+// PWR_MGMT_2 gyro standby bits, set together with the wake rate
+#define STBY_GYRO (MPUF_VAL(MPU6050_F_STBY_XG, 1) | MPUF_VAL(MPU6050_F_STBY_YG, 1) \
+		| MPUF_VAL(MPU6050_F_STBY_ZG, 1))
+
+// Power governor, per battery level (see battery.h).
+static const char gov_wake[3] = {
+	MPUF_VAL(MPU6050_F_LP_WAKE_CTRL, 2),
+	MPUF_VAL(MPU6050_F_LP_WAKE_CTRL, BATTERY_LOW_WAKE),
+	MPUF_VAL(MPU6050_F_LP_WAKE_CTRL, BATTERY_CRIT_WAKE)
+};
+static const char brake_leds[3] = { LED2_PIN + LED4_PIN, LED2_PIN + LED4_PIN, LED2_PIN };
+static const unsigned char bright_cap[3] = { BRIGHT_LEVELS - 1, BRIGHT_LEVELS * 3 / 4 - 1, BRIGHT_LEVELS / 2 - 1 };
 
 static void allLEDOff();
 static void allLEDOn();
+static void brakeLEDOn(const detect_state *d);
+#if BATTERY
+static void governor(const detect_state *d);
+#endif
+static void idleSleep();
+static char configureSensor(void);
+static void sensorLost(detect_state *d);
 static void readAccel(accel_data *data);
-static int smoothFilter(int prev, int curr, int coeff);
-
-char update_pitch;
+#if FIFO_BATCH
+static char readBatch(accel_data *data);
+static void fifoReset(void);
+
+static decim_state decimator;
+static unsigned int fifo_left;		// whole samples in the FIFO not read yet
+static unsigned char fifo_empty;	// wakes in a row that found the FIFO empty
+static char fifo_resync;			// a FIFO read failed part way: reset it
+#endif
+#if TEMP_COMP
+static int readTemp();
+#endif
+#if TELEMETRY
+static void sendTelemetry(const accel_data *raw, const accel_data *comp,
+		const detect_state *d, int temp, unsigned int cycles);
+#endif
 
 /*
  * main.c
@@ -41,19 +77,20 @@ int main(void) {
     // *** Setup of registers and so on
 
     // Allocate some space in RAM stack for some acceleration data.
-	accel_data initial_accel;
     accel_data current_accel;
 
     // DCO setup
     DCOCTL = 0;                               // Select lowest DCOx and MODx settings
     BCSCTL1 = CALBC1_1MHZ;                    // Set DCO
     DCOCTL = CALDCO_1MHZ;
+    BCSCTL3 |= LFXT1S_2;                      // ACLK from the VLO (no crystal), for the sensor watchdog
 
     // Set all GPIOs to output by default.
     P1DIR = 0xFF;
 	P2DIR = 0XFF;
 
 	allLEDOff();
+	batteryInit();		// before the LEDs first come on, and before configureSensor
 
 	// Set up accel interrupt GPIO pin
 	P1DIR &= ~ACCEL_INT; 	// P1.5 input
@@ -63,6 +100,7 @@ int main(void) {
 	// Select primary mode for both ports
 	P1SEL = 0;
 	P2SEL = 0;
+	PROBE_INIT();
 
 	// Set address to the MPU6050 for IIC.
 	// This is the only slave device.
@@ -71,114 +109,194 @@ int main(void) {
 	allLEDOn();
 
 	/////// Initial configuration of MPU6050
-	iicWrite(MPU6050_I2C_MST_CTRL, 0x00);
-	// read initial orientation. initial_accel will not be written into at all any more.
-	readAccel(&initial_accel);
-	// configure and enabled interrupts on data ready
-	iicWrite(MPU6050_INT_PIN_CFG, MPU6050_LATCH_INT_EN);
-	iicWrite(MPU6050_INT_ENABLE, MPU6050_DATA_RDY_EN);
-	// wake from sleep, set sample and sleep mode
-	iicWrite(MPU6050_PWR_MGMT_1, MPU6050_CYCLE);
-	iicWrite(MPU6050_PWR_MGMT_2, MPU6050_LP_WAKE_CTRL_2 + MPU6050_STBY_XG + MPU6050_STBY_YG + MPU6050_STBY_ZG);
-
-	allLEDOff();
-
-	// Kill all interrupts.
-	_BIC_SR(GIE);
-
-	// Clear P1IFG and release MPU6050 int_status latch
-	P1IFG = 0;
-	iicRead(MPU6050_INT_STATUS);
+	// The same path as a lost sensor: returns straight away with the
+	// sensor set up, or blinks until there is one.
+	detect_state detector;
+	sensorLost(&detector);
 
 	// Declare some vars
-	char state = 1;
-	int comp_z = 0; 
-    int comp_x = 0;
-	int cur_z = 0;
-	update_pitch=0;
+	char state;
+	char pitch_count = 0;	// samples since the last pitch update
+	char sensor_failures = 0;	// samples in a row without data
+#if TEMP_COMP
+	char temp_count = 0;	// pitch updates since the last temperature read
+	int raw_temp = readTemp();	// last good reading
+	detectUpdateTemperature(&detector, raw_temp);
+#endif
+#if RIDELOG
+	char logged_state = DETECT_IDLE;
+	ridelogInit();
+#endif
 
 	// Timer setup
-    // TODO: set these up properly. 
-	CCTL0 = CCIE;                             // CCR0 interrupt enabled
-    CCTL1 = CCIE;                             // CCR1 interrupt enabled
-	CCR0 = 50000;
-    CCR1 = 2000;
-	TACTL = TASSEL_2 + MC_2 + ID_2;                  // SMCLK, contmode, /4
-    
+	// Timer_A runs from SMCLK, so it only counts while we are awake (or in
+	// LPM0). That makes TAR a free cycle counter for the awake window.
+	// CCR0 is the telemetry UART bit clock.
+	TACTL = TASSEL_2 + MC_2;                  // SMCLK, contmode
+#if TELEMETRY
+	suartInit();
+	unsigned int wake_tar;
+	accel_data raw_accel;
+#endif
 
 	// Disable all maskable interrupts, THEN un-mask interrupts on ACCEL_INT.
 	// This prevents jumping into the ISR immediately after un-masking.
 	// This behaviour results in the ISR being serviced BEFORE entering LPM3!! :(
 	_BIC_SR(GIE);
+#if !FIFO_BATCH
 	P1IE |= ACCEL_INT;		// enable interrupts
+#endif
 
 	// Begin primary function state machine.
 	/*
 	 * The flow:
 	 * 1. Update accelerometer reading variables
      * 2. (Periodically) update pitch compensation amount
+     * 2a. (Less often) update temperature offsets
 	 * 2. Pitch compensation
      * 3. Bump compensation
 	 * 4. Smoothing (two-sample weighted average)
-	 * 5. Parse z into the state machine
-	 * 6. LEDs will light up depending on the state
+	 * 5. Parse z into the state machine (level detector)
+	 * 6. LEDs will light up depending on the state, brighter for harder
+	 *    braking (see bright.h)
+	 * 6a. Battery monitor; a new level goes to the governor (see battery.h)
 	 * 7. Wait for more accelerometer data in LPM3. Then repeat!
+	 *    (LPM0 while telemetry is still going out, it needs SMCLK.)
+	 *
+	 * FIFO_BATCH: the watchdog wakes us every FIFO_WAKE instead, and 1 is
+	 * the FIFO through the decimator (see decim.h): 2-6 run once per
+	 * DECIM_RATE samples. If more than one output was due, the loop goes
+	 * round again without sleeping.
+	 *
+	 * No data (sensor watchdog) or a failed read skips 2-6 and leaves the
+	 * LEDs as they are; SENSOR_LOST_COUNT of those in a row and the light
+	 * goes to "sensor lost" (see sensorLost). A dead bus costs a loop at
+	 * most two failed transfers, ~160 ms (see iic.h).
 	 */
 	while(1){
-		_BIS_SR(LPM3_bits + GIE);
-
-		// Kill all interrupts.
-		_BIC_SR(GIE);
-
-		readAccel(&current_accel);
-
-		if (update_pitch){
-			/*
-			 * Periodic pitch compensation.
-			 * 1. Calculate current compensation amount from z accel reading.
-             * 1a. Also update comp_x for fast compensation.
-			 * 2. Update smoothed compensation amount (two-sample weighted average).
-			 * 3. Reset update_pitch flag.
-			 */
-            comp_x = smoothFilter(comp_x, current_accel.x, COMP_COEFF);
-            comp_z = smoothFilter(comp_z, current_accel.z, COMP_COEFF);
-            
-			update_pitch = 0;
+#if FIFO_BATCH
+		if (!fifo_left){
+			idleSleep();
 		}
-
-		current_accel.z -= comp_z;
-        current_accel.z -= comp_z / comp_x * current_accel.z;    // z_n = tan(theta) * z = g_z/g_x*z
-        cur_z = smoothFilter(cur_z, current_accel.z, ACCEL_COEFF);
-
-		// set new state.
-		// Hysteresis!
-		if (abs(cur_z) > DETECTION_THRESHOLD){
-			state = 1;
+#else
+		idleSleep();
+#endif
+#if TELEMETRY
+		wake_tar = TAR;
+#endif
+		PROBE_MARK();
+
+		iic_fault = 0;
+#if FIFO_BATCH
+		if (!readBatch(&current_accel) && !iic_fault){
+			continue;		// no output due yet
+		}
+#else
+		// The PORT1 ISR masks ACCEL_INT. Still enabled: the watchdog woke us.
+		if (P1IE & ACCEL_INT){
+			iic_fault = 1;
 		} else {
-			state = 2;
+			readAccel(&current_accel);
 		}
-
-		// Only wakes up when interrupt is received from PORT 1.
-		switch(state){
-		case 1:
-			allLEDOn();
-			break;
-		case 2:
-			allLEDOff();
-			break;
+#endif
+		PROBE_MARK();
+
+		if (iic_fault){
+			PROBE_MARK();		// marks 3 and 4 on every path, see probe.h
+			PROBE_MARK();
+			if (++sensor_failures >= SENSOR_LOST_COUNT){
+				sensorLost(&detector);
+				sensor_failures = 0;
+			}
+		} else {
+			sensor_failures = 0;
+#if TELEMETRY
+			raw_accel = current_accel;
+#endif
+#if RIDELOG
+			ridelogSample(current_accel.x, current_accel.y, current_accel.z);
+#endif
+
+			if (++pitch_count >= PITCH_INTERVAL){
+				// Periodic pitch compensation.
+				detectUpdatePitch(&detector, &current_accel);
+				pitch_count = 0;
+
+#if TEMP_COMP
+				if (++temp_count >= TEMPCOMP_INTERVAL){
+					if (battery_level == BATTERY_OK){
+						int temp = readTemp();
+						if (!iic_fault){
+							raw_temp = temp;
+							detectUpdateTemperature(&detector, temp);
+						}
+					}
+					temp_count = 0;
+				}
+#endif
+			}
+
+			// Compensation, smoothing and the level detector. See detect.c.
+			// Only wakes up when interrupt is received from PORT 1.
+			state = detectStep(&detector, &current_accel);
+			PROBE_MARK();
+			switch(state){
+			case DETECT_BRAKE:
+				brakeLEDOn(&detector);
+				break;
+			case DETECT_IDLE:
+				allLEDOff();
+				if (batteryBlink()){
+					P1OUT |= LED4_PIN;	// low battery: one LED, for one sample
+				}
+				break;
+			}
+			PROBE_MARK();
+
+#if BATTERY
+			if (batteryTick(brightBusy() || (P1OUT & (LED2_PIN + LED4_PIN)))){
+				governor(&detector);
+			}
+#endif
+
+#if RIDELOG
+			// Commit the pre-trigger window when the light comes on (only then:
+			// every commit wears the flash, see ridelog.h).
+			// LEDs are already set, so the flash write does not delay them.
+			if (detector.state != logged_state){
+				logged_state = detector.state;
+				if (logged_state == DETECT_BRAKE && battery_level != BATTERY_CRITICAL){	// flash needs VCC >= 2.2 V
+					ridelogCommit();
+				}
+			}
+#endif
+
+#if TELEMETRY
+#if TEMP_COMP
+			sendTelemetry(&raw_accel, &current_accel, &detector, raw_temp, TAR - wake_tar);
+#else
+			sendTelemetry(&raw_accel, &current_accel, &detector, TEL_NO_TEMP, TAR - wake_tar);
+#endif
+#endif
 		}
 
+#if !FIFO_BATCH
 		// clear latch on MPU-6050, and re-enable interrupt for reception of more data.
 		// GIE cleared to make sure that interrupt is not tripped before going into LPM.
+		// Tried even after a failure: a latched INT would never fire again.
 
+		iic_fault = 0;
 		iicRead(MPU6050_INT_STATUS);
 		_BIC_SR(GIE);
+		PROBE_END();
 		P1IE |= ACCEL_INT;
+#endif
 	}
 }
 
 
 static void allLEDOff(){
+	brightOff();
 	//P1OUT |= LED1_PIN + LED3_PIN;
 	P1OUT &= ~(LED2_PIN + LED4_PIN);
 }
@@ -186,38 +304,308 @@ static void allLEDOn(){
 	P1OUT |= LED2_PIN + LED4_PIN;
 	//P1OUT &= ~(LED1_PIN + LED3_PIN);
 }
+// The brake light for the detector's braking magnitude: dimmer and with
+// fewer LEDs on a low battery. Only an LED that is not part of it is
+// cleared here, so a running flash or PWM is left alone.
+static void brakeLEDOn(const detect_state *d){
+	P1OUT &= ~((LED2_PIN + LED4_PIN) & ~brake_leds[battery_level]);
+	brightOn(brake_leds[battery_level], d->cur_z, detectThreshold(d), bright_cap[battery_level]);
+}
 
-static int smoothFilter(int prev, int curr, int coeff){
-	return ((prev/coeff*(coeff-1)) + (curr/coeff));
+#if BATTERY
+/*
+ * governor
+ * Applies a new battery_level: the sensor's sample rate, and the LEDs if
+ * the brake light is on. The rest (watchdog period, features, indication)
+ * reads battery_level where it is used. A failed write stays in the
+ * shadow; a sensor that does not answer is set up again by sensorLost.
+ */
+static void governor(const detect_state *d){
+	MPUCFG_SET(MPU6050_PWR_MGMT_2, MPUF_MASK(MPU6050_F_LP_WAKE_CTRL), gov_wake[battery_level]);
+	mpuCfgFlush();
+	if (d->state == DETECT_BRAKE){
+		brakeLEDOn(d);
+	}
+}
+#endif
+
+/*
+ * idleSleep
+ * Sleeps until ACCEL_INT, or the sensor watchdog if it never comes
+ * (FIFO_BATCH: for FIFO_WAKE). LPM3, or LPM0 while the LED PWM runs (see
+ * bright.h).
+ * Returns with interrupts off (on with telemetry: the UART ISR has to
+ * keep up with the bit clock) and the watchdog held.
+ */
+static void idleSleep(){
+#if FIFO_BATCH
+	WDTCTL = FIFO_WAKE;
+#else
+	WDTCTL = battery_level == BATTERY_OK ? SENSOR_WATCHDOG : SENSOR_WATCHDOG_SLOW;
+#endif
+	IFG1 &= ~WDTIFG;
+	IE1 |= WDTIE;
+#if TELEMETRY
+	suartSleep(brightBusy());
+#else
+	if (brightBusy()){
+		_BIS_SR(LPM0_bits + GIE);	// the LED PWM needs SMCLK
+	} else {
+		_BIS_SR(LPM3_bits + GIE);
+	}
+
+	// Kill all interrupts.
+	_BIC_SR(GIE);
+#endif
+	WDTCTL = WDTPW + WDTHOLD;
+	IE1 &= ~WDTIE;
 }
 
+/*
+ * configureSensor
+ * Sets the MPU-6050 up for data ready interrupts in cycle mode (FIFO_BATCH:
+ * continuous sampling into the FIFO). Returns 0 if it did not answer.
+ * (The old initial orientation read went: nothing used it, and the
+ * sensor is still asleep at that point.)
+ * The whole shadow goes out (see mpucfg.h), in the order of the
+ * registers: interrupts and the FIFO are set up before PWR_MGMT starts
+ * sampling.
+ */
+static char configureSensor(void){
+	mpuCfgInit();
+#if FIFO_BATCH
+	// accelerometer into the FIFO at 1 kHz / (1 + FIFO_DIV), through the DLPF
+	MPUCFG_FIELD(MPU6050_F_SMPLRT_DIV, FIFO_DIV);
+	MPUCFG_FIELD(MPU6050_F_DLPF_CFG, FIFO_DLPF);
+	MPUCFG_FIELD(MPU6050_F_FIFO_EN, 1);
+	// wake from sleep, continuous, accelerometer only
+	MPUCFG_FIELD2(MPU6050_F_SLEEP, 0, MPU6050_F_CYCLE, 0);
+	MPUCFG_FIELD(MPU6050_F_STBY_XG, 1);
+	MPUCFG_FIELD2(MPU6050_F_STBY_YG, 1, MPU6050_F_STBY_ZG, 1);
+	iicWrite(MPU6050_FIFO_ENABLE, MPUF_VAL(MPU6050_F_ACCEL_FIFO_EN, 1));
+	fifoReset();
+	mpuCfgFlush();
+	return !iic_fault;
+#else
+	// configure and enabled interrupts on data ready
+	MPUCFG_FIELD(MPU6050_F_LATCH_INT_EN, 1);
+	MPUCFG_FIELD(MPU6050_F_DATA_RDY_EN, 1);
+	// wake from sleep, set sample and sleep mode (rate from the governor), accelerometer only
+	MPUCFG_FIELD2(MPU6050_F_SLEEP, 0, MPU6050_F_CYCLE, 1);
+	MPUCFG_SET(MPU6050_PWR_MGMT_2, MPUF_MASK(MPU6050_F_LP_WAKE_CTRL) | STBY_GYRO,
+		gov_wake[battery_level] | STBY_GYRO);
+	mpuCfgFlush();
+	return !iic_fault;
+#endif
+}
+
+/*
+ * sensorLost
+ * The "sensor lost" state: the light cannot tell braking any more, so it
+ * says so with a slow blink that cannot be taken for a brake light.
+ * Returns once the sensor is back. Also the power-up set-up.
+ * Flow:
+ * 1. Try to set the sensor up (again). A dead bus fails within ~80 ms.
+ * 2. No answer: toggle the LEDs, sleep one watchdog period (~0.7 s) and
+ *    go back to 1.
+ * 3. Once it answers: LEDs off, restart the detector, clear any stale
+ *    interrupt and the INT_STATUS latch.
+ */
+static void sensorLost(detect_state *d){
+	brightOff();	// the blink below drives the pins directly
+	for (;;){
+		iic_fault = 0;
+		if (configureSensor()){
+			break;
+		}
+		P1OUT ^= LED2_PIN + LED4_PIN;
+		idleSleep();
+	}
+
+	allLEDOff();
+	detectInit(d);
+	P1IFG = 0;
+	iicRead(MPU6050_INT_STATUS);
+}
 
 /*
  * readAccel
  * Updates 'data' struct with new accel readings.
- * Flow (for each of x,y,z):
- * 1. Read 2 bytes into memory
- * 2. Construct 2 byte word and store into struct
+ * Flow:
+ * 1. Read ACCEL_XOUT_H..ACCEL_ZOUT_L in one 6 byte burst (X, Y, Z, high
+ *    byte first). The sensor latches all six for the burst, so the axes
+ *    come from the same sample, and one transfer is cheaper than six.
+ * 2. Construct each 2 byte word and store into struct
+ *    (MPU6050_WORD: plain char is signed, so "lo + (hi << 8)" would
+ *    sign-extend the low byte and be off by 256 whenever its top bit is set)
+ * On a failed transfer 'data' is not valid; iic_fault says so.
  */
 static void readAccel(accel_data *data){
-	char x0,x1;
-	// char y0,y1;
-	char z0,z1;
-
-	z0 = iicRead(MPU6050_ACCEL_ZOUT_L);
-	z1 = iicRead(MPU6050_ACCEL_ZOUT_H);
-	data->z = z0 + (z1 << 8);
-
-    /*
-	y0 = iicRead(MPU6050_ACCEL_YOUT_L);
-	y1 = iicRead(MPU6050_ACCEL_YOUT_H);
-	data->y = y0 + (y1 << 8);
-    */
-    
-	x0 = iicRead(MPU6050_ACCEL_XOUT_L);
-	x1 = iicRead(MPU6050_ACCEL_XOUT_H);
-	data->x = x0 + (x1 << 8);
+	char b[6];
+	dev_int *w = &data->x;		// x, y, z in order
+	unsigned char i;
+
+	iicReadBurst(MPU6050_ACCEL_XOUT_H, b, 6);
+	for (i = 0; i < 6; i += 2){
+		*w++ = MPU6050_WORD(b[i], b[i + 1]);
+	}
+}
+
+#if FIFO_BATCH
+/*
+ * readBatch
+ * Feeds the decimator from the FIFO until an output is due. Returns 1
+ * with it in 'data'; 0 if the FIFO ran out first, with iic_fault set if
+ * a transfer failed or the sensor has stopped sampling.
+ * Flow:
+ * 1. Nothing left from the last wake: read FIFO_COUNT. Empty for
+ *    FIFO_EMPTY_WAKES wakes in a row: the sensor has stopped. Full:
+ *    samples were lost, start over.
+ * 2. Read up to FIFO_CHUNK samples (X, Y, Z) per burst (FIFO_R_W does
+ *    not increment, so a burst just pops that many bytes), never past the
+ *    next decimator output, so nothing is left over in the buffer. Feed
+ *    them to the decimator until it has an output. A burst that fails
+ *    part way leaves the FIFO out of step with the sample boundaries, so
+ *    the next call resets it.
+ */
+static char readBatch(accel_data *data){
+	char b[6 * FIFO_CHUNK];
+	unsigned char n, i;
+
+	if (fifo_resync){
+		fifoReset();
+		return 0;
+	}
+	if (!fifo_left){
+		iicReadBurst(MPU6050_FIFO_COUNTH, b, 2);
+		if (iic_fault){
+			return 0;
+		}
+		fifo_left = MPU6050_WORD(b[0], b[1]);
+		if (fifo_left >= FIFO_SIZE){
+			fifoReset();
+			return 0;
+		}
+		fifo_left /= 6;
+		if (!fifo_left){
+			if (fifo_empty < FIFO_EMPTY_WAKES){
+				fifo_empty++;
+			} else {
+				iic_fault = 1;
+			}
+			return 0;
+		}
+		fifo_empty = 0;
+	}
+
+	while (fifo_left){
+		n = DECIM_RATE - decimator.phase;
+		if (n > FIFO_CHUNK){
+			n = FIFO_CHUNK;
+		}
+		if (n > fifo_left){
+			n = fifo_left;
+		}
+		iicReadBurst(MPU6050_FIFO_R_W, b, 6 * n);
+		if (iic_fault){
+			fifo_left = 0;
+			fifo_resync = 1;
+			return 0;
+		}
+		fifo_left -= n;
+		for (i = 0; i < 6 * n; i += 6){
+			data->x = MPU6050_WORD(b[i], b[i + 1]);
+			data->y = MPU6050_WORD(b[i + 2], b[i + 3]);
+			data->z = MPU6050_WORD(b[i + 4], b[i + 5]);
+			if (decimPush(&decimator, data)){
+				return 1;		// the last sample of the burst
+			}
+		}
+	}
+	return 0;
+}
+
+/*
+ * fifoReset
+ * Empties the FIFO (FIFO_RESET only works with FIFO_EN off) and the
+ * decimator with it.
+ */
+static void fifoReset(void){
+	iicWrite(MPU6050_USER_CTRL, MPUF_VAL(MPU6050_F_FIFO_RESET, 1));
+	iicWrite(MPU6050_USER_CTRL, MPUCFG_GET(MPU6050_USER_CTRL));
+	decimInit(&decimator);
+	fifo_left = 0;
+	fifo_empty = 0;
+	fifo_resync = iic_fault;
+}
+#endif
+
+
+#if TEMP_COMP
+/*
+ * readTemp
+ * Returns the raw temperature reading. Integer only, see MPU6050_TEMP_RAW.
+ * TEMP_OUT_H and _L in one burst, like readAccel(): two single reads
+ * could take the bytes from different conversions.
+ */
+static int readTemp(){
+	char b[2];
+
+	iicReadBurst(MPU6050_TEMP_OUT_H, b, 2);
+	return MPU6050_WORD(b[0], b[1]);
+}
+#endif
+
+
+#if TELEMETRY
+/*
+ * sendTelemetry
+ * Packs one frame (see telemetry.h) and queues it on the software UART.
+ * Never waits: if both frame buffers are busy the frame is dropped and
+ * counted in the next one.
+ */
+static void sendTelemetry(const accel_data *raw, const accel_data *comp,
+		const detect_state *d, int temp, unsigned int cycles){
+	static unsigned char seq;
+	static unsigned char dropped;
+	unsigned char *f = suartBuffer();
+	unsigned char sum = 0;
+	unsigned char i;
+
+	if (!f){
+		if (dropped != 0xFF){
+			dropped++;
+		}
+		return;
+	}
+
+	f[0] = TEL_SYNC;
+	f[TEL_SEQ] = seq++;
+	f[TEL_RAW_X] = raw->x;
+	f[TEL_RAW_X + 1] = raw->x >> 8;
+	f[TEL_RAW_Y] = raw->y;
+	f[TEL_RAW_Y + 1] = raw->y >> 8;
+	f[TEL_RAW_Z] = raw->z;
+	f[TEL_RAW_Z + 1] = raw->z >> 8;
+	f[TEL_COMP_Z] = comp->z;
+	f[TEL_COMP_Z + 1] = comp->z >> 8;
+	f[TEL_CUR_Z] = d->cur_z;
+	f[TEL_CUR_Z + 1] = d->cur_z >> 8;
+	f[TEL_STATE] = d->state;
+	f[TEL_DROPPED] = dropped;
+	f[TEL_CYCLES] = cycles;
+	f[TEL_CYCLES + 1] = cycles >> 8;
+	f[TEL_TEMP] = temp;
+	f[TEL_TEMP + 1] = temp >> 8;
+	for (i = 0; i < TEL_CHECKSUM; i++){
+		sum += f[i];
+	}
+	f[TEL_CHECKSUM] = -sum;
+
+	dropped = 0;
+	suartQueue();
 }
+#endif
 
 
 /*
@@ -225,53 +613,14 @@ static void readAccel(accel_data *data){
  * Waking up from this will get the accelerometer readings updated!
  * Flow:
  * 1. Mask all P1 interrupts and clear interrupt flag
- * 2. Reset the update_pitch flag to signal accelerometer reading!
+ * 2. Wake up from LPM3
  * 3. (Accelerometer readings are updated in the state machine)
  */
 #pragma vector=PORT1_VECTOR
 __interrupt void PORT1 (void){
+	PROBE_START();
 	// Disable interrupt until we're done processing the current data.
 	P1IFG &= ~ACCEL_INT;
 	P1IE &= ~ACCEL_INT;
 	_BIC_SR(LPM3_EXIT); // wake up from low power mode
 }
-
-/*
- * Timer A0 ISR
- * Waking up from this will get the pitch updated!
- * Flow:
- * 1. Set the flag
- * 2. Reset timer
- * 4. (Pitch will get updated in state machine next time it wakes up.)
- */
-#pragma vector=TIMERA0_VECTOR
-__interrupt void TIMERA0(void){
-    static count;   // Counts number of timer interrupts
-    
-    // TODO: move all this to main somehow!
-    
-    // Check where the interrupt came from
-    if (TAIV & CCR0_BIT){
-        // Interrupt came from capture-compare 0
-        // So increment or decrement the duty cycle!
-        if (TACCR0 >= CCR_MAX){
-            TACCR0 -= 1;    // decrease duty cycle
-        } else if (TACCR0 <= CCR_MIN){ 
-            TACCR0 += 1;    // increase duty cycle
-        }
-        
-        // Turn the LEDs on 
-        turn_all_leds_on();
-        
-        
-    } else if ((TAIV & CCR1_BIT) && (count++ > DATA_INTERVAL_COUNT)) {
-        // It's time to update the pitch.
-        update_pitch = TRUE;
-        count = 0;
-        _BIC_SR(LPM3_EXIT); // wake up from low power mode to read from accel
-    } else { 
-        turn_all_leds_off(); 
-    }
-
-	
-}
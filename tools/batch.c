@@ -0,0 +1,568 @@
+/*
+ * batch.c
+ *
+ *  Batch evaluator: runs many traces through the detection pipeline in
+ *  lock-step, one trace per 16 bit SIMD lane (SSE2: 8, AVX2: 16), with a
+ *  portable C version as the fallback and as the reference.
+ *
+ *  The lanes reproduce the MSP430 arithmetic bit for bit: 16 bit ints
+ *  that wrap, truncating division, and abs() that leaves -32768 alone.
+ *
+ *  Covers pitch compensation, cornering rejection, the 3-sample median
+ *  (BUMP_WINDOW 1 or 3), the noise floor, smoothFilter() and the level
+ *  detector.
+ *  Temperature offsets are not applied: traces carry no temperature.
+ *  Coefficients must be powers of two, so the divides become shifts;
+ *  the threshold may differ per lane (with the noise floor, it is the
+ *  value at NOISE_REF), so one trace can also be replicated across lanes
+ *  to sweep thresholds.
+ *
+ *  -v runs the cross-check: the portable version against the firmware's detect.c, and every SIMD
+ *  version against the portable one, on the given traces plus random
+ *  full-range lanes that force overflows. It needs the checked build
+ *  below, where detect.c runs on the 16 bit integer model (msp16.hpp)
+ *  and so decides exactly as the device does; the plain C build has 32
+ *  bit host ints and skips that half. Exits non-zero on any mismatch.
+ *  tools/crosscheck.sh runs it over generated rides.
+ *
+ *  Build (from the repository root):
+ *    cc -O2 -DDETECT_TUNABLE -Iauto_brake_light_2/libs -o batch \
+ *        tools/batch.c tools/score.c tools/trace.c \
+ *        auto_brake_light_2/libs/detect.c auto_brake_light_2/libs/tempcomp.c
+ *
+ *  Checked build, for -v (detect.c, tempcomp.c, score.c and this file
+ *  compiled as C++, as for check16):
+ *    g++ -O2 -DMSP_CHECKED -DDETECT_TUNABLE -Iauto_brake_light_2/libs -Itools \
+ *        -o batch -x c++ tools/batch.c tools/score.c \
+ *        auto_brake_light_2/libs/detect.c auto_brake_light_2/libs/tempcomp.c \
+ *        -x c tools/trace.c
+ *
+ *  Usage:
+ *    batch [-v] [-i portable|sse2|avx2] [-R repeat] [-p pitch_interval]
+ *          [-w warmup] trace.csv|corpus.trb...
+ */
+
+#include <detect.h>
+#include "score.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BATCH_X86 1
+#include <immintrin.h>
+#endif
+
+#if BUMP_WINDOW != 1 && BUMP_WINDOW != 3
+#error batch only models BUMP_WINDOW 1 or 3
+#endif
+
+#define BATCH_PAD 16	// lane count is padded to the widest vector
+
+// Lanes are interleaved: sample t of lane l is at [t * n + l].
+typedef struct batch_struct{
+	long n;				// lanes, multiple of BATCH_PAD
+	long len;			// samples per lane
+	short *x;
+	short *y;
+	short *z;
+	short *threshold;	// per lane
+} batch;
+
+typedef struct batch_param_struct{
+	int accel_shift;	// log2 ACCEL_COEFF
+	int comp_shift;		// log2 COMP_COEFF
+	int pitch_interval;
+	char corner;		// CORNER_REJECT, with the CORNER_ values of detect.h
+	char noise;			// NOISE_ADAPT, with the NOISE_ values
+	char bump;
+} batch_param;
+
+typedef void (*batch_kernel)(const batch *b, const batch_param *bp, unsigned char *out);
+
+/*
+ * batchPortable
+ * One lane at a time, every intermediate cut to 16 bits the way the
+ * MSP430 compiler leaves it.
+ */
+#define W16(v) ((short)(v))
+
+static short smooth16(short prev, short curr, int coeff){
+	return W16(W16(W16(prev / coeff) * (coeff - 1)) + curr / coeff);
+}
+
+static short abs16(short v){
+	return W16(v < 0 ? -v : v);
+}
+
+static void batchPortable(const batch *b, const batch_param *bp, unsigned char *out){
+	const int ac = 1 << bp->accel_shift, cc = 1 << bp->comp_shift;
+	long l, t;
+
+	for (l = 0; l < b->n; l++){
+		short comp_x = 0, comp_y = 0, comp_z = 0, q = 0;
+		short lat = 0, corner = 0;
+		unsigned short noise = (NOISE_REF >> NOISE_SCALE) << NOISE_WINDOW;
+		short cur = 0, thr = b->threshold[l];
+		short m0 = 0, m1 = 0;
+		char brake = 0;
+
+		for (t = 0; t < b->len; t++){
+			short x = b->x[t * b->n + l];
+			short y = b->y[t * b->n + l];
+			short z = b->z[t * b->n + l];
+
+			if (bp->pitch_interval > 0 && t % bp->pitch_interval == 0){
+				comp_x = smooth16(comp_x, x, cc);
+				comp_y = smooth16(comp_y, y, cc);
+				comp_z = smooth16(comp_z, z, cc);
+				q = comp_x ? W16(comp_z / comp_x) : 0;
+			}
+
+			z = W16(z - comp_z);
+			z = W16(z - W16(q * z));
+
+			if (bp->corner){
+				short a;
+
+				lat = W16(lat + (W16(W16((y >> 1) - (comp_y >> 1)) - lat) >> CORNER_SMOOTH));
+				a = abs16(lat);
+				if (a > (CORNER_THRESHOLD >> 1) && (a >> CORNER_DOMINANCE) > (abs16(cur) >> 1)){
+					corner = CORNER_HOLD + 1;
+				}
+				if (corner){
+					corner--;
+					z >>= CORNER_ATTEN;
+				}
+			}
+
+			if (bp->bump){
+				short lo = m0 < m1 ? m0 : m1, hi = m0 < m1 ? m1 : m0;
+				short med = z < hi ? z : hi;
+
+				med = med > lo ? med : lo;
+				m0 = m1;
+				m1 = z;
+				z = med;
+			}
+
+			if (bp->noise){
+				unsigned short r = abs16(W16((z >> 1) - (cur >> 1))) >> (NOISE_SCALE - 1);
+				unsigned short n = noise >> NOISE_WINDOW;
+
+				thr = W16(W16(b->threshold[l] - (NOISE_REF << NOISE_GAIN)) + W16(n << (NOISE_SCALE + NOISE_GAIN)));
+				thr = thr < NOISE_THRESHOLD_MIN ? NOISE_THRESHOLD_MIN : thr > NOISE_THRESHOLD_MAX ? NOISE_THRESHOLD_MAX : thr;
+				if (!brake){
+					if (r > ((n + 1) << NOISE_CLIP)){
+						r = (n + 1) << NOISE_CLIP;
+					}
+					if (r > NOISE_INPUT_MAX){
+						r = NOISE_INPUT_MAX;
+					}
+					noise = (unsigned short)(noise + r - n);
+				}
+			}
+
+			cur = smooth16(cur, z, ac);
+
+			brake = abs16(cur) > thr;
+
+			out[t * b->n + l] = brake;
+		}
+	}
+}
+
+#ifdef BATCH_X86
+
+// SSE2: 8 lanes
+#define KERNEL batchSSE2
+#define TARGET __attribute__((target("sse2")))
+#define W 8
+#define V __m128i
+#define V_SET1(a) _mm_set1_epi16(a)
+#define V_LOADU(p) _mm_loadu_si128((const __m128i *)(p))
+#define V_STOREU(p, a) _mm_storeu_si128((__m128i *)(p), a)
+#define V_ADD(a, b) _mm_add_epi16(a, b)
+#define V_SUB(a, b) _mm_sub_epi16(a, b)
+#define V_MULLO(a, b) _mm_mullo_epi16(a, b)
+#define V_SRAI(a, k) _mm_sra_epi16(a, _mm_cvtsi32_si128(k))
+#define V_SRLI(a, k) _mm_srl_epi16(a, _mm_cvtsi32_si128(k))
+#define V_SLLI(a, k) _mm_sll_epi16(a, _mm_cvtsi32_si128(k))
+#define V_AND(a, b) _mm_and_si128(a, b)
+#define V_ANDNOT(a, b) _mm_andnot_si128(a, b)
+#define V_OR(a, b) _mm_or_si128(a, b)
+#define V_MIN(a, b) _mm_min_epi16(a, b)
+#define V_MAX(a, b) _mm_max_epi16(a, b)
+#define V_CMPGT(a, b) _mm_cmpgt_epi16(a, b)
+#define V_SUBS_EPU(a, b) _mm_subs_epu16(a, b)
+#define V_ABS(a) sse2Abs(a)
+#define V_STORE_MASK(p, m) sse2StoreMask(p, m)
+
+TARGET static inline __m128i sse2Abs(__m128i a){
+	// max(a, -a): -(-32768) wraps back to -32768, same as the device.
+	return _mm_max_epi16(a, _mm_sub_epi16(_mm_setzero_si128(), a));
+}
+
+TARGET static inline void sse2StoreMask(unsigned char *p, __m128i m){
+	__m128i bytes = _mm_and_si128(_mm_packs_epi16(m, m), _mm_set1_epi8(1));
+	_mm_storel_epi64((__m128i *)p, bytes);
+}
+
+#include "batch_kernel.h"
+
+#undef KERNEL
+#undef TARGET
+#undef W
+#undef V
+#undef V_SET1
+#undef V_LOADU
+#undef V_STOREU
+#undef V_ADD
+#undef V_SUB
+#undef V_MULLO
+#undef V_SRAI
+#undef V_SRLI
+#undef V_SLLI
+#undef V_AND
+#undef V_ANDNOT
+#undef V_OR
+#undef V_MIN
+#undef V_MAX
+#undef V_CMPGT
+#undef V_SUBS_EPU
+#undef V_ABS
+#undef V_STORE_MASK
+
+// AVX2: 16 lanes
+#define KERNEL batchAVX2
+#define TARGET __attribute__((target("avx2")))
+#define W 16
+#define V __m256i
+#define V_SET1(a) _mm256_set1_epi16(a)
+#define V_LOADU(p) _mm256_loadu_si256((const __m256i *)(p))
+#define V_STOREU(p, a) _mm256_storeu_si256((__m256i *)(p), a)
+#define V_ADD(a, b) _mm256_add_epi16(a, b)
+#define V_SUB(a, b) _mm256_sub_epi16(a, b)
+#define V_MULLO(a, b) _mm256_mullo_epi16(a, b)
+#define V_SRAI(a, k) _mm256_sra_epi16(a, _mm_cvtsi32_si128(k))
+#define V_SRLI(a, k) _mm256_srl_epi16(a, _mm_cvtsi32_si128(k))
+#define V_SLLI(a, k) _mm256_sll_epi16(a, _mm_cvtsi32_si128(k))
+#define V_AND(a, b) _mm256_and_si256(a, b)
+#define V_ANDNOT(a, b) _mm256_andnot_si256(a, b)
+#define V_OR(a, b) _mm256_or_si256(a, b)
+#define V_MIN(a, b) _mm256_min_epi16(a, b)
+#define V_MAX(a, b) _mm256_max_epi16(a, b)
+#define V_CMPGT(a, b) _mm256_cmpgt_epi16(a, b)
+#define V_SUBS_EPU(a, b) _mm256_subs_epu16(a, b)
+#define V_ABS(a) _mm256_abs_epi16(a)		// also leaves -32768 alone
+#define V_STORE_MASK(p, m) avx2StoreMask(p, m)
+
+TARGET static inline void avx2StoreMask(unsigned char *p, __m256i m){
+	// packs works within 128 bit halves; pull the two useful quarters together.
+	__m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(m, m), 0x08);
+	__m128i bytes = _mm_and_si128(_mm256_castsi256_si128(packed), _mm_set1_epi8(1));
+	_mm_storeu_si128((__m128i *)p, bytes);
+}
+
+#include "batch_kernel.h"
+
+#endif /* BATCH_X86 */
+
+typedef struct impl_struct{
+	const char *name;
+	batch_kernel run;
+	int (*available)(void);
+} impl;
+
+static int always(void){
+	return 1;
+}
+#ifdef BATCH_X86
+static int haveSSE2(void){
+	return __builtin_cpu_supports("sse2");
+}
+static int haveAVX2(void){
+	return __builtin_cpu_supports("avx2");
+}
+#endif
+
+static const impl impls[] = {
+	{ "portable", batchPortable, always },
+#ifdef BATCH_X86
+	{ "sse2", batchSSE2, haveSSE2 },
+	{ "avx2", batchAVX2, haveAVX2 },
+#endif
+};
+#define N_IMPLS ((int)(sizeof(impls) / sizeof(impls[0])))
+
+static int log2exact(int v){
+	int k = 0;
+
+	if (v <= 0 || (v & (v - 1))){
+		return -1;
+	}
+	while (v > 1){
+		v >>= 1;
+		k++;
+	}
+	return k;
+}
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Interleave traces into lanes. Short traces are padded with their last sample.
+static void batchFromTraces(batch *b, const trace *t, int n_traces, int repeat, short threshold){
+	long l, i;
+
+	b->n = ((long)n_traces * repeat + BATCH_PAD - 1) / BATCH_PAD * BATCH_PAD;
+	b->len = 0;
+	for (l = 0; l < n_traces; l++){
+		if (t[l].n > b->len){
+			b->len = t[l].n;
+		}
+	}
+	b->x = (short *)calloc(b->n * b->len, sizeof(short));
+	b->y = (short *)calloc(b->n * b->len, sizeof(short));
+	b->z = (short *)calloc(b->n * b->len, sizeof(short));
+	b->threshold = (short *)calloc(b->n, sizeof(short));
+
+	for (l = 0; l < b->n; l++){
+		b->threshold[l] = threshold;
+		if (l >= (long)n_traces * repeat){
+			continue;
+		}
+		const trace *tr = &t[l % n_traces];
+		for (i = 0; i < b->len; i++){
+			const trace_sample *s = &tr->s[i < tr->n ? i : tr->n - 1];
+			b->x[i * b->n + l] = s->x;
+			b->y[i * b->n + l] = s->y;
+			b->z[i * b->n + l] = s->z;
+		}
+	}
+}
+
+// Full-range random lanes: steps, ramps and noise all the way to +-32767.
+static void batchRandom(batch *b, long n, long len, unsigned int seed){
+	long l, i;
+
+	srand(seed);
+	b->n = n;
+	b->len = len;
+	b->x = (short *)malloc(n * len * sizeof(short));
+	b->y = (short *)malloc(n * len * sizeof(short));
+	b->z = (short *)malloc(n * len * sizeof(short));
+	b->threshold = (short *)malloc(n * sizeof(short));
+	for (l = 0; l < n; l++){
+		int base = rand() % 65536 - 32768;
+
+		b->threshold[l] = rand() % 65536 - 32768;
+		for (i = 0; i < len; i++){
+			if (rand() % 16 == 0){
+				base = rand() % 65536 - 32768;
+			}
+			b->x[i * n + l] = (l & 1) ? base : rand() % 65536 - 32768;
+			b->y[i * n + l] = (l & 2) ? (short)(base + rand() % 4096 - 2048) : rand() % 65536 - 32768;
+			b->z[i * n + l] = (short)(base + rand() % 4096 - 2048);
+		}
+	}
+}
+
+static void batchFree(batch *b){
+	free(b->x);
+	free(b->y);
+	free(b->z);
+	free(b->threshold);
+}
+
+static long compare(const unsigned char *a, const unsigned char *b, long n){
+	long i, diff = 0;
+
+	for (i = 0; i < n; i++){
+		diff += a[i] != b[i];
+	}
+	return diff;
+}
+
+#ifdef MSP_CHECKED
+// Runs lane l of b through detect.c.
+static void detectLane(const batch *b, long l, const detect_param *p, int pitch_interval, unsigned char *out){
+	detect_state d;
+	long t;
+
+	detectInit(&d);
+	d.param = *p;
+	for (t = 0; t < b->len; t++){
+		accel_data a;
+
+		a.x = b->x[t * b->n + l];
+		a.y = b->y[t * b->n + l];
+		a.z = b->z[t * b->n + l];
+		if (pitch_interval > 0 && t % pitch_interval == 0){
+			detectUpdatePitch(&d, &a);
+		}
+		out[t] = detectStep(&d, &a) == DETECT_BRAKE;
+	}
+}
+#endif
+
+static int report(const char *what, const char *name, long diff, long n){
+	printf("%-12s %-10s %s (%ld of %ld samples differ)\n", what, name,
+			diff ? "MISMATCH" : "bit-exact", diff, n);
+	return diff != 0;
+}
+
+/*
+ * verify
+ * Flow:
+ * 1. Portable against detect.c, lane by lane (checked build only).
+ * 2. Each SIMD version this CPU has against the portable one.
+ */
+static int verify(const batch *b, const batch_param *bp, const detect_param *p, const char *what){
+	unsigned char *ref = (unsigned char *)malloc(b->n * b->len);
+	unsigned char *out = (unsigned char *)malloc(b->n * b->len);
+	int failed = 0, i;
+
+	batchPortable(b, bp, ref);
+#ifdef MSP_CHECKED
+	{
+		unsigned char *lane = (unsigned char *)malloc(b->len);
+		long diff = 0, l, t;
+
+		for (l = 0; l < b->n; l++){
+			detect_param lp = *p;
+
+			lp.threshold = b->threshold[l];
+			detectLane(b, l, &lp, bp->pitch_interval, lane);
+			for (t = 0; t < b->len; t++){
+				diff += lane[t] != ref[t * b->n + l];
+			}
+		}
+		failed |= report(what, "detect.c", diff, b->n * b->len);
+		free(lane);
+	}
+#else
+	(void)p;
+	printf("%-12s %-10s skipped, 32 bit host ints (build with -DMSP_CHECKED)\n", what, "detect.c");
+#endif
+
+	for (i = 1; i < N_IMPLS; i++){
+		if (!impls[i].available()){
+			printf("%-12s %-10s skipped, not supported by this CPU\n", what, impls[i].name);
+			continue;
+		}
+		memset(out, 0xAA, b->n * b->len);
+		impls[i].run(b, bp, out);
+		failed |= report(what, impls[i].name, compare(ref, out, b->n * b->len), b->n * b->len);
+	}
+
+	free(ref);
+	free(out);
+	return failed;
+}
+
+int main(int argc, char **argv){
+	replay_opts o = { PITCH_INTERVAL, 0 };
+	detect_state defaults;
+	batch_param bp;
+	trace_set set = { NULL, 0, NULL, 0 };
+	batch b;
+	const char *want = NULL;
+	int do_verify = 0;
+	int repeat = 1;
+	int i, c;
+
+	while ((c = getopt(argc, argv, "vi:R:p:w:")) != -1){
+		switch (c){
+		case 'v': do_verify = 1; break;
+		case 'i': want = optarg; break;
+		case 'R': repeat = atoi(optarg); break;
+		case 'p': o.pitch_interval = atoi(optarg); break;
+		case 'w': o.warmup = atol(optarg); break;
+		default:
+			fprintf(stderr, "usage: %s [-v] [-i portable|sse2|avx2] [-R repeat] "
+					"[-p pitch_interval] [-w warmup] trace.csv...\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind >= argc || repeat < 1){
+		fprintf(stderr, "usage: %s [options] trace.csv...\n", argv[0]);
+		return 2;
+	}
+
+	detectInit(&defaults);
+	bp.accel_shift = log2exact(defaults.param.accel_coeff);
+	bp.comp_shift = log2exact(defaults.param.comp_coeff);
+	if (bp.accel_shift < 0 || bp.comp_shift < 0){
+		fprintf(stderr, "ACCEL_COEFF and COMP_COEFF must be powers of two\n");
+		return 2;
+	}
+	bp.pitch_interval = o.pitch_interval;
+	bp.corner = CORNER_REJECT;
+	bp.noise = NOISE_ADAPT;
+	bp.bump = BUMP_WINDOW == 3;
+
+	for (i = optind; i < argc; i++){
+		if (traceSetAdd(&set, argv[i])){
+			tracePerror(argv[i]);
+			return 1;
+		}
+	}
+	batchFromTraces(&b, set.t, set.n, repeat, defaults.param.threshold);
+
+	if (do_verify){
+		detect_param p = defaults.param;
+		batch r;
+		int failed = 0;
+
+		batchRandom(&r, 64, 4096, 1);
+		failed |= verify(&b, &bp, &p, "traces");
+		failed |= verify(&r, &bp, &p, "random");
+		batchFree(&r);
+		batchFree(&b);
+		traceSetFree(&set);
+		return failed;
+	}
+
+	printf("%-10s %7s %7s %9s %9s %12s\n", "impl", "events", "hit", "lat_mean", "false", "samples/s");
+	for (i = 0; i < N_IMPLS; i++){
+		unsigned char *out;
+		score s;
+		double t0, secs;
+		long l, t;
+
+		if ((want && strcmp(want, impls[i].name)) || !impls[i].available()){
+			continue;
+		}
+		out = (unsigned char *)malloc(b.n * b.len);
+		t0 = now();
+		impls[i].run(&b, &bp, out);
+		secs = now() - t0;
+
+		scoreInit(&s);
+		for (l = 0; l < (long)set.n * repeat; l++){
+			const trace *tr = &set.t[l % set.n];
+			score_run r;
+
+			scoreRunInit(&r);
+			for (t = 0; t < tr->n; t++){
+				scoreRunStep(&r, &o, tr->s[t].brake, out[t * b.n + l], &s);
+			}
+		}
+		printf("%-10s %7ld %7ld %9.2f %9ld %12.0f\n", impls[i].name, s.events, s.detected,
+				s.detected ? (double)s.latency_sum / s.detected : 0.0,
+				s.false_triggers, (double)b.n * b.len / secs);
+		free(out);
+	}
+
+	batchFree(&b);
+	traceSetFree(&set);
+	return 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * batch_kernel.h
+ *
+ *  SIMD body of the batch evaluator, included once per instruction set
+ *  by batch.c with these defined:
+ *
+ *    KERNEL	function name
+ *    TARGET	__attribute__((target(...))) for it
+ *    W			lanes per vector (16 bit lanes)
+ *    V			vector type
+ *    and the V_* operation macros below.
+ *
+ *  Every step mirrors detectStep() with 16 bit wrap-around, see the
+ *  portable version in batch.c for the plain C reading of each line.
+ */
+
+TARGET static void KERNEL(const batch *b, const batch_param *bp, unsigned char *out){
+	const int ak = bp->accel_shift, ck = bp->comp_shift;
+	const V a_bias = V_SET1((1 << ak) - 1), a_mul = V_SET1((1 << ak) - 1);
+	const V c_bias = V_SET1((1 << ck) - 1), c_mul = V_SET1((1 << ck) - 1);
+	const V zero = V_SET1(0), one = V_SET1(1);
+	const V ct = V_SET1(CORNER_THRESHOLD >> 1), ch = V_SET1(CORNER_HOLD + 1);
+	const V nmin = V_SET1(NOISE_THRESHOLD_MIN), nmax = V_SET1(NOISE_THRESHOLD_MAX);
+	const V nin = V_SET1(NOISE_INPUT_MAX);
+	long g, t;
+
+// Truncating (C style) division by 1 << k: bias negatives by 2^k - 1.
+#define TDIV(x, k, bias) V_SRAI(V_ADD(x, V_AND(V_SRAI(x, 15), bias)), k)
+#define SMOOTH(prev, curr, k, bias, mul) \
+	V_ADD(V_MULLO(TDIV(prev, k, bias), mul), TDIV(curr, k, bias))
+
+	for (g = 0; g < b->n; g += W){
+		V comp_x = zero, comp_y = zero, comp_z = zero, q = zero;
+		V lat = zero, corner = zero;
+		V noise = V_SET1((NOISE_REF >> NOISE_SCALE) << NOISE_WINDOW);
+		V cur = zero, brake = zero;
+		V m0 = zero, m1 = zero;		// last two inputs to the median
+		V base = V_LOADU(&b->threshold[g]), thr = base;
+
+		for (t = 0; t < b->len; t++){
+			V x = V_LOADU(&b->x[t * b->n + g]);
+			V y = V_LOADU(&b->y[t * b->n + g]);
+			V z = V_LOADU(&b->z[t * b->n + g]);
+			V cornering, a, on, r, n, lim;
+
+			if (bp->pitch_interval > 0 && t % bp->pitch_interval == 0){
+				short cx[W], cz[W], qq[W];
+				int l;
+
+				comp_x = SMOOTH(comp_x, x, ck, c_bias, c_mul);
+				comp_y = SMOOTH(comp_y, y, ck, c_bias, c_mul);
+				comp_z = SMOOTH(comp_z, z, ck, c_bias, c_mul);
+				// No vector divide; this only runs once per pitch interval.
+				V_STOREU(cx, comp_x);
+				V_STOREU(cz, comp_z);
+				for (l = 0; l < W; l++){
+					qq[l] = cx[l] ? (short)(cz[l] / cx[l]) : 0;
+				}
+				q = V_LOADU(qq);
+			}
+
+			z = V_SUB(z, comp_z);
+			z = V_SUB(z, V_MULLO(q, z));		// q is 0 while comp_x is 0
+
+			if (bp->corner){
+				lat = V_ADD(lat, V_SRAI(V_SUB(V_SUB(V_SRAI(y, 1), V_SRAI(comp_y, 1)), lat), CORNER_SMOOTH));
+				a = V_ABS(lat);
+				on = V_AND(V_CMPGT(a, ct), V_CMPGT(V_SRAI(a, CORNER_DOMINANCE), V_SRAI(V_ABS(cur), 1)));
+				corner = V_OR(V_AND(on, ch), V_ANDNOT(on, corner));
+				cornering = V_CMPGT(corner, zero);
+				corner = V_SUBS_EPU(corner, one);
+				z = V_OR(V_AND(cornering, V_SRAI(z, CORNER_ATTEN)), V_ANDNOT(cornering, z));
+			}
+
+			if (bp->bump){
+				// median of three = max(min(a,b), min(max(a,b),c))
+				V med = V_MAX(V_MIN(m0, m1), V_MIN(V_MAX(m0, m1), z));
+				m0 = m1;
+				m1 = z;
+				z = med;
+			}
+
+			if (bp->noise){
+				// r and n stay far below 32768, so signed compares do; the sum needs the logical shift.
+				r = V_SRAI(V_ABS(V_SUB(V_SRAI(z, 1), V_SRAI(cur, 1))), NOISE_SCALE - 1);
+				n = V_SRLI(noise, NOISE_WINDOW);
+				thr = V_ADD(V_SUB(base, V_SET1(NOISE_REF << NOISE_GAIN)), V_SLLI(n, NOISE_SCALE + NOISE_GAIN));
+				thr = V_MIN(V_MAX(thr, nmin), nmax);
+				lim = V_SLLI(V_ADD(n, one), NOISE_CLIP);
+				r = V_MIN(V_MIN(r, lim), nin);
+				noise = V_ADD(noise, V_ANDNOT(brake, V_SUB(r, n)));
+			}
+
+			cur = SMOOTH(cur, z, ak, a_bias, a_mul);
+
+			// abs(-32768) stays -32768 on a 16 bit int, and so it does here.
+			brake = V_CMPGT(V_ABS(cur), thr);
+
+			V_STORE_MASK(&out[t * b->n + g], brake);
+		}
+	}
+#undef TDIV
+#undef SMOOTH
+}
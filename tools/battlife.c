@@ -0,0 +1,334 @@
+/*
+ * battlife.c
+ *
+ *  Battery life of the light over a ride, predicted on the simulator.
+ *
+ *  Runs a firmware image on the CPU model (cpu430.c) with the G2231
+ *  peripherals (g2231.c) and a virtual MPU-6050 (vmpu.c), fed from a
+ *  ride trace as tools/latency does, and integrates the current of
+ *  every part in the state the run puts it in (power.h): CPU active or
+ *  in LPM0/3/4, the sensor's power mode, LEDs lit (PWM duty included),
+ *  ADC10 and reference, I2C traffic. Time and charge are split by the
+ *  trace's brake label, so the report shows whether braking or cruising
+ *  dominates and which part.
+ *
+ *  The battery is a capacity and a discharge curve, a list of
+ *  "mV:fraction used" points. The firmware sees the supply through the
+ *  ADC10 (g2231.c vcc_mv), and its power governor (libs/battery.h)
+ *  changes what it does as the voltage drops, so the run is repeated for
+ *  each segment of the curve at the segment's mean voltage, and the
+ *  segment lasts (capacity * fraction) / mean current. The trace loops
+ *  if it is shorter than -n samples.
+ *
+ *  Build (from the repository root):
+ *    cc -O2 -Iauto_brake_light_2/libs -o battlife tools/battlife.c \
+ *        tools/power.c tools/cpu430.c tools/elf430.c tools/g2231.c \
+ *        tools/vmpu.c tools/fault.c tools/trace.c
+ *
+ *  Usage:
+ *    battlife [-p profile] [-c capacity_mah] [-v curve] [-m mhz]
+ *             [-n samples] [-r rate_hz] [-t trace.csv] [-l] [-q]
+ *             image.elf | object.o...
+ *
+ *  -p takes power.h settings ("led=15000 lpm3=0.5"), -l lists the keys
+ *  with their values, -m charges awake time as if the DCO ran at 8, 12
+ *  or 16 MHz, -q prints the predicted hours only (tools/powerdelta.sh).
+ *  Without -t the sensor reports 1 g along X, at rest.
+ */
+
+#include "cpu430.h"
+#include "elf430.h"
+#include "g2231.h"
+#include "power.h"
+#include "trace.h"
+#include "vmpu.h"
+
+#include <mpu6050.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define REST_X 16384		// 1 g at AFS_SEL 0
+#define MAX_POINTS 16
+#define DEFAULT_CURVE "3100:0,2900:0.1,2600:0.5,2400:0.75,2200:0.9,2000:1"	// 2 x alkaline
+
+typedef struct point_struct{
+	int mv;
+	double used;
+} point;
+
+static cpu430 cpu;
+static vmpu mpu;
+static g2231 periph;
+
+/*
+ * boot
+ * Fresh part and sensor with the firmware loaded. Returns 0, or -1.
+ */
+static int boot(char **files, int n_files){
+	elf430 e;
+	int i, ok = 1;
+
+	memset(&cpu, 0, sizeof(cpu));
+	elf430Init(&e);
+	for (i = 0; i < n_files && ok; i++){
+		ok = !elf430Load(&e, &cpu, files[i]);
+	}
+	ok = ok && !elf430Link(&e, &cpu);
+	if (ok && !e.is_image){
+		fprintf(stderr, "no reset vector: need a firmware image\n");
+		ok = 0;
+	}
+	elf430Free(&e);
+	if (!ok){
+		return -1;
+	}
+
+	vmpuInit(&mpu);
+	g2231Init(&periph, &cpu, &mpu);
+	cpu430Reset(&cpu);
+	return 0;
+}
+
+/*
+ * run
+ * One ride, from reset.
+ * Flow:
+ * 1. Deliver samples at the trace rate; the label of the last one
+ *    delivered is the label of the time that follows.
+ * 2. Take the power state, step the CPU (or skip ahead while it
+ *    sleeps), and charge the cycles that took to that state.
+ * Returns 0, or -1 if the firmware went off the rails.
+ */
+static int run(const trace *t, long max_samples, unsigned long long period,
+		const power_profile *p, power_meter *m){
+	unsigned long long next_sample = period;
+	unsigned long long end = period * (max_samples + 1);
+	long delivered = 0;
+	int braking = 0;
+
+	while (cpu.cycles < end){
+		unsigned long long before;
+		power_state s;
+		int n;
+
+		if (cpu.cycles >= next_sample && delivered < max_samples){
+			const trace_sample *ts = t->n ? &t->s[delivered % t->n] : NULL;
+
+			vmpuSample(&mpu, ts ? ts->x : REST_X, ts ? ts->y : 0, ts ? ts->z : 0,
+					MPU6050_TEMP_RAW(20), next_sample);
+			braking = ts && ts->brake;
+			delivered++;
+			next_sample += period;
+		}
+
+		g2231Tick(&periph);
+		powerState(&periph, &s);
+		before = cpu.cycles;
+
+		n = cpu430Step(&cpu);
+		if (n < 0){
+			fprintf(stderr, "illegal instruction 0x%04x at 0x%04x\n",
+					cpu430Read(&cpu, cpu.pc, 0), cpu.pc);
+			return -1;
+		}
+		if (!n){
+			// Asleep: skip to whatever happens next.
+			unsigned long long next = g2231NextEvent(&periph);
+
+			if (delivered < max_samples && (!next || next_sample < next)){
+				next = next_sample;
+			}
+			if (!next || next > end){
+				next = end;
+			}
+			if (next > cpu.cycles){
+				cpu.cycles = next;
+			}
+		}
+		powerAdd(m, p, &s, braking, (double)(cpu.cycles - before));
+	}
+	return 0;
+}
+
+/*
+ * parseCurve
+ * "mV:used,..." with the voltage falling and the fraction used rising
+ * from 0 to 1. Returns the number of points, or -1.
+ */
+static int parseCurve(const char *spec, point *pts){
+	const char *p = spec;
+	int n = 0;
+
+	while (*p){
+		char *end;
+
+		if (n == MAX_POINTS){
+			fprintf(stderr, "curve: more than %d points\n", MAX_POINTS);
+			return -1;
+		}
+		pts[n].mv = (int)strtol(p, &end, 10);
+		if (*end != ':'){
+			break;
+		}
+		pts[n].used = strtod(end + 1, &end);
+		if ((*end && *end != ',') || (n && (pts[n].mv >= pts[n - 1].mv || pts[n].used <= pts[n - 1].used))){
+			break;
+		}
+		n++;
+		p = *end ? end + 1 : end;
+	}
+	if (*p || n < 2 || pts[0].used != 0 || pts[n - 1].used != 1){
+		fprintf(stderr, "curve '%s': expected mV:used points, voltage falling, used from 0 to 1\n", spec);
+		return -1;
+	}
+	return n;
+}
+
+static void usage(const char *argv0){
+	fprintf(stderr, "usage: %s [-p profile] [-c capacity_mah] [-v curve] [-m mhz] [-n samples] "
+			"[-r rate_hz] [-t trace.csv] [-l] [-q] image.elf | object.o...\n", argv0);
+}
+
+int main(int argc, char **argv){
+	static power_meter meters[MAX_POINTS];
+	static double hours[MAX_POINTS];
+	point pts[MAX_POINTS];
+	power_profile prof;
+	trace_set set = { NULL, 0, NULL, 0 };
+	trace t = { .rate_hz = TRACE_DEFAULT_RATE };
+	const char *trace_path = NULL;
+	const char *curve = DEFAULT_CURVE;
+	double capacity = 1000, total = 0, time_brake = 0, charge_brake = 0;
+	long max_samples = 0;
+	int rate_hz = 0, quiet = 0, list = 0;
+	int c, i, k, n_pts;
+
+	powerDefaults(&prof);
+	while ((c = getopt(argc, argv, "p:c:v:m:n:r:t:lq")) != -1){
+		switch (c){
+		case 'p':
+			if (powerParse(&prof, optarg)){
+				return 1;
+			}
+			break;
+		case 'c': capacity = atof(optarg); break;
+		case 'v': curve = optarg; break;
+		case 'm': prof.mhz = atoi(optarg); break;
+		case 'n': max_samples = atol(optarg); break;
+		case 'r': rate_hz = atoi(optarg); break;
+		case 't': trace_path = optarg; break;
+		case 'l': list = 1; break;
+		case 'q': quiet = 1; break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	if (list){
+		for (k = 0; k < POWER_KEYS; k++){
+			printf("%-14s %10.1f uA\n", power_keys[k], prof.ua[k]);
+		}
+		return 0;
+	}
+	if (optind >= argc){
+		usage(argv[0]);
+		return 2;
+	}
+	if (prof.mhz != 1 && prof.mhz != 8 && prof.mhz != 12 && prof.mhz != 16){
+		fprintf(stderr, "-m: DCO setting must be 1, 8, 12 or 16 MHz\n");
+		return 2;
+	}
+	if (capacity <= 0){
+		fprintf(stderr, "-c: capacity must be positive\n");
+		return 2;
+	}
+	n_pts = parseCurve(curve, pts);
+	if (n_pts < 0){
+		return 2;
+	}
+	if (trace_path){
+		if (traceSetOne(&set, trace_path)){
+			tracePerror(trace_path);
+			return 1;
+		}
+		t = set.t[0];
+	}
+	if (!rate_hz){
+		rate_hz = t.rate_hz;
+	}
+	if (!max_samples){
+		max_samples = t.n ? t.n : 500;
+	}
+
+	for (i = 0; i + 1 < n_pts; i++){
+		double ua;
+
+		if (boot(argv + optind, argc - optind)){
+			return 1;
+		}
+		periph.vcc_mv = (pts[i].mv + pts[i + 1].mv) / 2;
+		if (run(&t, max_samples, 1000000ULL / rate_hz, &prof, &meters[i])){
+			fprintf(stderr, "at %d mV\n", periph.vcc_mv);
+			return 1;
+		}
+		ua = powerMean(&meters[i], -1, -1);
+		hours[i] = ua > 0 ? capacity * 1000 * (pts[i + 1].used - pts[i].used) / ua : 0;
+		total += hours[i];
+	}
+
+	if (quiet){
+		printf("%.1f\n", total);
+		traceSetFree(&set);
+		return 0;
+	}
+
+	printf("%ld samples per run at %d Hz, %.0f mAh, DCO %d MHz\n\n", max_samples, rate_hz, capacity, prof.mhz);
+	printf("%-11s %6s %6s %10s %10s %10s %9s\n", "segment", "used%", "mV", "cruise uA", "brake uA",
+			"mean uA", "hours");
+	for (i = 0; i + 1 < n_pts; i++){
+		char seg[24];
+
+		snprintf(seg, sizeof(seg), "%d-%d", pts[i].mv, pts[i + 1].mv);
+		printf("%-11s %6.0f %6d %10.1f %10.1f %10.1f %9.1f\n", seg,
+				100 * (pts[i + 1].used - pts[i].used), (pts[i].mv + pts[i + 1].mv) / 2,
+				powerMean(&meters[i], -1, 0), powerMean(&meters[i], -1, 1),
+				powerMean(&meters[i], -1, -1), hours[i]);
+		if (meters[i].time[0] + meters[i].time[1] > 0){
+			double t_all = meters[i].time[0] + meters[i].time[1];
+
+			time_brake += hours[i] * meters[i].time[1] / t_all;
+			charge_brake += (pts[i + 1].used - pts[i].used) * powerMean(&meters[i], -1, 1) * meters[i].time[1]
+					/ (powerMean(&meters[i], -1, -1) * t_all);
+		}
+	}
+	printf("%-11s %6s %6s %10s %10s %10s %9.1f\n\n", "total", "", "", "", "", "", total);
+
+	// Per part, each segment weighted by how long it lasts.
+	printf("%-13s %10s %10s %10s %7s\n", "part", "cruise uA", "brake uA", "mean uA", "share");
+	if (total > 0){
+		double all = 0;
+
+		for (i = 0; i + 1 < n_pts; i++){
+			all += hours[i] * powerMean(&meters[i], -1, -1);
+		}
+		for (k = 0; k < POWER_PARTS; k++){
+			double cruise = 0, brake = 0, mean = 0;
+
+			for (i = 0; i + 1 < n_pts; i++){
+				cruise += hours[i] * powerMean(&meters[i], k, 0);
+				brake += hours[i] * powerMean(&meters[i], k, 1);
+				mean += hours[i] * powerMean(&meters[i], k, -1);
+			}
+			printf("%-13s %10.1f %10.1f %10.1f %6.1f%%\n", power_parts[k], cruise / total,
+					brake / total, mean / total, all > 0 ? 100 * mean / all : 0.0);
+		}
+		printf("\nbraking: %.1f%% of the time, %.1f%% of the charge\n", 100 * time_brake / total,
+				100 * charge_brake);
+	}
+
+	traceSetFree(&set);
+	return 0;
+}
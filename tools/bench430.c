@@ -0,0 +1,102 @@
+/*
+ * bench430.c
+ *
+ *  Standard cycle benchmark, built for the MSP430 (not the host) and
+ *  run on the simulator by cyclebench.sh.
+ *
+ *  Runs a short recorded brake onset through the detection pipeline
+ *  exactly as main() does, then switches the CPU off, which ends the
+ *  simulation. The table that cycles prints for it breaks the time down
+ *  by function (detectStep(), smoothFilter(), the compiler's divide
+ *  helpers, ...). A RIDELOG build also logs every sample and commits
+ *  the window on each brake onset, as main() does; the simulator has no
+ *  flash controller, so the CPU hold during an erase or write is not in
+ *  the figures (see ridelog.h).
+ */
+
+#include <msp430.h>
+#include <detect.h>
+#include <ridelog.h>
+
+// Raw samples around a brake onset (x, y, z).
+static const accel_data samples[] = {
+	{ 17063, 0, -410 },
+	{ 16527, 0, -27 },
+	{ 16474, 0, 406 },
+	{ 16756, 0, -47 },
+	{ 16217, 0, -408 },
+	{ 16363, 0, 374 },
+	{ 16386, 0, 1962 },
+	{ 16219, 0, 4520 },
+	{ 15972, 0, 5657 },
+	{ 15942, 0, 4958 },
+	{ 16186, 0, 5680 },
+	{ 16262, 0, 5748 },
+	{ 16747, 0, 4997 },
+	{ 16296, 0, 5772 },
+	{ 16005, 0, 5409 },
+	{ 16199, 0, 5390 },
+	{ 16606, 0, 5545 },
+	{ 16725, 0, 5683 },
+	{ 16490, 0, 5568 },
+	{ 16220, 0, 5331 },
+	{ 16475, 0, 5180 },
+	{ 16496, 0, 5386 },
+	{ 15850, 0, 5513 },
+	{ 17032, 0, 5858 },
+	{ 16624, 0, 5976 },
+	{ 16938, 0, 5465 },
+	{ 16324, 0, 5646 },
+	{ 15714, 0, 5457 },
+	{ 16213, 0, 6128 },
+	{ 16798, 0, 6029 },
+	{ 16640, 0, 5568 },
+	{ 16828, 0, 5208 },
+};
+
+#define N_SAMPLES (sizeof(samples) / sizeof(samples[0]))
+#define ROUNDS 4
+
+int main(void){
+	detect_state detector;
+	char pitch_count = 0;
+	unsigned char i, r;
+#if RIDELOG
+	char logged_state = DETECT_IDLE;
+#endif
+
+	WDTCTL = WDTPW | WDTHOLD;
+
+	detectInit(&detector);
+#if RIDELOG
+	ridelogInit();
+#endif
+#if TEMP_COMP
+	detectUpdateTemperature(&detector, MPU6050_TEMP_RAW(25));
+#endif
+	for (r = 0; r < ROUNDS; r++){
+		for (i = 0; i < N_SAMPLES; i++){
+			accel_data a = samples[i];
+
+#if RIDELOG
+			ridelogSample(a.x, a.y, a.z);
+#endif
+			if (++pitch_count >= PITCH_INTERVAL){
+				detectUpdatePitch(&detector, &a);
+				pitch_count = 0;
+			}
+			detectStep(&detector, &a);
+#if RIDELOG
+			if (detector.state != logged_state){
+				logged_state = detector.state;
+				if (logged_state == DETECT_BRAKE){
+					ridelogCommit();
+				}
+			}
+#endif
+		}
+	}
+
+	_BIS_SR(LPM4_bits);		// GIE clear: the simulator stops here
+	return 0;
+}
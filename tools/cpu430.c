@@ -0,0 +1,439 @@
+/*
+ * cpu430.c
+ *
+ *  MSP430 CPU core. See cpu430.h.
+ */
+
+#include "cpu430.h"
+
+#include <string.h>
+
+#define PC 0
+#define SP 1
+#define SR 2
+#define CG 3
+
+// Operand classes, in the order of the cycle tables below.
+enum{ OP_REG, OP_IND, OP_AINC, OP_IMM, OP_IDX };
+
+typedef struct operand_struct{
+	int cls;
+	int reg;			// >= 0: register operand
+	unsigned int addr;	// memory operand (reg < 0, !is_const)
+	unsigned int val;	// constant operand
+	int is_const;
+} operand;
+
+/*
+ * SLAU144 "Format I" table: rows are the source class, columns the
+ * destination (register, PC, memory).
+ */
+static const unsigned char cycles_fmt1[5][3] = {
+	{ 1, 2, 4 },	// Rn
+	{ 2, 2, 5 },	// @Rn
+	{ 2, 3, 5 },	// @Rn+
+	{ 2, 3, 5 },	// #N
+	{ 3, 3, 6 },	// x(Rn), EDE, &EDE
+};
+// "Format II": RRA/RRC/SWPB/SXT, PUSH, CALL.
+static const unsigned char cycles_rot[5] = { 1, 3, 3, 3, 4 };
+static const unsigned char cycles_push[5] = { 3, 4, 4, 4, 5 };
+static const unsigned char cycles_call[5] = { 4, 4, 5, 5, 5 };
+
+unsigned int cpu430Read(cpu430 *c, unsigned int addr, int byte){
+	addr &= 0xFFFF;
+	if (!byte){
+		addr &= ~1u;
+	}
+	if (addr < CPU430_PERIPH_END && c->io_read){
+		return c->io_read(c, addr, byte);
+	}
+	if (byte){
+		return c->mem[addr];
+	}
+	return c->mem[addr] | (c->mem[addr + 1] << 8);
+}
+
+void cpu430Write(cpu430 *c, unsigned int addr, unsigned int val, int byte){
+	addr &= 0xFFFF;
+	if (!byte){
+		addr &= ~1u;
+	}
+	if (addr < CPU430_PERIPH_END && c->io_write){
+		c->io_write(c, addr, val, byte);
+		return;
+	}
+	c->mem[addr] = val;
+	if (!byte){
+		c->mem[addr + 1] = val >> 8;
+	}
+}
+
+void cpu430Reset(cpu430 *c){
+	memset(c->r, 0, sizeof(c->r));
+	c->r[PC] = cpu430Read(c, 0xFFFE, 0);
+	c->irq = 0;
+	c->event = CPU430_EV_NONE;
+}
+
+void cpu430Irq(cpu430 *c, int vector){
+	c->irq |= 1u << vector;
+}
+
+static unsigned int fetch(cpu430 *c){
+	unsigned int w = cpu430Read(c, c->r[PC], 0);
+
+	c->r[PC] += 2;
+	return w;
+}
+
+static void push(cpu430 *c, unsigned int val){
+	c->r[SP] -= 2;
+	cpu430Write(c, c->r[SP], val, 0);
+}
+
+static unsigned int pop(cpu430 *c){
+	unsigned int val = cpu430Read(c, c->r[SP], 0);
+
+	c->r[SP] += 2;
+	return val;
+}
+
+/*
+ * srcOperand
+ * Decodes a source (or Format II) operand, including the constant
+ * generator encodings, and applies @Rn+ increments.
+ */
+static void srcOperand(cpu430 *c, operand *o, int as, int reg, int byte){
+	unsigned int ext;
+
+	o->reg = -1;
+	o->is_const = 0;
+	o->cls = OP_REG;
+
+	if (reg == CG){
+		static const unsigned int cg[4] = { 0, 1, 2, 0xFFFF };
+		o->is_const = 1;
+		o->val = cg[as];
+		return;
+	}
+	if (reg == SR && as >= 2){
+		o->is_const = 1;
+		o->val = as == 2 ? 4 : 8;
+		return;
+	}
+
+	switch (as){
+	case 0:
+		o->reg = reg;
+		break;
+	case 1:
+		o->cls = OP_IDX;
+		ext = c->r[PC];
+		o->addr = fetch(c);
+		if (reg == PC){
+			o->addr += ext;				// symbolic: relative to the extension word
+		} else if (reg != SR){
+			o->addr += c->r[reg];		// SR here means absolute (&EDE)
+		}
+		o->addr &= 0xFFFF;
+		break;
+	case 2:
+		o->cls = OP_IND;
+		o->addr = c->r[reg];
+		break;
+	case 3:
+		if (reg == PC){
+			o->cls = OP_IMM;
+			o->is_const = 1;
+			o->val = fetch(c);
+		} else {
+			o->cls = OP_AINC;
+			o->addr = c->r[reg];
+			c->r[reg] += (byte && reg != SP) ? 1 : 2;
+		}
+		break;
+	}
+}
+
+static void dstOperand(cpu430 *c, operand *o, int ad, int reg){
+	unsigned int ext;
+
+	o->is_const = 0;
+	o->addr = 0;
+	if (!ad){
+		o->reg = reg;
+		return;
+	}
+	o->reg = -1;
+	ext = c->r[PC];
+	o->addr = fetch(c);
+	if (reg == PC){
+		o->addr += ext;
+	} else if (reg != SR){
+		o->addr += c->r[reg];
+	}
+	o->addr &= 0xFFFF;
+}
+
+static unsigned int readOperand(cpu430 *c, const operand *o, int byte){
+	unsigned int v;
+
+	if (o->is_const){
+		v = o->val;
+	} else if (o->reg >= 0){
+		v = c->r[o->reg];
+	} else {
+		return cpu430Read(c, o->addr, byte);
+	}
+	return byte ? (v & 0xFF) : (v & 0xFFFF);
+}
+
+static void writeOperand(cpu430 *c, const operand *o, unsigned int v, int byte){
+	v &= byte ? 0xFF : 0xFFFF;
+	if (o->is_const){
+		return;
+	}
+	if (o->reg < 0){
+		cpu430Write(c, o->addr, v, byte);
+	} else if (o->reg == PC || o->reg == SP){
+		c->r[o->reg] = v & 0xFFFE;
+	} else if (o->reg != CG){
+		c->r[o->reg] = v;		// .B clears the upper byte of a register
+	}
+}
+
+static void setNZ(cpu430 *c, unsigned int res, int byte){
+	unsigned int msb = byte ? 0x80 : 0x8000;
+
+	c->r[SR] &= ~(CPU430_N | CPU430_Z);
+	if (!res){
+		c->r[SR] |= CPU430_Z;
+	}
+	if (res & msb){
+		c->r[SR] |= CPU430_N;
+	}
+}
+
+// Sets C and V; the caller sets N and Z from the result.
+static unsigned int add(cpu430 *c, unsigned int a, unsigned int b, unsigned int carry, int byte){
+	unsigned int mask = byte ? 0xFF : 0xFFFF;
+	unsigned int msb = byte ? 0x80 : 0x8000;
+	unsigned int r = (a & mask) + (b & mask) + carry;
+	unsigned int res = r & mask;
+
+	c->r[SR] &= ~(CPU430_C | CPU430_V);
+	if (r > mask){
+		c->r[SR] |= CPU430_C;
+	}
+	if (~(a ^ b) & (a ^ res) & msb){
+		c->r[SR] |= CPU430_V;
+	}
+	setNZ(c, res, byte);
+	return res;
+}
+
+static unsigned int dadd(cpu430 *c, unsigned int a, unsigned int b, int byte){
+	unsigned int carry = c->r[SR] & CPU430_C;
+	unsigned int res = 0;
+	int i;
+
+	for (i = 0; i < (byte ? 2 : 4); i++){
+		unsigned int d = ((a >> (4 * i)) & 0xF) + ((b >> (4 * i)) & 0xF) + carry;
+
+		carry = d > 9;
+		if (carry){
+			d -= 10;
+		}
+		res |= (d & 0xF) << (4 * i);
+	}
+	c->r[SR] &= ~(CPU430_C | CPU430_V);
+	if (carry){
+		c->r[SR] |= CPU430_C;
+	}
+	setNZ(c, res, byte);
+	return res;
+}
+
+// BIT, AND, SXT: C is "not zero", V is cleared.
+static void logicFlags(cpu430 *c, unsigned int res, int byte){
+	setNZ(c, res, byte);
+	c->r[SR] &= ~(CPU430_C | CPU430_V);
+	if (!(c->r[SR] & CPU430_Z)){
+		c->r[SR] |= CPU430_C;
+	}
+}
+
+static int formatOne(cpu430 *c, unsigned int op){
+	int opcode = op >> 12;
+	int src = (op >> 8) & 0xF, ad = (op >> 7) & 1, byte = (op >> 6) & 1;
+	int as = (op >> 4) & 3, dst = op & 0xF;
+	operand s, d;
+	unsigned int a, b, res = 0;
+	int write = 1;
+
+	srcOperand(c, &s, as, src, byte);
+	b = readOperand(c, &s, byte);
+	dstOperand(c, &d, ad, dst);
+	a = (opcode == 4) ? 0 : readOperand(c, &d, byte);	// MOV does not read its destination
+
+	switch (opcode){
+	case 0x4: res = b; break;															// MOV
+	case 0x5: res = add(c, a, b, 0, byte); break;										// ADD
+	case 0x6: res = add(c, a, b, c->r[SR] & CPU430_C, byte); break;						// ADDC
+	case 0x7: res = add(c, a, ~b, c->r[SR] & CPU430_C, byte); break;					// SUBC
+	case 0x8: res = add(c, a, ~b, 1, byte); break;										// SUB
+	case 0x9: add(c, a, ~b, 1, byte); write = 0; break;									// CMP
+	case 0xA: res = dadd(c, a, b, byte); break;											// DADD
+	case 0xB: logicFlags(c, a & b, byte); write = 0; break;								// BIT
+	case 0xC: res = a & ~b; break;														// BIC
+	case 0xD: res = a | b; break;														// BIS
+	case 0xE:																			// XOR
+		res = a ^ b;
+		logicFlags(c, res, byte);
+		if (a & b & (byte ? 0x80 : 0x8000)){
+			c->r[SR] |= CPU430_V;
+		}
+		break;
+	case 0xF: res = a & b; logicFlags(c, res, byte); break;								// AND
+	}
+	if (write){
+		writeOperand(c, &d, res, byte);
+	}
+
+	if (opcode == 4 && op == 0x4130){
+		c->event = CPU430_EV_RET;
+	}
+	if (s.is_const && s.cls != OP_IMM){
+		s.cls = OP_REG;			// constant generator: register timing
+	}
+	return cycles_fmt1[s.cls][ad ? 2 : (dst == PC ? 1 : 0)];
+}
+
+static int formatTwo(cpu430 *c, unsigned int op){
+	int opcode = (op >> 7) & 7, byte = (op >> 6) & 1;
+	int as = (op >> 4) & 3, reg = op & 0xF;
+	unsigned int msb = byte ? 0x80 : 0x8000;
+	unsigned int v, res, carry;
+	operand o;
+
+	if (opcode == 6){		// RETI
+		c->r[SR] = pop(c);
+		c->r[PC] = pop(c);
+		c->event = CPU430_EV_RETI;
+		return 5;
+	}
+	if (opcode == 7){
+		return -1;
+	}
+
+	srcOperand(c, &o, as, reg, byte);
+	v = readOperand(c, &o, byte);
+	if (o.is_const && o.cls != OP_IMM){
+		o.cls = OP_REG;
+	}
+	// @Rn+ operands are written back to where they were read from.
+
+	switch (opcode){
+	case 0:					// RRC
+		carry = c->r[SR] & CPU430_C;
+		res = (v >> 1) | (carry ? msb : 0);
+		setNZ(c, res, byte);
+		c->r[SR] &= ~(CPU430_C | CPU430_V);
+		c->r[SR] |= v & 1;
+		writeOperand(c, &o, res, byte);
+		return cycles_rot[o.cls];
+	case 1:					// SWPB
+		writeOperand(c, &o, ((v >> 8) | (v << 8)) & 0xFFFF, 0);
+		return cycles_rot[o.cls];
+	case 2:					// RRA
+		res = (v >> 1) | (v & msb);
+		setNZ(c, res, byte);
+		c->r[SR] &= ~(CPU430_C | CPU430_V);
+		c->r[SR] |= v & 1;
+		writeOperand(c, &o, res, byte);
+		return cycles_rot[o.cls];
+	case 3:					// SXT
+		res = (v & 0x80) ? (v | 0xFF00) : (v & 0xFF);
+		logicFlags(c, res, 0);
+		writeOperand(c, &o, res, 0);
+		return cycles_rot[o.cls];
+	case 4:					// PUSH
+		c->r[SP] -= 2;
+		cpu430Write(c, c->r[SP], v, byte);
+		return cycles_push[o.cls];
+	case 5:					// CALL
+		push(c, c->r[PC]);
+		c->r[PC] = v & 0xFFFE;
+		c->event = CPU430_EV_CALL;
+		return cycles_call[o.cls];
+	}
+	return -1;
+}
+
+static int jump(cpu430 *c, unsigned int op){
+	unsigned int sr = c->r[SR];
+	int n = !!(sr & CPU430_N), v = !!(sr & CPU430_V);
+	int taken = 0;
+	int offset = op & 0x3FF;
+
+	switch ((op >> 10) & 7){
+	case 0: taken = !(sr & CPU430_Z); break;	// JNE
+	case 1: taken = !!(sr & CPU430_Z); break;	// JEQ
+	case 2: taken = !(sr & CPU430_C); break;	// JNC
+	case 3: taken = !!(sr & CPU430_C); break;	// JC
+	case 4: taken = n; break;					// JN
+	case 5: taken = n == v; break;				// JGE
+	case 6: taken = n != v; break;				// JL
+	case 7: taken = 1; break;					// JMP
+	}
+	if (taken){
+		if (offset & 0x200){
+			offset -= 0x400;
+		}
+		c->r[PC] += 2 * offset;
+	}
+	return 2;
+}
+
+int cpu430Step(cpu430 *c){
+	unsigned int op;
+	int cyc;
+
+	c->event = CPU430_EV_NONE;
+	c->pc = c->r[PC];
+
+	if ((c->r[SR] & CPU430_GIE) && c->irq){
+		int v = 15;
+
+		while (!(c->irq & (1u << v))){
+			v--;
+		}
+		c->irq &= ~(1u << v);
+		push(c, c->r[PC]);
+		push(c, c->r[SR]);
+		c->r[SR] &= 0x0040;				// everything but SCG0 is cleared
+		c->r[PC] = cpu430Read(c, 0xFFE0 + 2 * v, 0);
+		c->event = CPU430_EV_IRQ;
+		c->cycles += 6;
+		return 6;
+	}
+	if (c->r[SR] & CPU430_CPUOFF){
+		return 0;
+	}
+
+	op = fetch(c);
+	if (op >= 0x4000){
+		cyc = formatOne(c, op);
+	} else if (op >= 0x2000){
+		cyc = jump(c, op);
+	} else if ((op & 0xFC00) == 0x1000){
+		cyc = formatTwo(c, op);
+	} else {
+		cyc = -1;
+	}
+	if (cyc > 0){
+		c->cycles += cyc;
+	}
+	return cyc;
+}
@@ -0,0 +1,74 @@
+/*
+ * cpu430.h
+ *
+ *  MSP430 CPU core for the host-side simulator tools.
+ *
+ *  Implements the original (non-X) MSP430 instruction set of the G2xx
+ *  parts, with cycle counts from the MSP430x2xx family user's guide
+ *  (SLAU144, "Instruction Cycles and Lengths"). Memory is a flat 64 KB;
+ *  reads and writes below 0x0200 (the peripheral space) can be hooked
+ *  so that a tool can model whichever peripherals it needs.
+ *
+ *  Interrupts are requested with cpu430Irq() by vector number, i.e.
+ *  (vector address - 0xFFE0) / 2, so PORT1_VECTOR is 2 and
+ *  TIMERA0_VECTOR is 9. Higher numbers have higher priority, as on the
+ *  device. The bit is cleared when the interrupt is accepted; a
+ *  peripheral whose flag stays set must request it again.
+ */
+
+#ifndef CPU430_H_
+#define CPU430_H_
+
+#define CPU430_PERIPH_END 0x0200	// hooked address space is [0, this)
+
+// SR bits
+#define CPU430_C 0x0001
+#define CPU430_Z 0x0002
+#define CPU430_N 0x0004
+#define CPU430_GIE 0x0008
+#define CPU430_CPUOFF 0x0010
+#define CPU430_V 0x0100
+
+// What the last cpu430Step() did besides plain execution.
+enum cpu430_event{
+	CPU430_EV_NONE,
+	CPU430_EV_CALL,		// CALL executed, target in pc
+	CPU430_EV_RET,		// RET (MOV @SP+,PC) executed
+	CPU430_EV_IRQ,		// interrupt accepted, handler in pc
+	CPU430_EV_RETI
+};
+
+typedef struct cpu430_struct cpu430;
+
+// Returns the value read. byte is 1 for .B accesses.
+typedef unsigned int (*cpu430_read_fn)(cpu430 *c, unsigned int addr, int byte);
+// Called instead of the store. The hook may update c->mem itself.
+typedef void (*cpu430_write_fn)(cpu430 *c, unsigned int addr, unsigned int val, int byte);
+
+struct cpu430_struct{
+	unsigned short r[16];		// r[0] PC, r[1] SP, r[2] SR, r[3] CG2
+	unsigned char mem[0x10000];
+	unsigned long long cycles;
+	unsigned int irq;			// pending interrupt requests, bit per vector
+	cpu430_read_fn io_read;		// NULL: plain memory
+	cpu430_write_fn io_write;
+	void *user;
+
+	// Filled by cpu430Step() for the profilers.
+	unsigned short pc;			// address of the instruction just executed
+	enum cpu430_event event;
+};
+
+void cpu430Reset(cpu430 *c);
+/*
+ * Executes one instruction (or accepts one interrupt) and returns the
+ * cycles it took. Returns 0 if the CPU is off with no interrupt it can
+ * take, and -1 on an illegal instruction.
+ */
+int cpu430Step(cpu430 *c);
+void cpu430Irq(cpu430 *c, int vector);
+
+unsigned int cpu430Read(cpu430 *c, unsigned int addr, int byte);
+void cpu430Write(cpu430 *c, unsigned int addr, unsigned int val, int byte);
+
+#endif /* CPU430_H_ */
@@ -0,0 +1,35 @@
+#!/bin/sh
+#
+# crosscheck.sh
+#
+# Checks that tools/batch.c still decides exactly as the firmware does:
+# builds batch against detect.c on the 16 bit integer model (the checked
+# build, see batch.c), generates a few rides of each ridegen scenario
+# and runs batch -v on them: the FULL profile (every stage batch models,
+# auto_brake_light_2/libs/config.h), then with each of those stages off.
+# Fails on the first build error or mismatch. Run it after any change to
+# detect.c, detect.h or the batch kernels.
+#
+# Needs only the host compilers (cc, g++).
+#
+# Usage (from the repository root):
+#   tools/crosscheck.sh [extra CFLAGS...]
+
+set -e
+
+LIBS=auto_brake_light_2/libs
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+cc -O2 -pthread -I"$LIBS" -o "$TMP/ridegen" tools/ridegen.c -lm
+for kind in mixed cobbles mount stop; do
+	"$TMP/ridegen" -n 4 -d 300 -s 1 -k $kind -o "$TMP/$kind"
+done
+
+for stages in "" "-DCORNER_REJECT=0" "-DNOISE_ADAPT=0" "-DBUMP_WINDOW=1"; do
+	echo "== FULL $stages $*"
+	g++ -O2 -DMSP_CHECKED -DDETECT_TUNABLE -DCONFIG_PROFILE=PROFILE_FULL $stages "$@" -I"$LIBS" -Itools \
+		-o "$TMP/batch" -x c++ tools/batch.c tools/score.c \
+		"$LIBS/detect.c" "$LIBS/tempcomp.c" -x c tools/trace.c
+	"$TMP/batch" -v "$TMP"/*/ride-*.csv
+done
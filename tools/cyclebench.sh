@@ -0,0 +1,34 @@
+#!/bin/sh
+#
+# cyclebench.sh
+#
+# Builds tools/bench430.c with the firmware detection code for the
+# MSP430G2231, runs it on the simulator and writes the per-function
+# cycle table to cycles-<commit>.txt (and stdout), so that a change can
+# be compared against the commit before it.
+#
+# Needs msp430-elf-gcc (TI's GCC build, with its device headers and
+# linker scripts on the default search path).
+#
+# Usage (from the repository root):
+#   tools/cyclebench.sh [extra CFLAGS...]
+
+set -e
+
+CC=${CC430:-msp430-elf-gcc}
+MCU=${MCU:-msp430g2231}
+OUT=${OUT:-.}
+LIBS=auto_brake_light_2/libs
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+commit=$(git rev-parse --short HEAD)
+if ! git diff --quiet HEAD -- auto_brake_light_2 tools; then
+	commit="$commit-dirty"
+fi
+
+cc -O2 -o "$TMP/cycles" tools/cycles.c tools/cpu430.c tools/elf430.c
+"$CC" -mmcu="$MCU" -Os -I"$LIBS" "$@" -o "$TMP/bench.elf" \
+	tools/bench430.c "$LIBS/detect.c" "$LIBS/tempcomp.c" "$LIBS/ridelog.c"
+
+"$TMP/cycles" -t "$commit" "$TMP/bench.elf" | tee "$OUT/cycles-$commit.txt"
@@ -0,0 +1,267 @@
+/*
+ * cycles.c
+ *
+ *  Cycle-exact benchmarks on a simulated MSP430.
+ *
+ *  Runs a compiled MSP430 firmware image, or single functions out of
+ *  relocatable objects, on the CPU model in cpu430.c and reports the
+ *  cycles spent in each function (by symbol address range). At 1 MHz
+ *  a cycle is a microsecond, so these are the numbers to compare when
+ *  changing smoothFilter(), the pitch divide and the like; host timings
+ *  say nothing about a 16 bit CPU without a multiplier.
+ *
+ *  Two modes:
+ *  - image: start from the reset vector and run until the CPU switches
+ *    itself off with interrupts disabled (or -m cycles have passed).
+ *    No peripherals are modelled; the peripheral space is plain RAM.
+ *  - call (-c): call one function with up to four integer arguments
+ *    (R12 to R15, as both msp430-gcc and the TI EABI pass them) -n times
+ *    and report min/mean/max cycles per call, from the first instruction
+ *    up to and including the RET (add 5 for a CALL #function). It
+ *    returns to address 0, which is where the run stops.
+ *
+ *  "self" is the cycles spent executing a function's own instructions,
+ *  "inclusive" adds everything it called (interrupts included).
+ *
+ *  Build (from the repository root):
+ *    cc -O2 -o cycles tools/cycles.c tools/cpu430.c tools/elf430.c
+ *
+ *  Usage:
+ *    cycles [-c function[:arg,...]] [-n count] [-m max_cycles] [-s sp]
+ *           [-t tag] image.elf | object.o...
+ *
+ *  tools/cyclebench.sh builds the standard benchmark and tags the table
+ *  with the current commit.
+ */
+
+#include "cpu430.h"
+#include "elf430.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define STACK_DEPTH 64
+
+typedef struct prof_struct{
+	long calls;
+	unsigned long long self;
+	unsigned long long incl;
+} prof;
+
+typedef struct frame_struct{
+	int sym;					// index into e.syms, -1 if unknown
+	unsigned long long start;
+} frame;
+
+static elf430 e;
+static cpu430 cpu;
+static prof *profile;			// n_syms + 1 entries, the last for "unknown"
+static frame stack[STACK_DEPTH];
+static int depth;
+
+static int symIndex(unsigned int addr){
+	const elf430_sym *s = elf430At(&e, addr);
+
+	return s ? (int)(s - e.syms) : e.n_syms;
+}
+
+static void enter(unsigned int addr){
+	int i = symIndex(addr);
+
+	profile[i].calls++;
+	if (depth < STACK_DEPTH){
+		stack[depth].sym = i;
+		stack[depth].start = cpu.cycles;
+	}
+	depth++;
+}
+
+static void leave(void){
+	if (depth > 0 && --depth < STACK_DEPTH){
+		profile[stack[depth].sym].incl += cpu.cycles - stack[depth].start;
+	}
+}
+
+/*
+ * run
+ * Steps the CPU until it stops, returns to stop_pc, or runs out of
+ * cycles, keeping the profile. Returns 0, or -1 on an illegal opcode.
+ */
+static int run(unsigned long long max_cycles, int stop_pc){
+	unsigned long long end = cpu.cycles + max_cycles;
+
+	while (cpu.cycles < end){
+		int n = cpu430Step(&cpu);
+
+		if (n < 0){
+			fprintf(stderr, "illegal instruction 0x%04x at 0x%04x\n",
+					cpu430Read(&cpu, cpu.pc, 0), cpu.pc);
+			return -1;
+		}
+		if (!n){
+			return 0;		// switched off, and nothing in this model can wake it
+		}
+		switch (cpu.event){
+		case CPU430_EV_CALL:
+			profile[symIndex(cpu.pc)].self += n;
+			enter(cpu.r[0]);
+			break;
+		case CPU430_EV_IRQ:
+			enter(cpu.r[0]);
+			profile[symIndex(cpu.r[0])].self += n;
+			break;
+		case CPU430_EV_RET:
+		case CPU430_EV_RETI:
+			profile[symIndex(cpu.pc)].self += n;
+			leave();
+			break;
+		default:
+			profile[symIndex(cpu.pc)].self += n;
+			break;
+		}
+		if (stop_pc >= 0 && cpu.r[0] == stop_pc){
+			return 0;
+		}
+	}
+	fprintf(stderr, "stopped after %llu cycles\n", max_cycles);
+	return 0;
+}
+
+static int bySelf(const void *a, const void *b){
+	const prof *x = &profile[*(const int *)a], *y = &profile[*(const int *)b];
+
+	return (x->self < y->self) - (x->self > y->self);
+}
+
+static void printProfile(const char *tag, unsigned long long total){
+	int *order = malloc((e.n_syms + 1) * sizeof(*order));
+	int i;
+
+	for (i = 0; i <= e.n_syms; i++){
+		order[i] = i;
+	}
+	qsort(order, e.n_syms + 1, sizeof(*order), bySelf);
+
+	printf("# %s: %llu cycles (%.3f ms at 1 MHz)\n", tag, total, total / 1000.0);
+	printf("%-24s %8s %10s %6s %10s %9s\n", "function", "calls", "self", "self%", "inclusive", "per_call");
+	for (i = 0; i <= e.n_syms; i++){
+		const prof *p = &profile[order[i]];
+
+		if (!p->self && !p->calls){
+			continue;
+		}
+		printf("%-24s %8ld %10llu %5.1f%% %10llu %9.1f\n",
+				order[i] < e.n_syms ? e.syms[order[i]].name : "(unknown)",
+				p->calls, p->self, total ? 100.0 * p->self / total : 0.0,
+				p->incl, p->calls ? (double)p->incl / p->calls : 0.0);
+	}
+	free(order);
+}
+
+int main(int argc, char **argv){
+	const char *call = NULL;
+	const char *tag = "cycles";
+	unsigned long long max_cycles = 100000000ULL;
+	unsigned int sp = 0x0280;		// top of the G2231's 128 bytes of RAM
+	long count = 1;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "c:n:m:s:t:")) != -1){
+		switch (c){
+		case 'c': call = optarg; break;
+		case 'n': count = atol(optarg); break;
+		case 'm': max_cycles = strtoull(optarg, NULL, 0); break;
+		case 's': sp = strtoul(optarg, NULL, 0); break;
+		case 't': tag = optarg; break;
+		default:
+			fprintf(stderr, "usage: %s [-c function[:arg,...]] [-n count] [-m max_cycles] "
+					"[-s sp] [-t tag] image.elf | object.o...\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind >= argc || count < 1){
+		fprintf(stderr, "usage: %s [options] image.elf | object.o...\n", argv[0]);
+		return 2;
+	}
+
+	elf430Init(&e);
+	for (i = optind; i < argc; i++){
+		if (elf430Load(&e, &cpu, argv[i])){
+			return 1;
+		}
+	}
+	if (elf430Link(&e, &cpu)){
+		return 1;
+	}
+	profile = calloc(e.n_syms + 1, sizeof(*profile));
+
+	if (!call){
+		unsigned long long t0;
+
+		if (!e.is_image){
+			fprintf(stderr, "objects need -c function: there is no reset vector\n");
+			return 2;
+		}
+		cpu430Reset(&cpu);
+		enter(cpu.r[0]);
+		t0 = cpu.cycles;
+		if (run(max_cycles, -1)){
+			return 1;
+		}
+		printProfile(tag, cpu.cycles - t0);
+	} else {
+		char name[128];
+		const char *args = strchr(call, ':');
+		unsigned int argv_[4] = { 0 };
+		unsigned long long lo = ~0ULL, hi = 0, sum = 0;
+		const elf430_sym *fn;
+		long n;
+
+		snprintf(name, sizeof(name), "%.*s", args ? (int)(args - call) : (int)strlen(call), call);
+		for (i = 0; args && i < 4; i++){
+			argv_[i] = strtol(args + 1, NULL, 0);
+			args = strchr(args + 1, ',');
+		}
+		fn = elf430Find(&e, name);
+		if (!fn){
+			fprintf(stderr, "%s: no such function\n", name);
+			return 1;
+		}
+		if (e.ram_next > sp - 32){
+			fprintf(stderr, "warning: less than 32 bytes of stack above the data\n");
+		}
+
+		for (n = 0; n < count; n++){
+			unsigned long long t0 = cpu.cycles;
+			unsigned long long took;
+
+			cpu.r[1] = sp - 2;
+			cpu430Write(&cpu, sp - 2, 0, 0);	// return address
+			for (i = 0; i < 4; i++){
+				cpu.r[12 + i] = argv_[i];
+			}
+			cpu.r[2] = 0;
+			cpu.r[0] = fn->addr;
+			enter(fn->addr);
+			if (run(max_cycles, 0)){
+				return 1;
+			}
+			if (cpu.r[0] != 0){
+				fprintf(stderr, "%s did not return\n", name);
+				return 1;
+			}
+			took = cpu.cycles - t0;
+			sum += took;
+			lo = took < lo ? took : lo;
+			hi = took > hi ? took : hi;
+		}
+		printf("# %s(%d, %d, %d, %d) = %d: min %llu mean %.1f max %llu cycles over %ld calls\n",
+				name, (short)argv_[0], (short)argv_[1], (short)argv_[2], (short)argv_[3],
+				(short)cpu.r[12], lo, (double)sum / count, hi, count);
+		printProfile(tag, sum);
+	}
+	elf430Free(&e);
+	return 0;
+}
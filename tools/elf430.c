@@ -0,0 +1,476 @@
+/*
+ * elf430.c
+ *
+ *  MSP430 ELF loader. See elf430.h.
+ */
+
+#include "elf430.h"
+
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FLASH_END 0xFFE0	// interrupt vectors from here on
+
+// Not in every <elf.h>. Numbers from the MSP430 EABI (SLAA534).
+#ifndef EM_MSP430
+#define EM_MSP430 105
+#endif
+enum{
+	R_MSP430_NONE, R_MSP430_32, R_MSP430_10_PCREL, R_MSP430_16, R_MSP430_16_PCREL,
+	R_MSP430_16_BYTE, R_MSP430_16_PCREL_BYTE, R_MSP430_2X_PCREL, R_MSP430_RL_PCREL, R_MSP430_8
+};
+
+typedef struct elf430_obj_struct{
+	char *path;
+	unsigned char *buf;
+	long len;
+	unsigned int *sec_addr;		// load address per section, 0 if not allocated
+	unsigned int *common_addr;	// per symbol, for SHN_COMMON
+} elf430_obj;
+
+void elf430Init(elf430 *e){
+	memset(e, 0, sizeof(*e));
+	e->flash_next = ELF430_FLASH;
+	e->ram_next = ELF430_RAM;
+}
+
+static unsigned char *readFile(const char *path, long *len){
+	FILE *f = fopen(path, "rb");
+	unsigned char *buf;
+
+	if (!f){
+		perror(path);
+		return NULL;
+	}
+	fseek(f, 0, SEEK_END);
+	*len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	buf = malloc(*len);
+	if (fread(buf, 1, *len, f) != (size_t)*len){
+		perror(path);
+		free(buf);
+		buf = NULL;
+	}
+	fclose(f);
+	return buf;
+}
+
+static const Elf32_Shdr *section(const unsigned char *buf, int i){
+	const Elf32_Ehdr *eh = (const Elf32_Ehdr *)buf;
+
+	return (const Elf32_Shdr *)(buf + eh->e_shoff + i * eh->e_shentsize);
+}
+
+static void addSym(elf430 *e, const char *name, unsigned int addr, unsigned int size){
+	if (!(e->n_syms & (e->n_syms - 1))){
+		e->syms = realloc(e->syms, (e->n_syms ? 2 * e->n_syms : 16) * sizeof(*e->syms));
+	}
+	e->syms[e->n_syms].name = strdup(name);
+	e->syms[e->n_syms].addr = addr;
+	e->syms[e->n_syms].size = size;
+	e->n_syms++;
+}
+
+/*
+ * symbols
+ * Collects the function symbols of one file. Hand-written assembly
+ * often has no .type, so untyped global labels in code count too.
+ * sec_addr is NULL for linked images (symbol values are addresses).
+ */
+static void symbols(elf430 *e, const unsigned char *buf, const unsigned int *sec_addr){
+	const Elf32_Ehdr *eh = (const Elf32_Ehdr *)buf;
+	int i;
+
+	for (i = 0; i < eh->e_shnum; i++){
+		const Elf32_Shdr *sh = section(buf, i);
+		const Elf32_Sym *st;
+		const char *str;
+		unsigned int k, n;
+
+		if (sh->sh_type != SHT_SYMTAB){
+			continue;
+		}
+		st = (const Elf32_Sym *)(buf + sh->sh_offset);
+		str = (const char *)buf + section(buf, sh->sh_link)->sh_offset;
+		n = sh->sh_size / sizeof(*st);
+		for (k = 1; k < n; k++){
+			int type = ELF32_ST_TYPE(st[k].st_info);
+			int bind = ELF32_ST_BIND(st[k].st_info);
+
+			if (st[k].st_shndx == SHN_UNDEF || st[k].st_shndx >= SHN_LORESERVE){
+				continue;
+			}
+			if (type != STT_FUNC
+					&& !(type == STT_NOTYPE && bind != STB_LOCAL
+						&& (section(buf, st[k].st_shndx)->sh_flags & SHF_EXECINSTR))){
+				continue;
+			}
+			addSym(e, str + st[k].st_name,
+					(sec_addr ? sec_addr[st[k].st_shndx] : 0) + st[k].st_value, st[k].st_size);
+		}
+	}
+}
+
+static int loadImage(elf430 *e, cpu430 *c, const unsigned char *buf, const char *path){
+	const Elf32_Ehdr *eh = (const Elf32_Ehdr *)buf;
+	int i;
+
+	for (i = 0; i < eh->e_phnum; i++){
+		const Elf32_Phdr *ph = (const Elf32_Phdr *)(buf + eh->e_phoff + i * eh->e_phentsize);
+
+		if (ph->p_type != PT_LOAD || !ph->p_filesz){
+			continue;
+		}
+		if (ph->p_paddr + ph->p_filesz > 0x10000){
+			fprintf(stderr, "%s: segment outside the 64 KB address space\n", path);
+			return -1;
+		}
+		// Load address: crt0 copies .data to RAM itself.
+		memcpy(c->mem + ph->p_paddr, buf + ph->p_offset, ph->p_filesz);
+	}
+	symbols(e, buf, NULL);
+	e->is_image = 1;
+	return 0;
+}
+
+/*
+ * vectorAddr
+ * Fixed address for the interrupt vector sections msp430-elf-gcc emits
+ * (__interrupt_vector_N for interrupt(N), N = 1 at 0xFFE0), 0 otherwise.
+ */
+static unsigned int vectorAddr(const char *name){
+	int n;
+
+	if (!strcmp(name, "__reset_vector") || !strcmp(name, ".resetvec")){
+		return 0xFFFE;
+	}
+	if (sscanf(name, "__interrupt_vector_%d", &n) == 1 && n >= 1 && n <= 16){
+		return 0xFFE0 + 2 * (n - 1);
+	}
+	return 0;
+}
+
+static int loadObject(elf430 *e, cpu430 *c, elf430_obj *o){
+	const Elf32_Ehdr *eh = (const Elf32_Ehdr *)o->buf;
+	const char *shstr = (const char *)o->buf + section(o->buf, eh->e_shstrndx)->sh_offset;
+	int i;
+
+	o->sec_addr = calloc(eh->e_shnum, sizeof(*o->sec_addr));
+	for (i = 0; i < eh->e_shnum; i++){
+		const Elf32_Shdr *sh = section(o->buf, i);
+		unsigned int align = sh->sh_addralign ? sh->sh_addralign : 1;
+		unsigned int vec = vectorAddr(shstr + sh->sh_name);
+		unsigned int *next;
+
+		if (!(sh->sh_flags & SHF_ALLOC) || !sh->sh_size){
+			continue;
+		}
+		if (vec){
+			o->sec_addr[i] = vec;
+			memcpy(c->mem + vec, o->buf + sh->sh_offset, 2);
+			if (vec == 0xFFFE){
+				e->is_image = 1;	// bootable once linked
+			}
+			continue;
+		}
+		next = (sh->sh_flags & SHF_WRITE) ? &e->ram_next : &e->flash_next;
+		*next = (*next + align - 1) & ~(align - 1);
+		o->sec_addr[i] = *next;
+		*next += sh->sh_size;
+		if (e->flash_next > FLASH_END || e->ram_next > ELF430_FLASH){
+			fprintf(stderr, "%s: %s does not fit\n", o->path,
+					next == &e->flash_next ? "code" : "data");
+			return -1;
+		}
+		if (sh->sh_type == SHT_NOBITS){
+			memset(c->mem + o->sec_addr[i], 0, sh->sh_size);
+		} else {
+			memcpy(c->mem + o->sec_addr[i], o->buf + sh->sh_offset, sh->sh_size);
+		}
+	}
+
+	// Common symbols get their own bss.
+	for (i = 0; i < eh->e_shnum; i++){
+		const Elf32_Shdr *sh = section(o->buf, i);
+		const Elf32_Sym *st;
+		unsigned int k, n;
+
+		if (sh->sh_type != SHT_SYMTAB){
+			continue;
+		}
+		st = (const Elf32_Sym *)(o->buf + sh->sh_offset);
+		n = sh->sh_size / sizeof(*st);
+		o->common_addr = calloc(n, sizeof(*o->common_addr));
+		for (k = 1; k < n; k++){
+			if (st[k].st_shndx == SHN_COMMON){
+				unsigned int align = st[k].st_value ? st[k].st_value : 1;
+
+				e->ram_next = (e->ram_next + align - 1) & ~(align - 1);
+				o->common_addr[k] = e->ram_next;
+				memset(c->mem + e->ram_next, 0, st[k].st_size);
+				e->ram_next += st[k].st_size;
+			}
+		}
+	}
+
+	symbols(e, o->buf, o->sec_addr);
+	return 0;
+}
+
+int elf430Load(elf430 *e, cpu430 *c, const char *path){
+	long len;
+	unsigned char *buf = readFile(path, &len);
+	const Elf32_Ehdr *eh = (const Elf32_Ehdr *)buf;
+	elf430_obj *o;
+
+	if (!buf){
+		return -1;
+	}
+	if (len < (long)sizeof(*eh) || memcmp(eh->e_ident, ELFMAG, SELFMAG)
+			|| eh->e_ident[EI_CLASS] != ELFCLASS32 || eh->e_ident[EI_DATA] != ELFDATA2LSB
+			|| eh->e_machine != EM_MSP430){
+		fprintf(stderr, "%s: not an MSP430 ELF file\n", path);
+		free(buf);
+		return -1;
+	}
+
+	if (eh->e_type == ET_EXEC){
+		int ret = loadImage(e, c, buf, path);
+
+		free(buf);
+		return ret;
+	}
+	if (eh->e_type != ET_REL){
+		fprintf(stderr, "%s: neither an image nor an object\n", path);
+		free(buf);
+		return -1;
+	}
+
+	e->objs = realloc(e->objs, (e->n_objs + 1) * sizeof(*e->objs));
+	o = &e->objs[e->n_objs++];
+	memset(o, 0, sizeof(*o));
+	o->path = strdup(path);
+	o->buf = buf;
+	o->len = len;
+	return loadObject(e, c, o);
+}
+
+/*
+ * lookup
+ * Finds a global definition of name in any loaded object.
+ */
+static int lookup(const elf430 *e, const char *name, unsigned int *addr){
+	int i;
+
+	for (i = 0; i < e->n_objs; i++){
+		const elf430_obj *o = &e->objs[i];
+		const Elf32_Ehdr *eh = (const Elf32_Ehdr *)o->buf;
+		int s;
+
+		for (s = 0; s < eh->e_shnum; s++){
+			const Elf32_Shdr *sh = section(o->buf, s);
+			const Elf32_Sym *st;
+			const char *str;
+			unsigned int k, n;
+
+			if (sh->sh_type != SHT_SYMTAB){
+				continue;
+			}
+			st = (const Elf32_Sym *)(o->buf + sh->sh_offset);
+			str = (const char *)o->buf + section(o->buf, sh->sh_link)->sh_offset;
+			n = sh->sh_size / sizeof(*st);
+			for (k = 1; k < n; k++){
+				if (ELF32_ST_BIND(st[k].st_info) == STB_LOCAL || st[k].st_shndx == SHN_UNDEF
+						|| strcmp(str + st[k].st_name, name)){
+					continue;
+				}
+				if (st[k].st_shndx == SHN_ABS){
+					*addr = st[k].st_value;
+				} else if (st[k].st_shndx == SHN_COMMON){
+					*addr = o->common_addr[k];
+				} else {
+					*addr = o->sec_addr[st[k].st_shndx] + st[k].st_value;
+				}
+				return 0;
+			}
+		}
+	}
+	return -1;
+}
+
+static void put16(unsigned char *p, unsigned int v){
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+/*
+ * relocate
+ * Applies one relocation section. Only the non-X relocations a G2xx
+ * build produces are handled; anything else is reported.
+ */
+static int relocate(elf430 *e, cpu430 *c, elf430_obj *o, const Elf32_Shdr *rs){
+	const Elf32_Shdr *symtab = section(o->buf, rs->sh_link);
+	const Elf32_Sym *st = (const Elf32_Sym *)(o->buf + symtab->sh_offset);
+	const char *str = (const char *)o->buf + section(o->buf, symtab->sh_link)->sh_offset;
+	unsigned int base = o->sec_addr[rs->sh_info];
+	unsigned int entsize = rs->sh_type == SHT_RELA ? sizeof(Elf32_Rela) : sizeof(Elf32_Rel);
+	unsigned int n = rs->sh_size / entsize, k;
+
+	for (k = 0; k < n; k++){
+		const Elf32_Rela *r = (const Elf32_Rela *)(o->buf + rs->sh_offset + k * entsize);
+		const Elf32_Sym *sym = &st[ELF32_R_SYM(r->r_info)];
+		unsigned int p = base + r->r_offset;
+		unsigned char *loc = c->mem + p;
+		int type = ELF32_R_TYPE(r->r_info);
+		long addend, s, v;
+
+		if (rs->sh_type == SHT_RELA){
+			addend = r->r_addend;
+		} else if (type == R_MSP430_32){
+			addend = loc[0] | loc[1] << 8 | loc[2] << 16 | (long)loc[3] << 24;
+		} else {
+			addend = (short)(loc[0] | loc[1] << 8);
+		}
+
+		if (sym->st_shndx == SHN_UNDEF){
+			unsigned int a;
+
+			if (lookup(e, str + sym->st_name, &a)){
+				fprintf(stderr, "%s: undefined reference to %s\n", o->path, str + sym->st_name);
+				return -1;
+			}
+			s = a;
+		} else if (sym->st_shndx == SHN_ABS){
+			s = sym->st_value;
+		} else if (sym->st_shndx == SHN_COMMON){
+			s = o->common_addr[ELF32_R_SYM(r->r_info)];
+		} else {
+			s = o->sec_addr[sym->st_shndx] + sym->st_value;
+		}
+		v = s + addend;
+
+		switch (type){
+		case R_MSP430_NONE:
+			break;
+		case R_MSP430_32:
+			put16(loc, v);
+			put16(loc + 2, v >> 16);
+			break;
+		case R_MSP430_16:
+		case R_MSP430_16_BYTE:
+			put16(loc, v);
+			break;
+		case R_MSP430_8:
+			loc[0] = v;
+			break;
+		case R_MSP430_16_PCREL:
+		case R_MSP430_16_PCREL_BYTE:
+		case R_MSP430_RL_PCREL:
+			put16(loc, v - p);
+			break;
+		case R_MSP430_10_PCREL:
+			v = ((v - p) >> 1) - 1;
+			if (v < -512 || v > 511){
+				fprintf(stderr, "%s: jump out of range at 0x%04x\n", o->path, p);
+				return -1;
+			}
+			put16(loc, ((loc[0] | loc[1] << 8) & 0xFC00) | (v & 0x3FF));
+			break;
+		default:
+			fprintf(stderr, "%s: unsupported relocation type %d\n", o->path, type);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int bySymAddr(const void *a, const void *b){
+	const elf430_sym *x = a, *y = b;
+
+	return (x->addr > y->addr) - (x->addr < y->addr);
+}
+
+int elf430Link(elf430 *e, cpu430 *c){
+	int i, s;
+
+	for (i = 0; i < e->n_objs; i++){
+		elf430_obj *o = &e->objs[i];
+		const Elf32_Ehdr *eh = (const Elf32_Ehdr *)o->buf;
+
+		for (s = 0; s < eh->e_shnum; s++){
+			const Elf32_Shdr *sh = section(o->buf, s);
+
+			// Only relocations into loaded sections; debug info is skipped.
+			if ((sh->sh_type == SHT_RELA || sh->sh_type == SHT_REL) && o->sec_addr[sh->sh_info]
+					&& relocate(e, c, o, sh)){
+				return -1;
+			}
+		}
+	}
+
+	// Fill in missing sizes from the next symbol up.
+	qsort(e->syms, e->n_syms, sizeof(*e->syms), bySymAddr);
+	for (i = 0; i < e->n_syms; i++){
+		if (!e->syms[i].size){
+			unsigned int end = FLASH_END;
+
+			for (s = i + 1; s < e->n_syms; s++){
+				if (e->syms[s].addr > e->syms[i].addr){
+					end = e->syms[s].addr;
+					break;
+				}
+			}
+			e->syms[i].size = end > e->syms[i].addr ? end - e->syms[i].addr : 1;
+		}
+	}
+	return 0;
+}
+
+const elf430_sym *elf430Find(const elf430 *e, const char *name){
+	int i;
+
+	for (i = 0; i < e->n_syms; i++){
+		if (!strcmp(e->syms[i].name, name)){
+			return &e->syms[i];
+		}
+	}
+	return NULL;
+}
+
+const elf430_sym *elf430At(const elf430 *e, unsigned int addr){
+	int lo = 0, hi = e->n_syms;
+
+	// Last symbol starting at or below addr.
+	while (lo < hi){
+		int mid = (lo + hi) / 2;
+
+		if (e->syms[mid].addr <= addr){
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo && addr < e->syms[lo - 1].addr + e->syms[lo - 1].size){
+		return &e->syms[lo - 1];
+	}
+	return NULL;
+}
+
+void elf430Free(elf430 *e){
+	int i;
+
+	for (i = 0; i < e->n_syms; i++){
+		free(e->syms[i].name);
+	}
+	for (i = 0; i < e->n_objs; i++){
+		free(e->objs[i].path);
+		free(e->objs[i].buf);
+		free(e->objs[i].sec_addr);
+		free(e->objs[i].common_addr);
+	}
+	free(e->syms);
+	free(e->objs);
+	elf430Init(e);
+}
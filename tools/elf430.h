@@ -0,0 +1,54 @@
+/*
+ * elf430.h
+ *
+ *  MSP430 ELF loader for the simulator tools.
+ *
+ *  Takes either a linked firmware image (loaded by its program headers,
+ *  started from the reset vector) or one or more relocatable objects,
+ *  which are laid out like a tiny linker would: code and constants from
+ *  ELF430_FLASH up, data and bss from ELF430_RAM up. That is enough to
+ *  benchmark single functions straight out of "gcc -c" without a
+ *  linker script. The __interrupt_vector_N and __reset_vector sections
+ *  go to their vector addresses, so a set of objects with a reset vector
+ *  runs like an image.
+ *
+ *  Assumes a little-endian host, like the rest of tools/.
+ */
+
+#ifndef ELF430_H_
+#define ELF430_H_
+
+#include "cpu430.h"
+
+#define ELF430_FLASH 0xF800		// MSP430G2231: 2 KB of main flash
+#define ELF430_RAM 0x0200
+
+typedef struct elf430_sym_struct{
+	char *name;
+	unsigned int addr;
+	unsigned int size;			// 0 if the object did not say
+} elf430_sym;
+
+typedef struct elf430_struct{
+	elf430_sym *syms;			// functions only, sorted by address after elf430Link()
+	int n_syms;
+	int is_image;				// there is a reset vector to start from
+	unsigned int flash_next;	// next free address for relocatable sections
+	unsigned int ram_next;
+
+	// Relocatable objects waiting for elf430Link().
+	struct elf430_obj_struct *objs;
+	int n_objs;
+} elf430;
+
+void elf430Init(elf430 *e);
+// Loads a file into c->mem. Returns 0, or -1 with a message on stderr.
+int elf430Load(elf430 *e, cpu430 *c, const char *path);
+// Resolves and applies relocations across all loaded objects. Returns 0, or -1.
+int elf430Link(elf430 *e, cpu430 *c);
+// Function symbol by name, or the one containing addr.
+const elf430_sym *elf430Find(const elf430 *e, const char *name);
+const elf430_sym *elf430At(const elf430 *e, unsigned int addr);
+void elf430Free(elf430 *e);
+
+#endif /* ELF430_H_ */
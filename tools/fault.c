@@ -0,0 +1,105 @@
+/*
+ * fault.c
+ *
+ *  Fault injection settings and draws. See fault.h.
+ */
+
+#include "fault.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char *const fault_names[FAULT_KINDS] = {
+	"nack_addr", "nack_data", "corrupt", "sda", "scl", "stretch", "int_delay", "unplug"
+};
+
+// Which keys take "P:ARG" and which "ARG[:P]".
+static const char arg_first[FAULT_KINDS] = { 0, 0, 0, 0, 0, 1, 1, 1 };
+
+int faultParse(fault *f, const char *spec){
+	char buf[512], *tok, *save;
+	int k;
+
+	memset(f, 0, sizeof(*f));
+	if (strlen(spec) >= sizeof(buf)){
+		fprintf(stderr, "fault scenario too long\n");
+		return -1;
+	}
+	strcpy(buf, spec);
+
+	for (tok = strtok_r(buf, " \t\n,", &save); tok; tok = strtok_r(NULL, " \t\n,", &save)){
+		char *val = strchr(tok, '=');
+		char *second;
+		double a, b = -1;
+
+		if (!val){
+			fprintf(stderr, "fault setting '%s': expected key=value\n", tok);
+			return -1;
+		}
+		*val++ = 0;
+		for (k = 0; k < FAULT_KINDS && strcmp(tok, fault_names[k]); k++);
+		if (k == FAULT_KINDS){
+			fprintf(stderr, "unknown fault '%s'\n", tok);
+			return -1;
+		}
+		a = strtod(val, &second);
+		if (*second == ':'){
+			b = strtod(second + 1, &second);
+		}
+		if (*second || second == val){
+			fprintf(stderr, "fault setting '%s': bad value '%s'\n", tok, val);
+			return -1;
+		}
+
+		if (k == FAULT_UNPLUG){
+			if (b < 0){
+				fprintf(stderr, "unplug needs AT_MS:FOR_MS\n");
+				return -1;
+			}
+			f->unplug_at = (unsigned long long)(a * 1000);
+			f->unplug_until = f->unplug_at + (unsigned long long)(b * 1000);
+			f->p[k] = 1;
+		} else if (arg_first[k]){
+			f->arg[k] = (long)a;
+			f->p[k] = b < 0 ? 1 : b;
+		} else {
+			f->p[k] = a;
+			f->arg[k] = b < 0 ? 0 : (long)b;
+			if ((k == FAULT_SDA || k == FAULT_SCL) && b < 0){
+				fprintf(stderr, "%s needs P:%s\n", tok, k == FAULT_SDA ? "CLOCKS" : "CYCLES");
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+void faultSeed(fault *f, unsigned long long seed){
+	f->rng = seed ? seed : 0x9E3779B97F4A7C15ULL;		// xorshift must not start at 0
+}
+
+static double uniform(fault *f){
+	f->rng ^= f->rng << 13;
+	f->rng ^= f->rng >> 7;
+	f->rng ^= f->rng << 17;
+	return (f->rng >> 11) * (1.0 / 9007199254740992.0);		// 53 bits
+}
+
+int faultHit(fault *f, int kind, unsigned long long now){
+	if (!f->p[kind]){
+		return 0;	// no draw either: other faults keep their sequence
+	}
+	if (f->p[kind] < 1 && uniform(f) >= f->p[kind]){
+		return 0;
+	}
+	f->injected[kind]++;
+	if (!f->first){
+		f->first = now ? now : 1;
+	}
+	return 1;
+}
+
+int faultUnplugged(const fault *f, unsigned long long now){
+	return f->unplug_until && now >= f->unplug_at && now < f->unplug_until;
+}
@@ -0,0 +1,63 @@
+/*
+ * fault.h
+ *
+ *  Fault injection for the simulated I2C bus and sensor (g2231.c,
+ *  vmpu.c).
+ *
+ *  A scenario is a list of "key=value" settings, e.g.
+ *
+ *      nack_addr=0.01 scl=0.001:30000 int_delay=20000:0.05
+ *
+ *  Keys (P is a probability per opportunity, times are CPU cycles, i.e.
+ *  microseconds at 1 MHz):
+ *    nack_addr=P           slave NACKs its address byte
+ *    nack_data=P           slave NACKs a register or data byte
+ *    corrupt=P             one bit flipped in a byte read by the master
+ *    sda=P:CLOCKS          at a START, the slave hangs holding SDA low
+ *                          for the next CLOCKS SCL clocks
+ *    scl=P:CYCLES          before a byte, SCL is held low for CYCLES
+ *    stretch=CYCLES[:P]    clock stretching: a byte takes CYCLES longer
+ *    int_delay=CYCLES[:P]  data ready INT raised CYCLES late
+ *    unplug=AT_MS:FOR_MS   sensor gone from AT_MS for FOR_MS: no ACKs,
+ *                          no INT, and a power-on reset when it is back
+ *
+ *  Every draw comes from one xorshift generator per scenario, so a seed
+ *  and a scenario always give the same run.
+ */
+
+#ifndef FAULT_H_
+#define FAULT_H_
+
+enum fault_kind{
+	FAULT_NACK_ADDR,
+	FAULT_NACK_DATA,
+	FAULT_CORRUPT,
+	FAULT_SDA,
+	FAULT_SCL,
+	FAULT_STRETCH,
+	FAULT_INT_DELAY,
+	FAULT_UNPLUG,
+	FAULT_KINDS
+};
+
+typedef struct fault_struct{
+	double p[FAULT_KINDS];			// chance per opportunity
+	long arg[FAULT_KINDS];			// clocks or cycles, see above
+	unsigned long long unplug_at, unplug_until;	// cycles
+
+	unsigned long long rng;
+	long injected[FAULT_KINDS];
+	unsigned long long first;		// first fault since the last good sample, 0 if none
+} fault;
+
+extern const char *const fault_names[FAULT_KINDS];
+
+// Clears f and reads the settings. Returns 0, or -1 with a message on stderr.
+int faultParse(fault *f, const char *spec);
+void faultSeed(fault *f, unsigned long long seed);
+// Draws for one opportunity of kind at time now; 1 if the fault happens.
+int faultHit(fault *f, int kind, unsigned long long now);
+// Whether the sensor is unplugged at time now.
+int faultUnplugged(const fault *f, unsigned long long now);
+
+#endif /* FAULT_H_ */
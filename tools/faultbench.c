@@ -0,0 +1,397 @@
+/*
+ * faultbench.c
+ *
+ *  Throughput and latency of the firmware under bus and sensor faults.
+ *
+ *  Runs a firmware image on the simulator (cpu430.c, g2231.c, vmpu.c,
+ *  as tools/latency does) once per fault scenario (fault.h), each from
+ *  reset with its own reproducible random sequence, and reports:
+ *  - samples lost: the sensor had new data that the firmware never read
+ *    intact (not read before the next sample, NACKed, corrupted, read
+ *    as a stuck bus, or the sensor was unplugged),
+ *  - recovery time: from a fault to the next sample read intact,
+ *  - loop time: from the data ready INT to the loop re-arming it (the
+ *    INT_STATUS read that releases the latch), p50/p99/max.
+ *  A sample counts as read when ACCEL_X and ACCEL_Z (the bytes
+ *  readAccel() fetches) have all been read since it arrived.
+ *
+ *  Build (from the repository root):
+ *    cc -O2 -Iauto_brake_light_2/libs -o faultbench tools/faultbench.c \
+ *        tools/cpu430.c tools/elf430.c tools/g2231.c tools/vmpu.c \
+ *        tools/fault.c tools/trace.c
+ *
+ *  Usage:
+ *    faultbench [-f scenarios.txt] [-s seed] [-n samples] [-r rate_hz]
+ *               [-t trace.csv] [-v] image.elf | object.o...
+ *
+ *  A scenario file has one scenario per line, a name then its settings:
+ *
+ *      # name      settings
+ *      flaky       nack_addr=0.02 corrupt=0.001
+ *      connector   unplug=5000:2000
+ *
+ *  Without -f the built-in set below runs. -v adds the faults injected
+ *  per kind.
+ */
+
+#include "cpu430.h"
+#include "elf430.h"
+#include "fault.h"
+#include "g2231.h"
+#include "trace.h"
+#include "vmpu.h"
+
+#include <mpu6050.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define REST_X 16384		// 1 g at AFS_SEL 0
+#define MAX_SCENARIOS 64
+
+// ACCEL_XOUT_H/L and ACCEL_ZOUT_H/L, as bits of vmpu.fresh
+#define NEEDED (0x03 | 0x30)
+
+typedef struct scenario_struct{
+	char name[32];
+	char spec[480];
+} scenario;
+
+static const scenario builtin[] = {
+	{ "clean", "" },
+	{ "nack_addr", "nack_addr=0.02" },
+	{ "nack_data", "nack_data=0.02" },
+	{ "corrupt", "corrupt=0.002" },
+	{ "sda_stuck", "sda=0.01:9" },
+	{ "scl_stuck", "scl=0.002:30000" },
+	{ "stretch", "stretch=100" },
+	{ "int_delay", "int_delay=100000:0.05" },
+	{ "unplug", "unplug=20000:5000" },
+	{ "mixed", "nack_addr=0.01 nack_data=0.01 corrupt=0.001 scl=0.001:30000 int_delay=100000:0.02" },
+};
+
+typedef struct result_struct{
+	long samples, good, lost;
+	long recoveries;
+	unsigned long long recovery_sum, recovery_max;
+	unsigned long long *loops;		// loop times, cycles
+	long n_loops, cap_loops;
+} result;
+
+static cpu430 cpu;
+static vmpu mpu;
+static g2231 periph;
+
+static int cmpTime(const void *a, const void *b){
+	unsigned long long x = *(const unsigned long long *)a, y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void addLoop(result *r, unsigned long long t){
+	if (r->n_loops == r->cap_loops){
+		r->cap_loops = r->cap_loops ? 2 * r->cap_loops : 1024;
+		r->loops = realloc(r->loops, r->cap_loops * sizeof(*r->loops));
+	}
+	r->loops[r->n_loops++] = t;
+}
+
+static unsigned long long percentile(const result *r, int pct){
+	long i = (r->n_loops * pct + 99) / 100 - 1;
+
+	return r->loops[i < 0 ? 0 : i];
+}
+
+/*
+ * boot
+ * Fresh part and sensor with the firmware loaded. Returns 0, or -1.
+ */
+static int boot(char **files, int n_files){
+	elf430 e;
+	int i, ok = 1;
+
+	memset(&cpu, 0, sizeof(cpu));
+	elf430Init(&e);
+	for (i = 0; i < n_files && ok; i++){
+		ok = !elf430Load(&e, &cpu, files[i]);
+	}
+	ok = ok && !elf430Link(&e, &cpu);
+	if (ok && !e.is_image){
+		fprintf(stderr, "no reset vector: need a firmware image\n");
+		ok = 0;
+	}
+	elf430Free(&e);
+	if (!ok){
+		return -1;
+	}
+
+	vmpuInit(&mpu);
+	g2231Init(&periph, &cpu, &mpu);
+	cpu430Reset(&cpu);
+	return 0;
+}
+
+/*
+ * run
+ * One scenario, from reset.
+ * Flow:
+ * 1. Deliver samples at the trace rate (none while unplugged; a
+ *    power-on reset of the sensor when it comes back).
+ * 2. Step the CPU, or skip ahead while it sleeps.
+ * 3. Watch the sensor side: sample read intact, INT edges for the loop
+ *    time, faults for the recovery time.
+ * Returns 0, or -1 if the firmware went off the rails.
+ */
+static int run(fault *f, const trace *t, long max_samples, unsigned long long period, result *r){
+	unsigned long long next_sample = period;
+	unsigned long long end = period * (max_samples + 1);
+	unsigned long long int_time = 0;
+	int pending = 0, unplugged = 0, int_prev = 0;
+	long delivered = 0;
+
+	while (cpu.cycles < end){
+		int n;
+
+		if (cpu.cycles >= next_sample && delivered < max_samples){
+			if (pending){
+				r->lost++;		// superseded before it was read
+			}
+			pending = 0;
+			if (faultUnplugged(f, next_sample)){
+				if (!unplugged){
+					unplugged = 1;
+					f->injected[FAULT_UNPLUG]++;
+					if (!f->first){
+						f->first = next_sample;
+					}
+				}
+				r->lost++;
+			} else {
+				const trace_sample *s = t->n ? &t->s[delivered % t->n] : NULL;
+
+				if (unplugged){
+					unplugged = 0;
+					vmpuPowerOn(&mpu);
+				}
+				if (faultHit(f, FAULT_INT_DELAY, next_sample)){
+					mpu.int_delay = f->arg[FAULT_INT_DELAY];
+				}
+				vmpuSample(&mpu, s ? s->x : REST_X, s ? s->y : 0, s ? s->z : 0,
+						MPU6050_TEMP_RAW(20), next_sample);
+				pending = 1;
+			}
+			delivered++;
+			next_sample += period;
+		}
+
+		g2231Tick(&periph);
+		if (mpu.int_line != int_prev){
+			if (mpu.int_line){
+				int_time = cpu.cycles;
+			} else if (int_time){
+				addLoop(r, cpu.cycles - int_time);
+				int_time = 0;
+			}
+			int_prev = mpu.int_line;
+		}
+		if (pending && (mpu.fresh & NEEDED) == NEEDED){
+			pending = 0;
+			r->good++;
+			if (f->first){
+				unsigned long long rec = cpu.cycles - f->first;
+
+				r->recoveries++;
+				r->recovery_sum += rec;
+				if (rec > r->recovery_max){
+					r->recovery_max = rec;
+				}
+				f->first = 0;
+			}
+		}
+
+		n = cpu430Step(&cpu);
+		if (n < 0){
+			fprintf(stderr, "illegal instruction 0x%04x at 0x%04x\n",
+					cpu430Read(&cpu, cpu.pc, 0), cpu.pc);
+			return -1;
+		}
+		if (!n){
+			// Asleep: skip to whatever happens next.
+			unsigned long long next = g2231NextEvent(&periph);
+
+			if (delivered < max_samples && (!next || next_sample < next)){
+				next = next_sample;
+			}
+			if (!next || next > end){
+				next = end;
+			}
+			if (next > cpu.cycles){
+				cpu.cycles = next;
+			}
+		}
+	}
+	if (pending){
+		r->lost++;
+	}
+	r->samples = delivered;
+	return 0;
+}
+
+/*
+ * loadScenarios
+ * Reads "name settings..." lines. Returns the count, or -1.
+ */
+static int loadScenarios(const char *path, scenario *out){
+	FILE *fp = fopen(path, "r");
+	char line[512];
+	int n = 0;
+
+	if (!fp){
+		perror(path);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), fp)){
+		char *p = line + strspn(line, " \t");
+		size_t len;
+
+		if (*p == '#' || *p == '\n' || !*p){
+			continue;
+		}
+		if (n == MAX_SCENARIOS){
+			fprintf(stderr, "%s: more than %d scenarios\n", path, MAX_SCENARIOS);
+			break;
+		}
+		len = strcspn(p, " \t\n");
+		if (len >= sizeof(out[n].name)){
+			len = sizeof(out[n].name) - 1;
+		}
+		memcpy(out[n].name, p, len);
+		out[n].name[len] = 0;
+		p += strcspn(p, " \t\n");
+		p += strspn(p, " \t");
+		snprintf(out[n].spec, sizeof(out[n].spec), "%s", p);
+		n++;
+	}
+	fclose(fp);
+	return n;
+}
+
+/*
+ * seedFor
+ * The scenario's seed: the -s seed mixed with its name (FNV-1a), so a
+ * scenario gets the same faults whatever else is in the file.
+ */
+static unsigned long long seedFor(unsigned long long seed, const char *name){
+	unsigned long long h = 1469598103934665603ULL;
+
+	while (*name){
+		h = (h ^ (unsigned char)*name++) * 1099511628211ULL;
+	}
+	return h ^ seed;
+}
+
+int main(int argc, char **argv){
+	static scenario from_file[MAX_SCENARIOS];
+	const scenario *sc = builtin;
+	int n_sc = sizeof(builtin) / sizeof(builtin[0]);
+	trace_set set = { NULL, 0, NULL, 0 };
+	trace t = { .rate_hz = TRACE_DEFAULT_RATE };
+	const char *trace_path = NULL;
+	unsigned long long seed = 1;
+	long max_samples = 500;
+	int rate_hz = 0, verbose = 0;
+	int c, i, k;
+
+	while ((c = getopt(argc, argv, "f:s:n:r:t:v")) != -1){
+		switch (c){
+		case 'f':
+			n_sc = loadScenarios(optarg, from_file);
+			if (n_sc < 0){
+				return 1;
+			}
+			sc = from_file;
+			break;
+		case 's': seed = strtoull(optarg, NULL, 0); break;
+		case 'n': max_samples = atol(optarg); break;
+		case 'r': rate_hz = atoi(optarg); break;
+		case 't': trace_path = optarg; break;
+		case 'v': verbose = 1; break;
+		default:
+			fprintf(stderr, "usage: %s [-f scenarios.txt] [-s seed] [-n samples] [-r rate_hz] "
+					"[-t trace.csv] [-v] image.elf | object.o...\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind >= argc){
+		fprintf(stderr, "usage: %s [options] image.elf | object.o...\n", argv[0]);
+		return 2;
+	}
+	if (trace_path){
+		if (traceSetOne(&set, trace_path)){
+			tracePerror(trace_path);
+			return 1;
+		}
+		t = set.t[0];
+	}
+	if (!rate_hz){
+		rate_hz = t.rate_hz;
+	}
+
+	printf("%ld samples per scenario at %d Hz, seed %llu\n\n", max_samples, rate_hz, seed);
+	printf("%-12s %7s %6s %7s %9s %9s %9s %9s %9s\n", "scenario", "faults", "lost", "lost%",
+			"recov ms", "recov max", "loop p50", "loop p99", "loop max");
+
+	for (i = 0; i < n_sc; i++){
+		fault f;
+		result r;
+		long total = 0;
+
+		if (faultParse(&f, sc[i].spec)){
+			fprintf(stderr, "scenario %s\n", sc[i].name);
+			return 1;
+		}
+		faultSeed(&f, seedFor(seed, sc[i].name));
+		memset(&r, 0, sizeof(r));
+		if (boot(argv + optind, argc - optind)){
+			return 1;
+		}
+		periph.faults = &f;
+		if (run(&f, &t, max_samples, 1000000ULL / rate_hz, &r)){
+			fprintf(stderr, "scenario %s\n", sc[i].name);
+			return 1;
+		}
+
+		for (k = 0; k < FAULT_KINDS; k++){
+			total += f.injected[k];
+		}
+		qsort(r.loops, r.n_loops, sizeof(*r.loops), cmpTime);
+		printf("%-12s %7ld %6ld %6.2f%%", sc[i].name, total, r.lost,
+				r.samples ? 100.0 * r.lost / r.samples : 0.0);
+		if (r.recoveries){
+			printf(" %9.1f %9.1f", r.recovery_sum / 1000.0 / r.recoveries, r.recovery_max / 1000.0);
+		} else {
+			printf(" %9s %9s", "-", "-");
+		}
+		if (r.n_loops){
+			printf(" %9.1f %9.1f %9.1f\n", percentile(&r, 50) / 1000.0,
+					percentile(&r, 99) / 1000.0, r.loops[r.n_loops - 1] / 1000.0);
+		} else {
+			printf(" %9s %9s %9s\n", "-", "-", "-");
+		}
+		if (verbose && total){
+			printf("%12s", "");
+			for (k = 0; k < FAULT_KINDS; k++){
+				if (f.injected[k]){
+					printf(" %s %ld", fault_names[k], f.injected[k]);
+				}
+			}
+			printf("\n");
+		}
+		free(r.loops);
+	}
+
+	traceSetFree(&set);
+	return 0;
+}
@@ -0,0 +1,94 @@
+#!/bin/sh
+#
+# footprint.sh
+#
+# Flash, RAM and worst-case stack of every feature profile
+# (auto_brake_light_2/libs/config.h) on the MSP430G2231: builds each
+# profile with msp430-elf-gcc, takes text/data/bss from the linked image
+# and the stack from tools/stack430, and prints them with the headroom
+# left and the change against the baseline in tools/footprint.txt.
+# A change that adds code should come with this table.
+#
+# Fails if a profile does not fit: text + data over 2 KB of flash, or
+# data + bss + stack over 128 bytes of RAM. A stack figure marked '?'
+# is a lower bound (see stack430.c).
+#
+# Needs msp430-elf-gcc and msp430-elf-size (TI's GCC build, with its
+# device headers and linker scripts on the default search path).
+#
+# The second line of footprint.txt is the compiler the baseline was
+# taken with. The one committed was built with clang's MSP430 backend in
+# place of msp430-elf-gcc (CC430/SIZE430): its code is not GCC's (no
+# jump tables for the USI state machine, abs() out of line), so the
+# margins are indicative, and the baseline should be re-taken with -u on
+# msp430-elf-gcc. On it MINIMAL and STANDARD fit; LOGGER, DEBUG and FIFO
+# do not yet, and are not bike builds until they do.
+#
+# Usage (from the repository root):
+#   tools/footprint.sh [-u] [extra CFLAGS...]
+#
+# -u writes the results to tools/footprint.txt as the new baseline.
+# PROFILES overrides the profiles built, e.g.
+#   PROFILES="STANDARD FIFO" tools/footprint.sh -DDECIM_ORDER=3
+
+set -e
+
+CC=${CC430:-msp430-elf-gcc}
+SIZE=${SIZE430:-msp430-elf-size}
+MCU=${MCU:-msp430g2231}
+FW=auto_brake_light_2
+LIBS=$FW/libs
+PROFILES=${PROFILES:-"MINIMAL STANDARD LOGGER DEBUG FIFO"}
+BASELINE=tools/footprint.txt
+FLASH=2048
+RAM=128
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+update=0
+if [ "$1" = "-u" ]; then
+	update=1
+	shift
+fi
+
+cc -O2 -o "$TMP/stack430" tools/stack430.c tools/cpu430.c tools/elf430.c
+
+printf '%-9s %6s %5s %5s %6s %6s %6s %9s %9s\n' profile text data bss stack flash ram "free fl" "free ram"
+: > "$TMP/new"
+status=0
+for p in $PROFILES; do
+	"$CC" -mmcu="$MCU" -Os -ffunction-sections -fdata-sections -Wl,--gc-sections \
+		-I"$LIBS" -DCONFIG_PROFILE=PROFILE_"$p" "$@" -o "$TMP/$p.elf" "$FW/main.c" "$LIBS"/*.c
+	read text data bss <<-EOF
+	$("$SIZE" "$TMP/$p.elf" | awk 'NR == 2 { print $1, $2, $3 }')
+	EOF
+	stack=$("$TMP/stack430" -q "$TMP/$p.elf")
+	echo "$p $text $data $bss $stack" >> "$TMP/new"
+
+	old=$(awk -v p="$p" '$1 == p' "$BASELINE" 2>/dev/null || true)
+	awk -v p="$p" -v t="$text" -v d="$data" -v b="$bss" -v s="$stack" -v old="$old" \
+			-v flash=$FLASH -v ram=$RAM 'BEGIN {
+		st = s + 0
+		fl = t + d
+		rm = d + b + st
+		printf "%-9s %6d %5d %5d %6s %6d %6d %9d %9d", p, t, d, b, s, fl, rm, flash - fl, ram - rm
+		if (split(old, o, " ") == 5)
+			printf "   flash %+d, ram %+d", fl - (o[2] + o[3]), rm - (o[3] + o[4] + o[5])
+		else
+			printf "   (no baseline)"
+		if (fl > flash || rm > ram) {
+			printf "   DOES NOT FIT\n"
+			exit 1
+		}
+		printf "\n"
+	}' || status=1
+done
+
+if [ $update = 1 ]; then
+	{
+		echo "# tools/footprint.sh baseline: profile text data bss stack"
+		echo "# $("$CC" --version | head -n 1), -mmcu=$MCU -Os"
+		cat "$TMP/new"
+	} > "$BASELINE"
+fi
+exit $status
@@ -0,0 +1,651 @@
+/*
+ * g2231.c
+ *
+ *  MSP430G2231 peripheral models. See g2231.h.
+ */
+
+#include "g2231.h"
+
+#include <stddef.h>
+
+// Register addresses (MSP430G2x21 datasheet).
+#define P1IN 0x20
+#define P1OUT 0x21
+#define P1DIR 0x22
+#define P1IFG 0x23
+#define P1IES 0x24
+#define P1IE 0x25
+#define P2IN 0x28
+#define P2OUT 0x29
+#define P2DIR 0x2A
+#define P2IFG 0x2B
+#define P2IE 0x2D
+#define IE1 0x00
+#define IFG1 0x02
+#define WDTCTL 0x120
+#define USICTL0 0x78
+#define USICTL1 0x79
+#define USICKCTL 0x7A
+#define USICNT 0x7B
+#define USISRL 0x7C
+#define TAIV 0x12E
+#define TACTL 0x160
+#define TACCTL0 0x162
+#define TACCTL1 0x164
+#define TAR 0x170
+#define TACCR0 0x172
+#define TACCR1 0x174
+#define ADC10CTL0 0x1B0
+#define ADC10CTL1 0x1B2
+#define ADC10MEM 0x1B4
+
+// USICTL0 / USICTL1 bits
+#define USIGE 0x04
+#define USIOE 0x02
+#define USISWRST 0x01
+#define USISTTIE 0x20
+#define USIIE 0x10
+#define USISTTIFG 0x02
+#define USIIFG 0x01
+#define USIIFGCC 0x20
+#define USIPE6 0x40
+
+// WDTCTL / IE1 / IFG1 bits
+#define WDTHOLD 0x80
+#define WDTTMSEL 0x10
+#define WDTCNTCL 0x08
+#define WDTSSEL 0x04
+#define WDTIS 0x03
+#define WDTIE 0x01
+#define WDTIFG 0x01
+
+// TACTL / TACCTLx bits
+#define TASSEL 0x0300
+#define TASSEL_ACLK 0x0100
+#define TASSEL_SMCLK 0x0200
+#define TAID 0x00C0
+#define TAMC 0x0030
+#define TAMC_CONT 0x0020
+#define TACLR 0x0004
+#define TAIE 0x0002
+#define TAIFG 0x0001
+#define CCIE 0x0010
+#define CCIFG 0x0001
+
+// ADC10CTL0 / ADC10CTL1 bits
+#define ADC10SC 0x0001
+#define ENC 0x0002
+#define ADC10IFG 0x0004
+#define ADC10IE 0x0008
+#define ADC10ON 0x0010
+#define REF2_5V 0x0040
+#define ADC10SHT 0x1800
+#define SREF 0xE000
+#define SREF_1 0x2000
+#define INCH 0xF000
+#define INCH_11 0xB000
+#define ADC10DIV 0x00E0
+#define ADC10SSEL 0x0018
+#define ADC10OSC_HZ 5000000		// typical, 3.7 to 6.3 MHz
+
+// SR bits that stop clocks
+#define SR_OSCOFF 0x0020
+#define SR_SCG1 0x0080
+
+#define I2C_PULLUPS 0xC0		// SCL and SDA idle high
+
+// What completes when usi_done is reached.
+enum{
+	OP_TX_BYTE,		// master shifted a byte out
+	OP_TX_BITS,		// master drove (N)ACK or a stop/restart preparation bit
+	OP_RX_ACK,		// master sampled the slave's (N)ACK
+	OP_RX_BYTE		// master shifted a byte in
+};
+
+static unsigned int word(const unsigned char *mem, unsigned int addr){
+	return mem[addr] | (mem[addr + 1] << 8);
+}
+
+static void setWord(unsigned char *mem, unsigned int addr, unsigned int val){
+	mem[addr] = val;
+	mem[addr + 1] = val >> 8;
+}
+
+// Timer_A input clock in Hz under the current SR, 0 if it is not counting.
+static unsigned long taClock(const g2231 *g){
+	const unsigned char *mem = g->cpu->mem;
+	unsigned int ctl = word(mem, TACTL);
+	unsigned int sr = g->cpu->r[2];
+
+	if (!(ctl & TAMC) || (sr & SR_OSCOFF)
+			|| ((ctl & TAMC) != TAMC_CONT && !word(mem, TACCR0))){
+		return 0;	// stopped, or up mode with CCR0 = 0
+	}
+	switch (ctl & TASSEL){
+	case TASSEL_SMCLK:
+		return sr & SR_SCG1 ? 0 : 1000000;
+	case TASSEL_ACLK:
+		return G2231_VLO_HZ;
+	}
+	return 0;		// TACLK/INCLK: nothing on those pins
+}
+
+// TAR counts 0 .. period - 1.
+static unsigned long taPeriod(const unsigned char *mem){
+	if ((word(mem, TACTL) & TAMC) == TAMC_CONT){
+		return 0x10000;
+	}
+	return word(mem, TACCR0) + 1UL;		// up (and up/down, counted as up)
+}
+
+// Counts until TAR next becomes v (1 to period), 0 if it never does.
+static unsigned long taDistance(unsigned int tar, unsigned int v, unsigned long period){
+	if (v >= period){
+		return 0;
+	}
+	return v > tar ? v - tar : period - tar + v;
+}
+
+/*
+ * taAdvance
+ * n counts of Timer_A: moves TAR and sets the CCIFG and TAIFG flags of
+ * every compare and wrap it passes.
+ */
+static void taAdvance(g2231 *g, unsigned long long n){
+	unsigned char *mem = g->cpu->mem;
+	unsigned long period = taPeriod(mem);
+	unsigned int ccr0 = word(mem, TACCR0), ccr1 = word(mem, TACCR1);
+	unsigned long tar = word(mem, TAR) % period;
+	unsigned long d0, d1, dz, step;
+
+	if (n >= period){
+		// A whole period or more: every flag, then only the remainder matters.
+		if (ccr0 < period){
+			mem[TACCTL0] |= CCIFG;
+		}
+		if (ccr1 < period){
+			mem[TACCTL1] |= CCIFG;
+		}
+		mem[TACTL] |= TAIFG;
+		n %= period;
+	}
+	while (n){
+		d0 = taDistance(tar, ccr0, period);
+		d1 = taDistance(tar, ccr1, period);
+		dz = period - tar;
+		step = n < dz ? n : dz;
+		if (d0 && d0 < step){
+			step = d0;
+		}
+		if (d1 && d1 < step){
+			step = d1;
+		}
+		tar = (tar + step) % period;
+		n -= step;
+		if (step == d0){
+			mem[TACCTL0] |= CCIFG;
+		}
+		if (step == d1){
+			mem[TACCTL1] |= CCIFG;
+		}
+		if (step == dz){
+			mem[TACTL] |= TAIFG;
+		}
+	}
+	setWord(mem, TAR, tar);
+}
+
+/*
+ * taSync
+ * Brings TAR up to the current cycle. The clock state in SR now stands
+ * for the whole interval since the last call, which is one instruction
+ * or one sleep.
+ */
+static void taSync(g2231 *g){
+	unsigned long long now = g->cpu->cycles;
+	unsigned long long unit = 1000000ULL << ((word(g->cpu->mem, TACTL) & TAID) >> 6);
+	unsigned long hz = taClock(g);
+
+	if (hz && now > g->ta_last){
+		g->ta_acc += (now - g->ta_last) * hz;
+		taAdvance(g, g->ta_acc / unit);
+		g->ta_acc %= unit;
+	}
+	g->ta_last = now;
+}
+
+// Cycle of the next enabled Timer_A interrupt, 0 if the clock is stopped.
+static unsigned long long taNext(const g2231 *g){
+	const unsigned char *mem = g->cpu->mem;
+	unsigned long long unit = 1000000ULL << ((word(mem, TACTL) & TAID) >> 6);
+	unsigned long hz = taClock(g);
+	unsigned long period, d = 0, e;
+	unsigned int tar;
+
+	if (!hz){
+		return 0;
+	}
+	period = taPeriod(mem);
+	tar = word(mem, TAR) % period;
+	if (mem[TACCTL0] & CCIE){
+		d = taDistance(tar, word(mem, TACCR0), period);
+	}
+	if (mem[TACCTL1] & CCIE){
+		e = taDistance(tar, word(mem, TACCR1), period);
+		if (e && (!d || e < d)){
+			d = e;
+		}
+	}
+	if (mem[TACTL] & TAIE){
+		e = period - tar;
+		if (!d || e < d){
+			d = e;
+		}
+	}
+	if (!d){
+		return 0;
+	}
+	return g->ta_last + (d * unit - g->ta_acc + hz - 1) / hz;
+}
+
+// TAIV: the highest pending CCR1/overflow interrupt, whose flag it clears.
+static unsigned int taIv(g2231 *g){
+	unsigned char *mem = g->cpu->mem;
+
+	taSync(g);
+	if ((mem[TACCTL1] & CCIE) && (mem[TACCTL1] & CCIFG)){
+		mem[TACCTL1] &= ~CCIFG;
+		return 2;
+	}
+	if ((mem[TACTL] & TAIE) && (mem[TACTL] & TAIFG)){
+		mem[TACTL] &= ~TAIFG;
+		return 10;
+	}
+	return 0;
+}
+
+// ADC10 single conversion: sample and hold plus 13 clocks.
+static void adcStart(g2231 *g){
+	static const unsigned long sht[4] = { 4, 8, 16, 64 };
+	unsigned char *mem = g->cpu->mem;
+	unsigned int ctl0 = word(mem, ADC10CTL0), ctl1 = word(mem, ADC10CTL1);
+	unsigned long long clocks = (sht[(ctl0 & ADC10SHT) >> 11] + 13) * (((ctl1 & ADC10DIV) >> 5) + 1);
+	unsigned long hz;
+
+	switch ((ctl1 & ADC10SSEL) >> 3){
+	case 0: hz = ADC10OSC_HZ; break;
+	case 1: hz = G2231_VLO_HZ; break;
+	default: hz = 1000000; break;	// MCLK, SMCLK
+	}
+	g->adc_done = g->cpu->cycles + (clocks * 1000000ULL + hz - 1) / hz;
+}
+
+static void adcComplete(g2231 *g){
+	unsigned char *mem = g->cpu->mem;
+	unsigned int ctl0 = word(mem, ADC10CTL0);
+	unsigned long vin = 0, vref = g->vcc_mv;
+
+	if ((word(mem, ADC10CTL1) & INCH) == INCH_11){
+		vin = g->vcc_mv / 2;
+	}
+	if ((ctl0 & SREF) == SREF_1){
+		vref = ctl0 & REF2_5V ? 2500 : 1500;
+	}
+	setWord(mem, ADC10MEM, vin >= vref ? 1023 : vin * 1023 / vref);
+	setWord(mem, ADC10CTL0, (ctl0 & ~ADC10SC) | ADC10IFG);
+	g->adc_done = 0;
+}
+
+static unsigned int readByte(g2231 *g, unsigned int addr){
+	unsigned char *mem = g->cpu->mem;
+	unsigned char lines = I2C_PULLUPS;
+
+	switch (addr){
+	case P1IN:
+		if (g->sda_clocks){
+			lines &= ~G2231_SDA;
+		}
+		if (g->scl_until > g->cpu->cycles){
+			lines &= ~G2231_SCL;
+		}
+		if (g->mpu->int_line){
+			lines |= G2231_ACCEL_INT;
+		}
+		return (mem[P1OUT] & mem[P1DIR]) | (~mem[P1DIR] & lines);
+	case P2IN:
+		return mem[P2OUT] & mem[P2DIR];
+	case WDTCTL + 1:
+		return 0x69;	// reads as 0x69, written with WDTPW (0x5A)
+	case TAR:
+	case TAR + 1:
+		taSync(g);
+		break;
+	case TAIV:
+		return taIv(g);
+	case TAIV + 1:
+		return 0;
+	}
+	return mem[addr];
+}
+
+static unsigned int ioRead(cpu430 *c, unsigned int addr, int byte){
+	g2231 *g = c->user;
+
+	if (byte){
+		return readByte(g, addr);
+	}
+	return readByte(g, addr) | (readByte(g, addr + 1) << 8);
+}
+
+/*
+ * busWrite
+ * A byte the master shifts out. Returns 1 if SDA was low at the ACK.
+ */
+static int busWrite(g2231 *g, unsigned char b){
+	unsigned long long now = g->cpu->cycles;
+	int address = g->after_start;
+
+	g->after_start = 0;
+	if (g->sda_clocks){
+		return 1;		// SDA held low: looks like an ACK, the slave never saw it
+	}
+	if (g->faults && faultUnplugged(g->faults, now)){
+		return 0;
+	}
+	if (g->faults && faultHit(g->faults, address ? FAULT_NACK_ADDR : FAULT_NACK_DATA, now)){
+		vmpuStop(g->mpu);	// and it stops listening
+		return 0;
+	}
+	return vmpuWrite(g->mpu, b);
+}
+
+static void usiLoad(g2231 *g, int n){
+	unsigned char *mem = g->cpu->mem;
+	unsigned int div = 1u << ((mem[USICKCTL] >> 5) & 7);
+	unsigned long long start = g->cpu->cycles;
+	fault *f = g->faults;
+
+	if (f && n == 8){
+		if (faultHit(f, FAULT_SCL, start)){
+			g->scl_until = start + f->arg[FAULT_SCL];
+		}
+		if (faultHit(f, FAULT_STRETCH, start)){
+			start += f->arg[FAULT_STRETCH];
+		}
+	}
+	if (g->scl_until > start){
+		start = g->scl_until;		// the master waits for SCL to go high
+	}
+
+	if (mem[USICTL0] & USIOE){
+		if (n == 8){
+			g->usi_op = OP_TX_BYTE;
+			g->last_ack = busWrite(g, mem[USISRL]);
+		} else {
+			g->usi_op = OP_TX_BITS;
+		}
+	} else {
+		g->usi_op = n == 1 ? OP_RX_ACK : OP_RX_BYTE;
+		g->rx_lost = g->sda_clocks || (f && faultUnplugged(f, start));
+	}
+	g->sda_clocks = g->sda_clocks > n ? g->sda_clocks - n : 0;
+	g->usi_done = start + n * div;
+}
+
+static void usiComplete(g2231 *g){
+	unsigned char *mem = g->cpu->mem;
+	int n = mem[USICNT] & 0x1F;
+
+	switch (g->usi_op){
+	case OP_TX_BYTE:
+		g->i2c_bytes++;		// the shift register reads back what was driven
+		break;
+	case OP_TX_BITS:
+		mem[USISRL] = (mem[USISRL] << n) | (mem[USISRL] >> (8 - n));
+		break;
+	case OP_RX_ACK:
+		mem[USISRL] = (mem[USISRL] << 1) | !g->last_ack;
+		break;
+	case OP_RX_BYTE:
+		if (g->rx_lost){
+			mem[USISRL] = g->sda_clocks ? 0x00 : 0xFF;		// stuck low, or nobody there
+		} else {
+			mem[USISRL] = vmpuRead(g->mpu);
+			if (g->faults && faultHit(g->faults, FAULT_CORRUPT, g->cpu->cycles)){
+				mem[USISRL] ^= 1 << (g->faults->rng & 7);
+				vmpuSpoil(g->mpu);
+			}
+		}
+		g->i2c_bytes++;
+		break;
+	}
+	mem[USICNT] &= ~0x1F;
+	mem[USICTL1] |= USIIFG;
+	g->usi_done = 0;
+}
+
+/*
+ * busCondition
+ * START (sda 0) or STOP (sda 1) on the bus. A slave holding SDA low
+ * sees neither, and an unplugged one nothing at all.
+ */
+static void busCondition(g2231 *g, int sda){
+	unsigned long long now = g->cpu->cycles;
+
+	if (g->sda_clocks || (g->faults && faultUnplugged(g->faults, now))){
+		return;
+	}
+	if (sda){
+		vmpuStop(g->mpu);
+		return;
+	}
+	vmpuStart(g->mpu);
+	g->after_start = 1;
+	if (g->faults && faultHit(g->faults, FAULT_SDA, now)){
+		g->sda_clocks = g->faults->arg[FAULT_SDA];
+	}
+}
+
+/*
+ * wdtWrite
+ * WDTCTL written with the right password: (re)start or stop the interval timer.
+ */
+static void wdtWrite(g2231 *g){
+	static const unsigned long div[4] = { 32768, 8192, 512, 64 };
+	unsigned char *mem = g->cpu->mem;
+	unsigned char ctl = mem[WDTCTL];
+	unsigned long long period = div[ctl & WDTIS];
+
+	if ((ctl & WDTHOLD) || !(ctl & WDTTMSEL)){
+		g->wdt_next = 0;
+		return;
+	}
+	if (ctl & WDTSSEL){
+		period = period * 1000000ULL / G2231_VLO_HZ;
+	}
+	if ((ctl & WDTCNTCL) || !g->wdt_next){
+		g->wdt_next = g->cpu->cycles + period;
+	}
+	g->wdt_period = period;
+	mem[WDTCTL] &= ~WDTCNTCL;		// always reads 0
+}
+
+static void writeByte(g2231 *g, unsigned int addr, unsigned int val){
+	unsigned char *mem = g->cpu->mem;
+	unsigned char old = mem[addr];
+
+	if (addr >= TACTL && addr <= TACCR1 + 1){
+		taSync(g);		// count up to now with the old settings
+	}
+	mem[addr] = val;
+	switch (addr){
+	case P1OUT:
+	case P2OUT:
+		if (g->pin_write){
+			g->pin_write(g, addr == P1OUT ? 1 : 2, old, val);
+		}
+		break;
+	case P1DIR:
+		// SCL released by hand (GPIO, open drain): one clock for a stuck slave.
+		if ((old & ~val & G2231_SCL) && !(mem[USICTL0] & USIPE6) && g->sda_clocks
+				&& g->scl_until <= g->cpu->cycles){
+			g->sda_clocks--;
+		}
+		break;
+	case WDTCTL + 1:
+		if (val == 0x5A){
+			wdtWrite(g);
+		}
+		break;
+	case USICTL0:
+		if (val & USISWRST){
+			g->usi_done = 0;
+		} else if (!(old & USIGE) && (val & USIGE) && (val & USIOE)){
+			// Latch opened with SCL high: SDA follows the MSB of USISRL.
+			busCondition(g, mem[USISRL] & 0x80);
+		}
+		break;
+	case TACTL:
+		if (val & TACLR){
+			setWord(mem, TAR, 0);
+			mem[TACTL] &= ~TACLR;	// always reads 0
+			g->ta_acc = 0;
+		}
+		break;
+	case ADC10CTL0:
+		if (!(val & ADC10ON)){
+			g->adc_done = 0;
+		} else if ((val & (ENC | ADC10SC)) == (ENC | ADC10SC) && !g->adc_done){
+			adcStart(g);
+		}
+		break;
+	case USICNT:
+		if (!(val & USIIFGCC)){
+			mem[USICTL1] &= ~USIIFG;	// automatic clear, unless disabled
+		}
+		if ((val & 0x1F) && !(mem[USICTL0] & USISWRST)){
+			usiLoad(g, val & 0x1F);
+		}
+		break;
+	}
+}
+
+static void ioWrite(cpu430 *c, unsigned int addr, unsigned int val, int byte){
+	g2231 *g = c->user;
+
+	writeByte(g, addr, val & 0xFF);
+	if (!byte){
+		writeByte(g, addr + 1, (val >> 8) & 0xFF);
+	}
+}
+
+void g2231Init(g2231 *g, cpu430 *c, vmpu *m){
+	g->cpu = c;
+	g->mpu = m;
+	g->pin_write = NULL;
+	g->faults = NULL;
+	g->usi_done = 0;
+	g->last_ack = 0;
+	g->int_prev = 0;
+	g->i2c_bytes = 0;
+	g->wdt_next = 0;
+	g->wdt_req = 0;
+	g->after_start = 0;
+	g->rx_lost = 0;
+	g->sda_clocks = 0;
+	g->scl_until = 0;
+	g->ta_last = 0;
+	g->ta_acc = 0;
+	g->ta0_req = 0;
+	g->vcc_mv = 3000;
+	g->adc_done = 0;
+	g->adc_req = 0;
+	c->user = g;
+	c->io_read = ioRead;
+	c->io_write = ioWrite;
+	c->mem[USICTL0] = USISWRST;		// reset values
+	c->mem[USICTL1] = USIIFG;
+}
+
+void g2231Tick(g2231 *g){
+	cpu430 *c = g->cpu;
+	unsigned char *mem = c->mem;
+
+	if (g->usi_done && c->cycles >= g->usi_done){
+		usiComplete(g);
+	}
+
+	// Interval mode: the flag clears itself when the interrupt is taken.
+	if (g->wdt_req && !(c->irq & (1u << G2231_WDT_VECTOR))){
+		mem[IFG1] &= ~WDTIFG;
+	}
+	while (g->wdt_next && c->cycles >= g->wdt_next){
+		mem[IFG1] |= WDTIFG;
+		g->wdt_next += g->wdt_period;
+	}
+
+	// CCR0 and ADC10 flags clear themselves when the interrupt is taken too.
+	if (g->ta0_req && !(c->irq & (1u << G2231_TIMERA0_VECTOR))){
+		mem[TACCTL0] &= ~CCIFG;
+	}
+	if (g->adc_req && !(c->irq & (1u << G2231_ADC10_VECTOR))){
+		mem[ADC10CTL0] &= ~ADC10IFG;
+	}
+	taSync(g);
+	if (g->adc_done && c->cycles >= g->adc_done){
+		adcComplete(g);
+	}
+
+	vmpuTick(g->mpu, c->cycles);
+	if (g->mpu->int_line != g->int_prev){
+		// P1IES clear: rising edge
+		if (g->mpu->int_line != !!(mem[P1IES] & G2231_ACCEL_INT)){
+			mem[P1IFG] |= G2231_ACCEL_INT;
+		}
+		g->int_prev = g->mpu->int_line;
+	}
+
+	c->irq = 0;
+	if (mem[P1IE] & mem[P1IFG]){
+		c->irq |= 1u << G2231_PORT1_VECTOR;
+	}
+	if (mem[P2IE] & mem[P2IFG]){
+		c->irq |= 1u << G2231_PORT2_VECTOR;
+	}
+	if (((mem[USICTL1] & USIIE) && (mem[USICTL1] & USIIFG))
+			|| ((mem[USICTL1] & USISTTIE) && (mem[USICTL1] & USISTTIFG))){
+		c->irq |= 1u << G2231_USI_VECTOR;
+	}
+	g->wdt_req = mem[IE1] & mem[IFG1] & WDTIE;
+	if (g->wdt_req){
+		c->irq |= 1u << G2231_WDT_VECTOR;
+	}
+	g->ta0_req = (mem[TACCTL0] & CCIE) && (mem[TACCTL0] & CCIFG);
+	if (g->ta0_req){
+		c->irq |= 1u << G2231_TIMERA0_VECTOR;
+	}
+	if (((mem[TACCTL1] & CCIE) && (mem[TACCTL1] & CCIFG))
+			|| ((mem[TACTL] & TAIE) && (mem[TACTL] & TAIFG))){
+		c->irq |= 1u << G2231_TIMERA1_VECTOR;
+	}
+	g->adc_req = (mem[ADC10CTL0] & ADC10IE) && (mem[ADC10CTL0] & ADC10IFG);
+	if (g->adc_req){
+		c->irq |= 1u << G2231_ADC10_VECTOR;
+	}
+}
+
+static unsigned long long earlier(unsigned long long a, unsigned long long b){
+	return !a || (b && b < a) ? b : a;
+}
+
+unsigned long long g2231NextEvent(const g2231 *g){
+	unsigned long long next = g->usi_done;
+
+	if (g->mpu->int_line){
+		next = earlier(next, g->mpu->int_until);
+	}
+	next = earlier(next, g->mpu->int_at);
+	next = earlier(next, taNext(g));
+	next = earlier(next, g->adc_done);
+	return earlier(next, g->wdt_next);
+}
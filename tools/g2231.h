@@ -0,0 +1,99 @@
+/*
+ * g2231.h
+ *
+ *  Peripheral models of the MSP430G2231 for the simulator tools.
+ *
+ *  Enough of the part to run the firmware against a virtual MPU-6050:
+ *  - port 1 and 2 (P1.0 is ACCEL_INT, wired to the sensor's INT pin;
+ *    edges set P1IFG per P1IES and raise PORT1_VECTOR),
+ *  - the USI in I2C master mode, with SCL timing from USICKCTL and the
+ *    sensor on the bus (START/STOP from the USIGE latch trick iic.c
+ *    uses, bytes and (N)ACK bits from USICNT loads and USIOE),
+ *  - the watchdog in interval timer mode (WDTIFG, WDT_VECTOR), from
+ *    SMCLK or from ACLK = VLO at G2231_VLO_HZ. Watchdog mode does not
+ *    reset the part, and the SMCLK source keeps counting in LPM3.
+ *  - Timer_A in up and continuous mode from SMCLK or ACLK, with the
+ *    input divider: TAR, compare flags and interrupts for CCR0/CCR1,
+ *    TAIFG, TAIV. SMCLK stops in LPM3 and LPM4, ACLK in LPM4. Capture
+ *    mode and the output units (TA0.x pins) are not modelled.
+ *  - the ADC10, single conversions: the conversion time from the sample
+ *    and hold setting and clock, and a result for INCH_11 ((VCC - VSS)/2)
+ *    from vcc_mv against VCC or the internal 1.5/2.5 V reference. Other
+ *    channels read 0.
+ *  Everything else in the peripheral space reads back what was written.
+ *
+ *  With 'faults' set, the bus and the sensor misbehave as fault.h
+ *  describes: SDA/SCL held low show up on P1IN and in the USI, and SCL
+ *  clocks made by hand on P1.6 (P1DIR toggles, as a bus clear does)
+ *  count towards releasing a stuck SDA.
+ *
+ *  The clock is the CPU cycle counter: MCLK = SMCLK = 1 MHz DCO, as
+ *  main() sets it up. DCO start-up from LPM3 is not modelled (under a
+ *  microsecond on this part).
+ */
+
+#ifndef G2231_H_
+#define G2231_H_
+
+#include "cpu430.h"
+#include "fault.h"
+#include "vmpu.h"
+
+// Vector numbers for cpu430Irq(): (address - 0xFFE0) / 2.
+#define G2231_PORT1_VECTOR 2
+#define G2231_PORT2_VECTOR 3
+#define G2231_USI_VECTOR 4
+#define G2231_ADC10_VECTOR 5
+#define G2231_TIMERA1_VECTOR 8
+#define G2231_TIMERA0_VECTOR 9
+#define G2231_WDT_VECTOR 10
+
+#define G2231_ACCEL_INT 0x01	// P1.0
+#define G2231_SCL 0x40			// P1.6
+#define G2231_SDA 0x80			// P1.7
+#define G2231_VLO_HZ 12000		// typical; 4 to 20 kHz over parts and temperature
+
+typedef struct g2231_struct g2231;
+
+// Called after every write to P1OUT (port 1) or P2OUT (port 2).
+typedef void (*g2231_pin_fn)(g2231 *g, int port, unsigned char old, unsigned char val);
+
+struct g2231_struct{
+	cpu430 *cpu;
+	vmpu *mpu;
+	g2231_pin_fn pin_write;
+	fault *faults;					// NULL: a perfect bus
+	void *user;
+
+	unsigned long long usi_done;	// cycle the running USI count completes, 0 if idle
+	int usi_op;						// what completes then, see g2231.c
+	int last_ack;					// slave's answer to the last byte written
+	int int_prev;					// previous level of the INT line
+	long i2c_bytes;					// bytes moved on the bus
+
+	unsigned long long wdt_next;	// cycle of the next WDTIFG, 0 if stopped
+	unsigned long long wdt_period;
+	int wdt_req;					// WDT interrupt requested at the last tick
+
+	unsigned long long ta_last;		// cycle TAR was last brought up to date
+	unsigned long long ta_acc;		// clock fraction left over, in Hz * cycles
+	int ta0_req;					// CCR0 interrupt requested at the last tick
+
+	int vcc_mv;						// supply, for the ADC10 (default 3000)
+	unsigned long long adc_done;	// cycle the running conversion completes, 0 if idle
+	int adc_req;					// ADC10 interrupt requested at the last tick
+
+	int after_start;				// next byte written is the slave address
+	int rx_lost;					// the running receive will not see the slave
+	int sda_clocks;					// SCL clocks the slave still holds SDA low for
+	unsigned long long scl_until;	// SCL held low until this cycle
+};
+
+// Installs the io hooks on c. c->user is set to g.
+void g2231Init(g2231 *g, cpu430 *c, vmpu *m);
+// Brings everything up to c->cycles and sets c->irq. Call before every step.
+void g2231Tick(g2231 *g);
+// Cycle of the next peripheral event, 0 if there is none pending.
+unsigned long long g2231NextEvent(const g2231 *g);
+
+#endif /* G2231_H_ */
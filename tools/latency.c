@@ -0,0 +1,261 @@
+/*
+ * latency.c
+ *
+ *  End-to-end latency from ACCEL_INT to the LEDs, on the simulator.
+ *
+ *  Runs a firmware image built with LATENCY_PROBE=1 on the CPU model
+ *  (cpu430.c) with the G2231 ports and USI (g2231.c) and a virtual
+ *  MPU-6050 (vmpu.c) on the I2C bus, fed from a ride trace at its
+ *  sample rate. Every time the sensor raises INT, the probe edges on
+ *  P2.6 (see probe.h) are timestamped, and the report gives min, mean
+ *  and max for each stage and for the whole path. Cycles are
+ *  microseconds at the 1 MHz DCO setting main() uses.
+ *
+ *  It also counts samples the sensor overwrote before they were read,
+ *  i.e. the loop not keeping up with the sample rate.
+ *
+ *  Build (from the repository root):
+ *    cc -O2 -Iauto_brake_light_2/libs -o latency tools/latency.c \
+ *        tools/cpu430.c tools/elf430.c tools/g2231.c tools/vmpu.c \
+ *        tools/fault.c tools/trace.c
+ *
+ *  and the firmware with -DLATENCY_PROBE=1.
+ *
+ *  Usage:
+ *    latency [-r rate_hz] [-n samples] [-t trace.csv] image.elf | object.o...
+ *
+ *  Without -t the sensor reports 1 g along X, at rest.
+ *
+ *  Measured on the MINIMAL and STANDARD images (the same code), over a
+ *  900 s ridegen ride at 5 Hz (ridegen -n 1 -d 900 -s 1 -r 5), 4500
+ *  samples, none overwritten:
+ *
+ *    ACCEL_INT -> LEDs set   min 22402, mean 24510, max 25011 us
+ *
+ *  22051 us of it is readAccel(), the I2C read, and up to 2891 us
+ *  detectStep(). Built with a clang/LLVM 14 MSP430 compiler in place
+ *  of msp430-elf-gcc; re-run with it.
+ */
+
+#include "cpu430.h"
+#include "elf430.h"
+#include "g2231.h"
+#include "trace.h"
+#include "vmpu.h"
+
+#include <mpu6050.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define PROBE_BIT 0x40		// P2.6
+#define EDGES 6
+#define REST_X 16384		// 1 g at AFS_SEL 0
+
+static const char *const stage_names[EDGES + 1] = {
+	"ACCEL_INT -> PORT1 ISR",
+	"ISR -> main() awake",
+	"awake -> readAccel() done",
+	"readAccel -> detectStep() done",
+	"detectStep -> LEDs set",
+	"LEDs -> loop done",
+	"ACCEL_INT -> LEDs set",
+};
+
+typedef struct stat_struct{
+	unsigned long long min, max, sum;
+	long n;
+} stat;
+
+static cpu430 cpu;
+static vmpu mpu;
+static g2231 periph;
+
+static unsigned long long int_time;		// last INT rising edge
+static int int_pending;					// INT rose, its record not opened yet
+static unsigned long long edge[EDGES];
+static int n_edges;
+static stat stages[EDGES + 1];
+static long incomplete;
+
+static void addStat(stat *s, unsigned long long v){
+	if (!s->n || v < s->min){
+		s->min = v;
+	}
+	if (v > s->max){
+		s->max = v;
+	}
+	s->sum += v;
+	s->n++;
+}
+
+/*
+ * pinWrite
+ * Collects the probe edges of one sample. A rising edge with no
+ * record open starts a new one if ACCEL_INT rose since the last one
+ * (a watchdog wake toggles the pin too, but has no ISR), the sixth edge
+ * closes it.
+ */
+static void pinWrite(g2231 *g, int port, unsigned char old, unsigned char val){
+	int i;
+
+	(void)g;
+	if (port != 2 || !((old ^ val) & PROBE_BIT)){
+		return;
+	}
+	if (n_edges == 0){
+		if (!(val & PROBE_BIT) || !int_pending){
+			return;		// stray fall (PROBE_INIT()), or marks of a watchdog wake
+		}
+		int_pending = 0;
+	}
+	edge[n_edges++] = cpu.cycles;
+	if (n_edges < EDGES){
+		return;
+	}
+
+	addStat(&stages[0], edge[0] - int_time);
+	for (i = 1; i < EDGES; i++){
+		addStat(&stages[i], edge[i] - edge[i - 1]);
+	}
+	addStat(&stages[EDGES], edge[4] - int_time);
+	n_edges = 0;
+}
+
+static void printStat(const char *name, const stat *s){
+	if (!s->n){
+		printf("%-32s %9s %9s %9s\n", name, "-", "-", "-");
+		return;
+	}
+	printf("%-32s %9llu %9.1f %9llu\n", name, s->min, (double)s->sum / s->n, s->max);
+}
+
+int main(int argc, char **argv){
+	elf430 e;
+	trace_set set = { NULL, 0, NULL, 0 };
+	trace t = { .rate_hz = TRACE_DEFAULT_RATE };
+	const char *trace_path = NULL;
+	long max_samples = 100;
+	long delivered = 0;
+	int rate_hz = 0;
+	unsigned long long period, next_sample, idle = 0;
+	int c, i, int_prev = 0;
+
+	while ((c = getopt(argc, argv, "r:n:t:")) != -1){
+		switch (c){
+		case 'r': rate_hz = atoi(optarg); break;
+		case 'n': max_samples = atol(optarg); break;
+		case 't': trace_path = optarg; break;
+		default:
+			fprintf(stderr, "usage: %s [-r rate_hz] [-n samples] [-t trace.csv] "
+					"image.elf | object.o...\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind >= argc){
+		fprintf(stderr, "usage: %s [options] image.elf | object.o...\n", argv[0]);
+		return 2;
+	}
+	if (trace_path){
+		if (traceSetOne(&set, trace_path)){
+			tracePerror(trace_path);
+			return 1;
+		}
+		t = set.t[0];
+		if (t.n < max_samples){
+			max_samples = t.n;
+		}
+	}
+	if (!rate_hz){
+		rate_hz = t.rate_hz;
+	}
+	period = 1000000ULL / rate_hz;
+
+	elf430Init(&e);
+	for (i = optind; i < argc; i++){
+		if (elf430Load(&e, &cpu, argv[i])){
+			return 1;
+		}
+	}
+	if (elf430Link(&e, &cpu)){
+		return 1;
+	}
+	if (!e.is_image){
+		fprintf(stderr, "no reset vector: need a firmware image\n");
+		return 1;
+	}
+
+	vmpuInit(&mpu);
+	g2231Init(&periph, &cpu, &mpu);
+	periph.pin_write = pinWrite;
+	cpu430Reset(&cpu);
+	next_sample = period;
+
+	while (delivered < max_samples || n_edges || mpu.int_line){
+		int n;
+
+		if (delivered == max_samples && cpu.cycles > next_sample + period){
+			break;		// the last sample never got through
+		}
+
+		if (delivered < max_samples && cpu.cycles >= next_sample){
+			if (t.n){
+				const trace_sample *s = &t.s[delivered];
+				vmpuSample(&mpu, s->x, s->y, s->z, MPU6050_TEMP_RAW(20), next_sample);
+			} else {
+				vmpuSample(&mpu, REST_X, 0, 0, MPU6050_TEMP_RAW(20), next_sample);
+			}
+			delivered++;
+			next_sample += period;
+		}
+		g2231Tick(&periph);
+		if (mpu.int_line && !int_prev){
+			if (n_edges){
+				incomplete++;	// new data before the last sample got through
+				n_edges = 0;
+			}
+			int_time = cpu.cycles;
+			int_pending = 1;
+		}
+		int_prev = mpu.int_line;
+
+		n = cpu430Step(&cpu);
+		if (n < 0){
+			fprintf(stderr, "illegal instruction 0x%04x at 0x%04x\n",
+					cpu430Read(&cpu, cpu.pc, 0), cpu.pc);
+			return 1;
+		}
+		if (!n){
+			// Asleep: skip to whatever happens next.
+			unsigned long long next = g2231NextEvent(&periph);
+
+			if (delivered < max_samples && (!next || next_sample < next)){
+				next = next_sample;
+			}
+			if (!next){
+				break;
+			}
+			if (next > cpu.cycles){
+				idle += next - cpu.cycles;
+				cpu.cycles = next;
+			}
+		}
+	}
+
+	printf("%ld samples at %d Hz, %ld read, %ld overwritten before being read, %ld incomplete\n",
+			delivered, rate_hz, stages[EDGES].n, mpu.overruns, incomplete);
+	printf("CPU awake %.2f%% of %llu cycles, %ld I2C bytes\n\n",
+			cpu.cycles ? 100.0 * (cpu.cycles - idle) / cpu.cycles : 0.0, cpu.cycles, periph.i2c_bytes);
+	printf("%-32s %9s %9s %9s\n", "stage (cycles = us at 1 MHz)", "min", "mean", "max");
+	for (i = 0; i <= EDGES; i++){
+		if (i == EDGES){
+			printf("\n");
+		}
+		printStat(stage_names[i], &stages[i]);
+	}
+
+	traceSetFree(&set);
+	elf430Free(&e);
+	return 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * logdump.c
+ *
+ *  Decodes the on-device ride log (libs/ridelog.c) from a raw dump of
+ *  information memory segments D-B into the trace format (trace.h), one
+ *  block of samples per committed window, oldest first.
+ *
+ *  The labels are all 0: the log records where the detector turned the
+ *  light on, not what the rider did. Label the windows by hand before
+ *  using them for tuning. Each window starts with a comment.
+ *
+ *  Dump with e.g.:
+ *    mspdebug rf2500 "save_raw 0x1000 192 ridelog.bin"
+ *
+ *  Build (from the repository root):
+ *    cc -O2 -Iauto_brake_light_2/libs -o logdump tools/logdump.c
+ *
+ *  Usage:
+ *    logdump ridelog.bin > rides.csv
+ */
+
+#include <ridelog.h>
+#include "trace.h"
+
+#include <stdio.h>
+
+#define DUMP_SIZE (RIDELOG_SEGS * RIDELOG_SEG_SIZE)
+
+static int getVarint(const unsigned char **pos, const unsigned char *end, int *d){
+	unsigned int v = 0;
+	int shift = 0;
+	unsigned char b;
+
+	do {
+		if (*pos >= end || shift > 14){
+			return -1;
+		}
+		b = *(*pos)++;
+		v |= (unsigned int)(b & 0x7F) << shift;
+		shift += 7;
+	} while (b & 0x80);
+
+	v &= 0xFFFF;
+	*d = (int)(v >> 1) ^ -(int)(v & 1);
+	return 0;
+}
+
+// Sign-extend a 16 bit device int.
+static int dev16(unsigned int v){
+	return (v & 0x8000) ? (int)v - 0x10000 : (int)v;
+}
+
+static void dumpRecord(const unsigned char *p, long window){
+	const unsigned char *q = p + RIDELOG_HEADER;
+	const unsigned char *end = p + p[0];
+	int x = dev16(p[1] | (p[2] << 8));
+	int y = dev16(p[3] | (p[4] << 8));
+	int z = dev16(p[5] | (p[6] << 8));
+
+	printf("# window %ld\n", window);
+	while (q < end){
+		int dx, dy, dz;
+
+		if (getVarint(&q, end, &dx) || getVarint(&q, end, &dy) || getVarint(&q, end, &dz)){
+			fprintf(stderr, "window %ld: truncated sample\n", window);
+			return;
+		}
+		x = dev16((x + dx) & 0xFFFF);
+		y = dev16((y + dy) & 0xFFFF);
+		z = dev16((z + dz) & 0xFFFF);
+		printf("%d,%d,%d,0\n", x, y, z);
+	}
+}
+
+/*
+ * dumpStream
+ * Walks the record stream through the segments in 'order' (oldest
+ * first), from the first record that starts in the oldest one. Records
+ * that carry on into the next segment are put back together. Erased
+ * bytes where a record should start: the rest of that segment was never
+ * written (a reset), go on at the next segment's first record. The same
+ * for a length that cannot be a record.
+ */
+static void dumpStream(const unsigned char *dump, const int *order, int n){
+	unsigned char rec[RIDELOG_SEG_DATA];
+	long windows = 0;
+	int k = 0;
+	int pos = dump[order[0] * RIDELOG_SEG_SIZE + 1];
+
+	while (k < n){
+		const unsigned char *seg = dump + order[k] * RIDELOG_SEG_SIZE;
+		int len, i;
+
+		if (pos >= RIDELOG_SEG_SIZE || seg[pos] == 0xFF){
+			if (++k < n){
+				pos = dump[order[k] * RIDELOG_SEG_SIZE + 1];
+			}
+			continue;
+		}
+		len = seg[pos];
+		if (len < RIDELOG_HEADER || len >= RIDELOG_SEG_DATA){
+			// Not a record; ridelogInit() leaves such a segment too.
+			fprintf(stderr, "segment %d: bad record length %d at offset %d\n", order[k], len, pos);
+			pos = RIDELOG_SEG_SIZE;
+			continue;
+		}
+		for (i = 0; i < len; i++){
+			if (pos == RIDELOG_SEG_SIZE){
+				if (++k == n){
+					fprintf(stderr, "segment %d: record cut short\n", order[k - 1]);
+					return;
+				}
+				seg = dump + order[k] * RIDELOG_SEG_SIZE;
+				pos = RIDELOG_SEG_HEADER;
+			}
+			rec[i] = seg[pos++];
+		}
+		dumpRecord(rec, windows++);
+	}
+}
+
+int main(int argc, char **argv){
+	unsigned char dump[DUMP_SIZE];
+	int order[RIDELOG_SEGS];
+	int newest = -1;
+	int i, n = 0;
+	FILE *f;
+
+	if (argc != 2){
+		fprintf(stderr, "usage: %s ridelog.bin\n", argv[0]);
+		return 2;
+	}
+	f = fopen(argv[1], "rb");
+	if (!f){
+		perror(argv[1]);
+		return 1;
+	}
+	if (fread(dump, 1, DUMP_SIZE, f) != DUMP_SIZE){
+		fprintf(stderr, "%s: expected %d bytes\n", argv[1], DUMP_SIZE);
+		fclose(f);
+		return 1;
+	}
+	fclose(f);
+
+	// Same rule as ridelogInit(): newest is the one whose successor is not seq + 1.
+	for (i = 0; i < RIDELOG_SEGS; i++){
+		unsigned char s = dump[i * RIDELOG_SEG_SIZE];
+		unsigned char next = dump[((i + 1) % RIDELOG_SEGS) * RIDELOG_SEG_SIZE];
+
+		if (s != 0xFF && next != (s == 254 ? 0 : s + 1)){
+			newest = i;
+			break;
+		}
+	}
+	if (newest < 0){
+		fprintf(stderr, "%s: no log found\n", argv[1]);
+		return 1;
+	}
+
+	for (i = 1; i <= RIDELOG_SEGS; i++){
+		int seg = (newest + i) % RIDELOG_SEGS;
+
+		if (dump[seg * RIDELOG_SEG_SIZE] != 0xFF){
+			order[n++] = seg;
+		}
+	}
+	printf("# rate_hz=%d\n", TRACE_DEFAULT_RATE);
+	dumpStream(dump, order, n);
+	return 0;
+}
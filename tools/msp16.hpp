@@ -0,0 +1,270 @@
+/*
+ * msp16.hpp
+ *
+ *  Checked MSP430 integer model for host builds of firmware code.
+ *
+ *  The MSP430 has a 16 bit int, and plain char is signed. Firmware code
+ *  that is also built on the host (detect.c, tempcomp.c) uses dev_int /
+ *  dev_uint from devint.h for its values. Built as C++ with MSP_CHECKED
+ *  defined, those become the classes below, which:
+ *
+ *  - compute every result the way the device does: wrap to 16 bits,
+ *    truncate division towards zero, shift right arithmetically, leave
+ *    abs(-32768) negative;
+ *  - count each hazard where the host and device would disagree, or
+ *    where the C standard gives no guarantee: signed overflow, division
+ *    by zero, negation/abs of -32768, left shift of a negative value,
+ *    constants that do not fit, narrowing to 8 bits, and sign extension
+ *    of a char with the top bit set;
+ *  - can stop at the first hazard (msp16::trap = true) so a debugger
+ *    shows exactly which line it was.
+ *
+ *  There is deliberately no implicit conversion back to a host int, so
+ *  no expression can quietly fall back to 32 bit arithmetic.
+ */
+
+#ifndef MSP16_HPP_
+#define MSP16_HPP_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <type_traits>
+
+namespace msp16 {
+
+enum hazard {
+	OVERFLOW,			// signed result outside -32768..32767, wrapped
+	DIV_ZERO,			// division or modulo by zero; device result is arbitrary
+	NEG_MIN,			// -(-32768) or abs(-32768), stays -32768
+	SHL_NEGATIVE,		// left shift of a negative value
+	SHIFT_RANGE,		// shift count outside 0..15
+	CONST_RANGE,		// host constant does not fit 16 bits
+	NARROW,				// value does not fit the 8 bit type it is stored in
+	SIGN_EXTEND,		// char with the top bit set promoted to int
+	N_HAZARDS
+};
+
+static const char *const hazard_names[N_HAZARDS] = {
+	"signed overflow", "division by zero", "negate/abs of -32768",
+	"left shift of negative", "shift count out of range",
+	"constant out of range", "narrowing to 8 bits", "char sign extension",
+};
+
+inline long counts[N_HAZARDS];
+inline bool trap = false;
+
+inline void flag(hazard h){
+	counts[h]++;
+	if (trap){
+		std::fprintf(stderr, "msp16: %s\n", hazard_names[h]);
+		std::abort();
+	}
+}
+
+inline void reset(){
+	for (long &c : counts){
+		c = 0;
+	}
+}
+
+inline void report(std::FILE *f){
+	for (int i = 0; i < N_HAZARDS; i++){
+		std::fprintf(f, "%-26s %ld\n", hazard_names[i], counts[i]);
+	}
+}
+
+// Wrap a host result to 16 bits, flagging if that changed it.
+inline int16_t wrap(long v){
+	int16_t w = (int16_t)(uint16_t)v;
+	if (w != v){
+		flag(OVERFLOW);
+	}
+	return w;
+}
+
+class u16;
+
+class i16 {
+public:
+	int16_t v;
+
+	i16() : v(0) {}
+	i16(int c) : v((int16_t)(uint16_t)c) {
+		if (c < INT16_MIN || c > INT16_MAX){
+			flag(CONST_RANGE);
+		}
+	}
+	explicit i16(const u16 &u);
+
+	template <class T, class = typename std::enable_if<std::is_integral<T>::value>::type>
+	explicit operator T() const {
+		if (sizeof(T) == 1 && (v < -128 || v > 255)){
+			flag(NARROW);
+		}
+		return (T)v;
+	}
+	explicit operator bool() const { return v != 0; }
+
+	friend i16 operator+(i16 a, i16 b){ return raw(wrap((long)a.v + b.v)); }
+	friend i16 operator-(i16 a, i16 b){ return raw(wrap((long)a.v - b.v)); }
+	friend i16 operator*(i16 a, i16 b){ return raw(wrap((long)a.v * b.v)); }
+	friend i16 operator/(i16 a, i16 b){
+		if (!b.v){
+			flag(DIV_ZERO);
+			return raw(0);
+		}
+		return raw(wrap((long)a.v / b.v));		// C truncates towards zero, as does the device
+	}
+	friend i16 operator%(i16 a, i16 b){
+		if (!b.v){
+			flag(DIV_ZERO);
+			return raw(0);
+		}
+		return raw(wrap((long)a.v % b.v));
+	}
+	friend i16 operator>>(i16 a, int n){
+		if (n < 0 || n > 15){
+			flag(SHIFT_RANGE);
+		}
+		return raw((int16_t)(a.v >> (n & 15)));	// RRA: arithmetic
+	}
+	friend i16 operator<<(i16 a, int n){
+		if (n < 0 || n > 15){
+			flag(SHIFT_RANGE);
+		}
+		if (a.v < 0){
+			flag(SHL_NEGATIVE);
+		}
+		return raw(wrap((long)a.v * (1L << (n & 15))));
+	}
+	friend i16 operator&(i16 a, i16 b){ return raw(a.v & b.v); }
+	friend i16 operator|(i16 a, i16 b){ return raw(a.v | b.v); }
+	friend i16 operator^(i16 a, i16 b){ return raw(a.v ^ b.v); }
+	i16 operator-() const {
+		if (v == INT16_MIN){
+			flag(NEG_MIN);
+		}
+		return raw((int16_t)(uint16_t)(-(long)v));
+	}
+	i16 operator~() const { return raw((int16_t)~v); }
+	bool operator!() const { return !v; }
+
+	friend bool operator==(i16 a, i16 b){ return a.v == b.v; }
+	friend bool operator!=(i16 a, i16 b){ return a.v != b.v; }
+	friend bool operator<(i16 a, i16 b){ return a.v < b.v; }
+	friend bool operator>(i16 a, i16 b){ return a.v > b.v; }
+	friend bool operator<=(i16 a, i16 b){ return a.v <= b.v; }
+	friend bool operator>=(i16 a, i16 b){ return a.v >= b.v; }
+
+	i16 &operator+=(i16 b){ return *this = *this + b; }
+	i16 &operator-=(i16 b){ return *this = *this - b; }
+	i16 &operator*=(i16 b){ return *this = *this * b; }
+	i16 &operator/=(i16 b){ return *this = *this / b; }
+	i16 &operator>>=(int n){ return *this = *this >> n; }
+	i16 &operator<<=(int n){ return *this = *this << n; }
+	i16 &operator++(){ return *this += 1; }
+	i16 &operator--(){ return *this -= 1; }
+	i16 operator++(int){ i16 t = *this; *this += 1; return t; }
+	i16 operator--(int){ i16 t = *this; *this -= 1; return t; }
+
+	static i16 raw(int16_t x){ i16 r; r.v = x; return r; }
+};
+
+// abs() from <stdlib.h> on a 16 bit int.
+inline i16 abs(i16 a){
+	if (a.v == INT16_MIN){
+		flag(NEG_MIN);
+		return a;
+	}
+	return i16::raw(a.v < 0 ? -a.v : a.v);
+}
+
+class u16 {
+public:
+	uint16_t v;
+
+	u16() : v(0) {}
+	u16(int c) : v((uint16_t)c) {
+		if (c < INT16_MIN || c > UINT16_MAX){
+			flag(CONST_RANGE);
+		}
+	}
+	explicit u16(const i16 &s) : v((uint16_t)s.v) {}
+
+	template <class T, class = typename std::enable_if<std::is_integral<T>::value>::type>
+	explicit operator T() const {
+		if (sizeof(T) == 1 && v > 255){
+			flag(NARROW);
+		}
+		return (T)v;
+	}
+	explicit operator bool() const { return v != 0; }
+
+	// Unsigned arithmetic wraps by definition; nothing to flag.
+	friend u16 operator+(u16 a, u16 b){ return raw(a.v + b.v); }
+	friend u16 operator-(u16 a, u16 b){ return raw(a.v - b.v); }
+	friend u16 operator*(u16 a, u16 b){ return raw(a.v * b.v); }
+	friend u16 operator/(u16 a, u16 b){
+		if (!b.v){
+			flag(DIV_ZERO);
+			return raw(0);
+		}
+		return raw(a.v / b.v);
+	}
+	friend u16 operator>>(u16 a, int n){
+		if (n < 0 || n > 15){
+			flag(SHIFT_RANGE);
+		}
+		return raw(a.v >> (n & 15));
+	}
+	friend u16 operator<<(u16 a, int n){
+		if (n < 0 || n > 15){
+			flag(SHIFT_RANGE);
+		}
+		return raw(a.v << (n & 15));
+	}
+	friend u16 operator&(u16 a, u16 b){ return raw(a.v & b.v); }
+	friend u16 operator|(u16 a, u16 b){ return raw(a.v | b.v); }
+	friend u16 operator^(u16 a, u16 b){ return raw(a.v ^ b.v); }
+
+	friend bool operator==(u16 a, u16 b){ return a.v == b.v; }
+	friend bool operator!=(u16 a, u16 b){ return a.v != b.v; }
+	friend bool operator<(u16 a, u16 b){ return a.v < b.v; }
+	friend bool operator>(u16 a, u16 b){ return a.v > b.v; }
+	friend bool operator<=(u16 a, u16 b){ return a.v <= b.v; }
+	friend bool operator>=(u16 a, u16 b){ return a.v >= b.v; }
+
+	u16 &operator+=(u16 b){ return *this = *this + b; }
+	u16 &operator-=(u16 b){ return *this = *this - b; }
+	u16 &operator>>=(int n){ return *this = *this >> n; }
+	u16 &operator<<=(int n){ return *this = *this << n; }
+
+	static u16 raw(unsigned x){ u16 r; r.v = (uint16_t)x; return r; }
+};
+
+inline i16::i16(const u16 &u) : v((int16_t)u.v) {}
+
+// Plain (signed) char. Promotion to int is where readAccel()-style
+// "lo + (hi << 8)" goes wrong, so that is what gets flagged.
+class i8 {
+public:
+	int8_t v;
+
+	i8() : v(0) {}
+	i8(int c) : v((int8_t)(uint8_t)c) {
+		if (c < -128 || c > 255){
+			flag(NARROW);
+		}
+	}
+	operator i16() const {
+		if (v < 0){
+			flag(SIGN_EXTEND);
+		}
+		return i16::raw(v);
+	}
+};
+
+} // namespace msp16
+
+#endif /* MSP16_HPP_ */
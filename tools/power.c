@@ -0,0 +1,159 @@
+/*
+ * power.c
+ *
+ *  Current model and charge integration. See power.h.
+ */
+
+#include "power.h"
+
+#include <mpu6050.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define P1OUT 0x21
+#define P1DIR 0x22
+#define ADC10CTL0 0x1B0
+#define LED_PINS 0x18			// LED2 P1.4, LED4 P1.3, active high
+#define SR_OSCOFF 0x0020
+#define SR_SCG1 0x0080
+
+const char *const power_keys[POWER_KEYS] = {
+	"active_1mhz", "active_8mhz", "active_12mhz", "active_16mhz",
+	"lpm0", "lpm3", "lpm4",
+	"mpu_sleep", "mpu_wake0", "mpu_wake1", "mpu_wake2", "mpu_wake3",
+	"mpu_accel", "mpu_full",
+	"led", "adc", "ref", "i2c"
+};
+
+const char *const power_parts[POWER_PARTS] = {
+	"CPU active", "CPU LPM0", "CPU LPM3/4", "sensor", "LEDs", "ADC10 + ref", "I2C pull-ups"
+};
+
+// MSP430G2231 (SLAS694) and MPU-6050 (PS-MPU-6000A) typicals at 3 V.
+// mpu_wake0..3 are the datasheet's 1.25, 5, 20 and 40 Hz figures.
+static const double defaults[POWER_KEYS] = {
+	300, 2200, 3100, 4200,
+	56, 0.6, 0.1,
+	5, 10, 20, 70, 140,
+	500, 3900,
+	10000, 600, 250, 300
+};
+
+void powerDefaults(power_profile *p){
+	memcpy(p->ua, defaults, sizeof(defaults));
+	p->mhz = 1;
+}
+
+int powerParse(power_profile *p, const char *spec){
+	char buf[512], *tok, *save;
+	int k;
+
+	if (strlen(spec) >= sizeof(buf)){
+		fprintf(stderr, "power profile too long\n");
+		return -1;
+	}
+	strcpy(buf, spec);
+
+	for (tok = strtok_r(buf, " \t\n,", &save); tok; tok = strtok_r(NULL, " \t\n,", &save)){
+		char *val = strchr(tok, '=');
+		char *end;
+		double v;
+
+		if (!val){
+			fprintf(stderr, "power setting '%s': expected key=value\n", tok);
+			return -1;
+		}
+		*val++ = 0;
+		for (k = 0; k < POWER_KEYS && strcmp(tok, power_keys[k]); k++);
+		if (k == POWER_KEYS){
+			fprintf(stderr, "unknown power key '%s'\n", tok);
+			return -1;
+		}
+		v = strtod(val, &end);
+		if (*end || end == val || v < 0){
+			fprintf(stderr, "power setting '%s': bad value '%s'\n", tok, val);
+			return -1;
+		}
+		p->ua[k] = v;
+	}
+	return 0;
+}
+
+void powerState(const g2231 *g, power_state *s){
+	const unsigned char *mem = g->cpu->mem;
+	const unsigned char *reg = g->mpu->reg;
+	unsigned int sr = g->cpu->r[2];
+	unsigned char leds = mem[P1OUT] & mem[P1DIR] & LED_PINS;
+
+	if (!(sr & CPU430_CPUOFF)){
+		s->cpu = POWER_ACTIVE_1MHZ;
+	} else if (sr & SR_OSCOFF){
+		s->cpu = POWER_LPM4;
+	} else if (sr & SR_SCG1){
+		s->cpu = POWER_LPM3;
+	} else {
+		s->cpu = POWER_LPM0;
+	}
+
+	if (reg[MPU6050_PWR_MGMT_1] & MPU6050_SLEEP){
+		s->sensor = POWER_MPU_SLEEP;
+	} else if (reg[MPU6050_PWR_MGMT_1] & MPU6050_CYCLE){
+		s->sensor = POWER_MPU_WAKE0 + ((reg[MPU6050_PWR_MGMT_2] >> 6) & 3);
+	} else if ((reg[MPU6050_PWR_MGMT_2] & (MPU6050_STBY_XG | MPU6050_STBY_YG | MPU6050_STBY_ZG))
+			== (MPU6050_STBY_XG | MPU6050_STBY_YG | MPU6050_STBY_ZG)){
+		s->sensor = POWER_MPU_ACCEL;
+	} else {
+		s->sensor = POWER_MPU_FULL;
+	}
+
+	s->leds = !!(leds & 0x08) + !!(leds & 0x10);
+	s->adc = !!(mem[ADC10CTL0] & 0x10);
+	s->ref = !!(mem[ADC10CTL0] & 0x20);
+	s->i2c = g->usi_done != 0;
+}
+
+/*
+ * powerAdd
+ * Awake time is charged at the -m DCO setting's current for 1/mhz of
+ * the time, as if everything the CPU does ran that much faster, and the
+ * CPU spends the rest in LPM3.
+ */
+void powerAdd(power_meter *m, const power_profile *p, const power_state *s, int braking, double dt){
+	static const int active[17] = { [1] = POWER_ACTIVE_1MHZ, [8] = POWER_ACTIVE_8MHZ,
+			[12] = POWER_ACTIVE_12MHZ, [16] = POWER_ACTIVE_16MHZ };
+	double *q = m->charge[!!braking];
+
+	if (s->cpu == POWER_ACTIVE_1MHZ){
+		q[PART_CPU_ACTIVE] += p->ua[active[p->mhz]] * dt / p->mhz;
+		q[PART_CPU_LPM3] += p->ua[POWER_LPM3] * (dt - dt / p->mhz);
+	} else if (s->cpu == POWER_LPM0){
+		q[PART_CPU_LPM0] += p->ua[POWER_LPM0] * dt;
+	} else {
+		q[PART_CPU_LPM3] += p->ua[s->cpu] * dt;
+	}
+	q[PART_SENSOR] += p->ua[s->sensor] * dt;
+	q[PART_LEDS] += p->ua[POWER_LED] * s->leds * dt;
+	q[PART_ADC] += (p->ua[POWER_ADC] * s->adc + p->ua[POWER_REF] * s->ref) * dt;
+	q[PART_I2C] += p->ua[POWER_I2C] * s->i2c * dt;
+	m->time[!!braking] += dt;
+}
+
+double powerMean(const power_meter *m, int part, int braking){
+	double q = 0, t = 0;
+	int b, i;
+
+	for (b = 0; b < 2; b++){
+		if (braking >= 0 && b != braking){
+			continue;
+		}
+		for (i = 0; i < POWER_PARTS; i++){
+			if (part < 0 || part == i){
+				q += m->charge[b][i];
+			}
+		}
+		t += m->time[b];
+	}
+	return t ? q / t : 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * power.h
+ *
+ *  Current model of the light for the simulator tools: what each part
+ *  draws in each state, and charge integration over a simulated run
+ *  (g2231.c, vmpu.c).
+ *
+ *  A profile is a list of "key=value" settings in microamps over the
+ *  defaults (datasheet typicals at 3 V, LED current for the PCB's LED
+ *  drive), e.g.
+ *
+ *      led=15000 mpu_wake2=70
+ *
+ *  Keys:
+ *    active_1mhz .. active_16mhz  CPU awake, per DCO setting
+ *    lpm0 lpm3 lpm4               CPU asleep (LPM1 counts as LPM0, LPM2
+ *                                 as LPM3); clocks and the WDT included
+ *    mpu_sleep                    PWR_MGMT_1 SLEEP
+ *    mpu_wake0 .. mpu_wake3       cycle mode, per LP_WAKE_CTRL
+ *    mpu_accel mpu_full           awake, gyros in standby / all on
+ *    led                          one LED, on
+ *    adc ref                      ADC10ON, REFON
+ *    i2c                          pull-ups while a byte is on the bus
+ *
+ *  The state comes from the simulation: SR for the CPU, the sensor's
+ *  PWR_MGMT registers, the LED pins (so PWM duty comes out of the run),
+ *  ADC10CTL0, and the USI.
+ */
+
+#ifndef POWER_H_
+#define POWER_H_
+
+#include "g2231.h"
+
+enum power_key{
+	POWER_ACTIVE_1MHZ, POWER_ACTIVE_8MHZ, POWER_ACTIVE_12MHZ, POWER_ACTIVE_16MHZ,
+	POWER_LPM0, POWER_LPM3, POWER_LPM4,
+	POWER_MPU_SLEEP, POWER_MPU_WAKE0, POWER_MPU_WAKE1, POWER_MPU_WAKE2, POWER_MPU_WAKE3,
+	POWER_MPU_ACCEL, POWER_MPU_FULL,
+	POWER_LED, POWER_ADC, POWER_REF, POWER_I2C,
+	POWER_KEYS
+};
+
+// Where the charge goes, for the report.
+enum power_part{
+	PART_CPU_ACTIVE,
+	PART_CPU_LPM0,
+	PART_CPU_LPM3,		// and LPM4
+	PART_SENSOR,
+	PART_LEDS,
+	PART_ADC,			// ADC10 and reference
+	PART_I2C,
+	POWER_PARTS
+};
+
+typedef struct power_profile_struct{
+	double ua[POWER_KEYS];
+	int mhz;			// DCO setting the awake time is charged at: 1, 8, 12 or 16
+} power_profile;
+
+// One instant, as the parts see it.
+typedef struct power_state_struct{
+	int cpu;			// POWER_ACTIVE_1MHZ or POWER_LPM0/3/4
+	int sensor;			// POWER_MPU_*
+	int leds;			// LEDs on
+	int adc, ref, i2c;
+} power_state;
+
+typedef struct power_meter_struct{
+	double charge[2][POWER_PARTS];	// uA * us, cruising [0] / braking [1]
+	double time[2];					// us
+} power_meter;
+
+extern const char *const power_keys[POWER_KEYS];
+extern const char *const power_parts[POWER_PARTS];
+
+// Defaults, then the settings. Returns 0, or -1 with a message on stderr.
+void powerDefaults(power_profile *p);
+int powerParse(power_profile *p, const char *spec);
+
+void powerState(const g2231 *g, power_state *s);
+// dt cycles (1 MHz) spent in state s, while the rider is braking or not.
+void powerAdd(power_meter *m, const power_profile *p, const power_state *s, int braking, double dt);
+// Mean current (uA) of part, or of everything with part -1, over both or one of the labels (-1: both).
+double powerMean(const power_meter *m, int part, int braking);
+
+#endif /* POWER_H_ */
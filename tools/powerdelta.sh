@@ -0,0 +1,61 @@
+#!/bin/sh
+#
+# powerdelta.sh
+#
+# Predicted battery life of the firmware with each power feature
+# switched, against the default build: builds auto_brake_light_2 with
+# msp430-elf-gcc once as is and once per feature flag below, runs each
+# image through tools/battlife on the same trace, and prints the hours
+# and the difference. A power change should come with this table.
+#
+# Needs msp430-elf-gcc (TI's GCC build, with its device headers and
+# linker scripts on the default search path).
+#
+# Usage (from the repository root):
+#   tools/powerdelta.sh [-t trace.csv] [battlife options...] [-- extra CFLAGS...]
+#
+# The default build is STANDARD, so the flags below switch each stage
+# on. FEATURES overrides them, e.g.
+#   FEATURES="BATTERY=1 BRIGHT_MIN=100" tools/powerdelta.sh -t ride.csv
+#
+# battlife feeds one trace sample per sensor sample. FIFO_BATCH makes
+# one decision per DECIM_RATE samples, so its row only compares with a
+# trace at DECIM_RATE times the rate (each sample repeated will do):
+#   FEATURES=FIFO_BATCH=1 tools/powerdelta.sh -t ride-40hz.csv
+# and the default row of that run is not meaningful.
+
+set -e
+
+CC=${CC430:-msp430-elf-gcc}
+MCU=${MCU:-msp430g2231}
+FW=auto_brake_light_2
+LIBS=$FW/libs
+FEATURES=${FEATURES:-"BATTERY=1 BRIGHTNESS=1 TEMP_COMP=1 CORNER_REJECT=1 NOISE_ADAPT=1 RIDELOG=1 TELEMETRY=1 FIFO_BATCH=1"}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+opts=
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+	opts="$opts $1"
+	shift
+done
+[ "$1" = "--" ] && shift
+
+cc -O2 -I"$LIBS" -o "$TMP/battlife" tools/battlife.c tools/power.c \
+	tools/cpu430.c tools/elf430.c tools/g2231.c tools/vmpu.c \
+	tools/fault.c tools/trace.c
+
+build() {
+	"$CC" -mmcu="$MCU" -Os -I"$LIBS" "$@" -o "$TMP/fw.elf" "$FW/main.c" "$LIBS"/*.c
+}
+
+build "$@"
+base=$("$TMP/battlife" -q $opts "$TMP/fw.elf")
+printf '%-24s %9s %9s\n' build hours delta
+printf '%-24s %9s %9s\n' default "$base" -
+
+for f in $FEATURES; do
+	build "$@" -D"$f"
+	h=$("$TMP/battlife" -q $opts "$TMP/fw.elf")
+	awk -v f="$f" -v h="$h" -v b="$base" 'BEGIN { printf "%-24s %9s %+9.1f\n", f, h, h - b }'
+done
@@ -0,0 +1,94 @@
+/*
+ * replay.c
+ *
+ *  Replay benchmark: runs recorded ride traces through the firmware
+ *  detection code and reports onset latency and false triggers.
+ *
+ *  Build (from the repository root):
+ *    cc -O2 -DDETECT_TUNABLE -Iauto_brake_light_2/libs -o replay \
+ *        tools/replay.c tools/score.c tools/trace.c \
+ *        auto_brake_light_2/libs/detect.c auto_brake_light_2/libs/tempcomp.c
+ *
+ *  Usage:
+ *    replay [-p pitch_interval] [-w warmup] trace.csv|corpus.trb...
+ */
+
+#include <detect.h>
+#include "score.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void printScore(const char *name, const score *s, int rate_hz, double secs){
+	double mean = s->detected ? (double)s->latency_sum / s->detected : 0.0;
+
+	printf("%-10s %7ld %7ld %9.2f %9.1f %9ld %9ld %12.0f\n",
+			name, s->events, s->detected, mean, mean * 1000.0 / rate_hz,
+			s->latency_max, s->false_triggers, s->samples / secs);
+}
+
+int main(int argc, char **argv){
+	replay_opts o = { PITCH_INTERVAL, 0 };
+	detect_state defaults;
+	score base;
+	int rate_hz = 0;
+	double t_base = 0;
+	trace_set set = { NULL, 0, NULL, 0 };
+	int c, i;
+
+	while ((c = getopt(argc, argv, "p:w:")) != -1){
+		switch (c){
+		case 'p':
+			o.pitch_interval = atoi(optarg);
+			break;
+		case 'w':
+			o.warmup = atol(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-p pitch_interval] [-w warmup] trace.csv...\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind >= argc){
+		fprintf(stderr, "usage: %s [-p pitch_interval] [-w warmup] trace.csv...\n", argv[0]);
+		return 2;
+	}
+
+	detectInit(&defaults);
+	scoreInit(&base);
+
+	for (; optind < argc; optind++){
+		if (traceSetAdd(&set, argv[optind])){
+			tracePerror(argv[optind]);
+			return 1;
+		}
+	}
+	for (i = 0; i < set.n; i++){
+		detect_param p = defaults.param;
+		const trace *t = &set.t[i];
+		double t0;
+
+		if (!rate_hz){
+			rate_hz = t->rate_hz;
+		}
+
+		t0 = now();
+		scoreTrace(t, &p, &o, &base);
+		t_base += now() - t0;
+	}
+	traceSetFree(&set);
+
+	printf("%-10s %7s %7s %9s %9s %9s %9s %12s\n",
+			"detector", "events", "hit", "lat_mean", "lat_ms", "lat_max", "false", "samples/s");
+	printScore("level", &base, rate_hz, t_base);
+	return 0;
+}
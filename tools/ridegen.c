@@ -0,0 +1,636 @@
+/*
+ * ridegen.c
+ *
+ *  Synthetic ride traces from a model of the bike, for corpora far
+ *  larger than the recorded rides and for the corner cases they lack.
+ *
+ *  Each ride is simulated at -i Hz (default 2000):
+ *  - longitudinal: rider power up to a cruising speed (with the pedal
+ *    stroke ripple), rolling resistance, drag, the grade, and braking
+ *    events with an onset ramp, a hold and a release: gentle, normal,
+ *    hard, and sudden stops; also braking to hold the speed limit on
+ *    descents and before corners. The brake label is 1 from the lever
+ *    being pulled until it is let go.
+ *  - grade: segments of random length and grade, blended over ~20 m.
+ *  - road: an ISO 8608 profile for the surface (class A to C, as a
+ *    first order shaping filter in distance, so its spectrum follows the
+ *    speed), through the tyre/frame resonance to the frame; cobbles add
+ *    an impact per stone, and potholes a short hit.
+ *  - corners: lateral force the rider's lean does not cancel.
+ *  - sensor: mounting pitch and roll, zero-g offsets, the DLPF (first
+ *    order at -b Hz), noise density, a single snapshot per sample (as in
+ *    cycle mode, so vibration above the sample rate aliases into the
+ *    samples), quantisation and clipping at the -a AFS_SEL range.
+ *
+ *  Rides are independent and spread over -j threads. Ride k is seeded
+ *  from the -s seed and k alone, so the output does not depend on the
+ *  thread count. With -o the rides go to <dir>/ride-NNNNN.csv, otherwise
+ *  to stdout one after the other (in order), as one trace.
+ *
+ *  -k picks the scenario; rare cases on their own make regression sets:
+ *    mixed    everything, at realistic rates (default)
+ *    descent  long 6-15% descents, speed held with the brakes
+ *    cobbles  cobbled surface throughout
+ *    mount    mounting angles up to 30 degrees pitch, 20 roll
+ *    stop     short cruises ending in hard or sudden stops
+ *  Several can be combined: -k descent,mount.
+ *
+ *  Build (from the repository root):
+ *    cc -O2 -pthread -Iauto_brake_light_2/libs -o ridegen tools/ridegen.c -lm
+ *
+ *  Usage:
+ *    ridegen [-n rides] [-d seconds] [-s seed] [-k kinds] [-a afs_sel]
+ *            [-r rate_hz] [-b dlpf_hz] [-i sim_hz] [-j threads] [-o dir]
+ */
+
+#include "trace.h"
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define G 9.81
+#define MASS 90.0				// bike and rider, kg
+#define POWER_MAX 250.0			// W
+#define CRR 0.006
+#define DRAG (0.5 * 1.2 * 0.5 / MASS)	// rho * CdA / 2m
+#define SPEED_MAX 12.0			// m/s the rider lets a descent run to
+#define LEAN_RESIDUAL 0.2		// share of the cornering force the lean leaves
+#define FRAME_HZ 15.0			// tyre/frame resonance
+#define FRAME_DAMPING 0.3		// mostly the rider
+#define NOISE_DENSITY 400e-6	// g/sqrt(Hz)
+#define COBBLE_SPACING 0.13		// m
+#define POTHOLES_PER_KM 0.5
+
+#define KIND_DESCENT 1
+#define KIND_COBBLES 2
+#define KIND_MOUNT 4
+#define KIND_STOP 8
+
+enum surface_id{ SMOOTH, ASPHALT, ROUGH, GRAVEL, COBBLES, SURFACES };
+
+// ISO 8608 displacement PSD at 0.1 cycles/m, m^3: lower A, A, B, C, C
+// (cobbles also get their stones, below).
+static const double road_gd[SURFACES] = { 4e-6, 16e-6, 64e-6, 256e-6, 256e-6 };
+static const double surface_mix[SURFACES] = { 0.2, 0.5, 0.15, 0.1, 0.05 };
+
+enum phase_id{ CRUISE, BRAKE, STOP };
+
+typedef struct opts_struct{
+	long rides;
+	double seconds;
+	unsigned long long seed;
+	int kinds;
+	int afs;
+	int rate_hz;
+	double dlpf_hz;
+	int sim_hz;
+	const char *dir;
+} opts;
+
+typedef struct buf_struct{
+	char *p;
+	size_t len, cap;
+} buf;
+
+// One ride in progress.
+typedef struct ride_struct{
+	unsigned long long rng;
+	double spare;				// gauss()
+	int has_spare;
+	double t, dt;
+	double dlpf;				// DLPF coefficient per step
+
+	int phase;
+	double v, v_cruise, x;
+	double next_event;			// CRUISE: time of the next planned braking
+	double a_peak, t_on, t_rel, v_end;	// BRAKE
+	double brake_t, release_at, a_brake;
+	double stop_until;
+
+	double grade, grade_target, grade_end;
+	int surface;
+	double surface_end;
+	double curve, curve_end;
+	double pothole_x, pothole_t;
+
+	double road, road_v;		// profile height, and its rate
+	double body, body_v;		// frame height, and its rate
+	double acc_up, acc_lat, acc_fwd;	// after the DLPF, g
+	double pitch, roll;			// mounting, rad
+	double off[3];				// zero-g offsets, g
+
+	long events;
+	long braking;				// samples labelled 1
+} ride;
+
+static opts o;
+static int n_workers;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static long next_ride, written;
+static buf *done;				// stdout: finished rides waiting their turn
+static long total_samples, total_events, total_braking;
+static int failed;
+
+static double uniform(ride *r){
+	r->rng ^= r->rng << 13;
+	r->rng ^= r->rng >> 7;
+	r->rng ^= r->rng << 17;
+	return (r->rng >> 11) * (1.0 / 9007199254740992.0);		// 53 bits
+}
+
+static double range(ride *r, double lo, double hi){
+	return lo + (hi - lo) * uniform(r);
+}
+
+// Box-Muller, both halves.
+static double gauss(ride *r){
+	double u, m;
+
+	if (r->has_spare){
+		r->has_spare = 0;
+		return r->spare;
+	}
+	u = uniform(r);
+	m = sqrt(-2 * log(u > 0 ? u : 1e-300));
+	u = 2 * M_PI * uniform(r);
+	r->spare = m * sin(u);
+	r->has_spare = 1;
+	return m * cos(u);
+}
+
+// splitmix64 of the seed and the ride number: the ride's own sequence.
+static unsigned long long seedFor(unsigned long long seed, long k){
+	unsigned long long z = seed + 0x9E3779B97F4A7C15ULL * (unsigned long long)(k + 1);
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	z ^= z >> 31;
+	return z ? z : 1;		// xorshift must not start at 0
+}
+
+static void put(buf *b, const char *fmt, ...){
+	va_list ap;
+	int n;
+
+	for (;;){
+		va_start(ap, fmt);
+		n = vsnprintf(b->p + b->len, b->cap - b->len, fmt, ap);
+		va_end(ap);
+		if (n >= 0 && b->len + n < b->cap){
+			b->len += n;
+			return;
+		}
+		b->cap = b->cap ? 2 * b->cap : 65536;
+		b->p = realloc(b->p, b->cap);
+		if (!b->p){
+			perror("ridegen");
+			exit(1);
+		}
+	}
+}
+
+/*
+ * startBrake
+ * Peak deceleration (m/s^2), onset time, and the speed the rider
+ * brakes down to (0: to a stop). On a descent the rider squeezes harder
+ * by what the grade takes back.
+ */
+static void startBrake(ride *r, double a_peak, double t_on, double v_end){
+	r->phase = BRAKE;
+	r->a_peak = a_peak + fmax(0, -G * sin(atan(r->grade)));
+	r->t_on = t_on;
+	r->t_rel = range(r, 0.2, 0.5);
+	r->v_end = v_end;
+	r->brake_t = 0;
+	r->release_at = 0;
+	r->events++;
+}
+
+// A planned braking event, of the kind the scenario calls for.
+static void plannedBrake(ride *r){
+	double p = uniform(r);
+
+	if (o.kinds & KIND_STOP){
+		p = p < 0.6 ? 0.95 : 0.7;		// hard or normal, always to a stop
+	}
+	if (p < 0.45){
+		startBrake(r, range(r, 0.8, 2.0), range(r, 0.4, 0.8), r->v * range(r, 0.5, 0.8));
+	} else if (p < 0.85){
+		startBrake(r, range(r, 2.0, 4.0), range(r, 0.3, 0.5),
+				(o.kinds & KIND_STOP) || uniform(r) < 0.5 ? 0 : r->v * 0.3);
+	} else {
+		startBrake(r, range(r, 5.0, 7.0), range(r, 0.1, 0.25), 0);
+	}
+}
+
+static void cruise(ride *r){
+	r->phase = CRUISE;
+	r->next_event = r->t + -log(1 - uniform(r)) * ((o.kinds & KIND_STOP) ? 8.0 : 40.0);
+}
+
+/*
+ * roadAhead
+ * New grade, surface and corner segments as the bike reaches the end of
+ * the current ones.
+ */
+static void roadAhead(ride *r){
+	if (r->x >= r->grade_end){
+		double g;
+
+		if (o.kinds & KIND_DESCENT){
+			g = uniform(r) < 0.8 ? -range(r, 0.06, 0.15) : range(r, -0.02, 0.03);
+		} else if (uniform(r) < 0.1){
+			g = range(r, 0.08, 0.12) * (uniform(r) < 0.5 ? -1 : 1);
+		} else {
+			g = range(r, -0.04, 0.04);
+		}
+		r->grade_target = g;
+		r->grade_end = r->x + range(r, 100, 800);
+	}
+	if (r->x >= r->surface_end){
+		double p = uniform(r);
+
+		r->surface = 0;
+		while (r->surface < SURFACES - 1 && p >= surface_mix[r->surface]){
+			p -= surface_mix[r->surface++];
+		}
+		if (o.kinds & KIND_COBBLES){
+			r->surface = COBBLES;
+		}
+		r->surface_end = r->x + range(r, 200, 2000);
+	}
+	if (r->x >= r->curve_end){
+		if (r->curve == 0 && uniform(r) < 0.3){
+			double radius = range(r, 8, 40);
+
+			r->curve = (uniform(r) < 0.5 ? -1 : 1) / radius;
+			r->curve_end = r->x + radius * range(r, 0.5, 1.6);		// 30 to 90 degrees
+		} else {
+			r->curve = 0;
+			r->curve_end = r->x + range(r, 50, 500);
+		}
+	}
+	if (r->x >= r->pothole_x){
+		r->pothole_t = r->t;
+		r->pothole_x = r->x - log(1 - uniform(r)) * 1000 / POTHOLES_PER_KM;
+	}
+}
+
+/*
+ * longitudinal
+ * Rider and brakes for one step. Returns the acceleration along the
+ * road, m/s^2.
+ */
+static double longitudinal(ride *r){
+	double theta = atan(r->grade);
+	double resist = G * sin(theta) + CRR * G * cos(theta) * (r->v > 0) + DRAG * r->v * r->v;
+	double limit = SPEED_MAX, a = 0;
+
+	if (r->curve){
+		limit = fmin(limit, sqrt(0.3 * G / fabs(r->curve)));
+	}
+
+	switch (r->phase){
+	case CRUISE:
+		if (r->v > limit + 1){
+			startBrake(r, range(r, 1.0, 2.5), 0.5, limit - 1);
+			return longitudinal(r);
+		}
+		if (r->t >= r->next_event && r->v > 2){
+			plannedBrake(r);
+			return longitudinal(r);
+		}
+		if (r->v < fmin(r->v_cruise, limit)){
+			double pedal = fmin(0.5 * (fmin(r->v_cruise, limit) - r->v) + resist,
+					POWER_MAX / (MASS * fmax(r->v, 1.5)));
+
+			if (pedal > 0){
+				a = pedal * (1 + 0.5 * sin(2 * M_PI * 3.0 * r->t));	// two strokes per crank turn
+			}
+		}
+		break;
+	case BRAKE:
+		r->brake_t += r->dt;
+		if (!r->release_at && (r->v <= r->v_end || r->v <= 0)){
+			r->release_at = r->brake_t;
+		}
+		if (r->release_at){
+			double k = 1 - (r->brake_t - r->release_at) / r->t_rel;
+
+			r->a_brake = k > 0 ? fmin(r->a_brake, r->a_peak * k) : 0;
+			if (k <= 0){
+				if (r->v <= 0.05){
+					r->phase = STOP;
+					r->stop_until = r->t + range(r, 2, 30);
+				} else {
+					cruise(r);
+				}
+			}
+		} else {
+			r->a_brake = r->a_peak * fmin(1, r->brake_t / r->t_on);
+		}
+		a = r->v > 0 ? -r->a_brake : 0;
+		break;
+	case STOP:
+		if (r->t >= r->stop_until){
+			r->v_cruise = range(r, 5, 9);
+			cruise(r);
+		}
+		return 0;
+	}
+	if (r->v <= 0 && a - resist <= 0){
+		return 0;		// standing: the brakes or the ground hold it
+	}
+	return a - resist;
+}
+
+/*
+ * step
+ * Advances the ride by dt and the sensor's DLPF with it.
+ */
+static void step(ride *r){
+	double dt = r->dt;
+	double a_long = longitudinal(r);
+	double theta = atan(r->grade);
+	double w = 2 * M_PI * FRAME_HZ;
+	double n0 = 0.1, nc = 0.011;
+	double body_a, vib, f_up, f_lat, f_fwd;
+
+	roadAhead(r);
+	r->grade += fmax(-r->v * dt / 20, fmin(r->v * dt / 20, r->grade_target - r->grade));
+
+	// Road profile under the wheel, then the frame on the tyre.
+	r->road_v = -2 * M_PI * nc * r->v * r->road
+			+ 2 * M_PI * n0 * sqrt(road_gd[r->surface] * r->v) * gauss(r) / sqrt(dt);
+	r->road += r->road_v * dt;
+	body_a = -2 * FRAME_DAMPING * w * r->body_v - w * w * (r->body - r->road);
+	r->body_v += body_a * dt;
+	r->body += r->body_v * dt;
+	vib = body_a / G;
+	if (r->surface == COBBLES && r->v > 0){
+		vib += 1.5 * (r->v / 8) * (fabs(sin(M_PI * r->x / COBBLE_SPACING)) - 2 / M_PI);
+	}
+	if (r->t - r->pothole_t < 0.03 && r->v > 1){
+		vib += 3.0 * sin(M_PI * (r->t - r->pothole_t) / 0.03);
+		a_long -= 0.8 * G * sin(M_PI * (r->t - r->pothole_t) / 0.03);
+	}
+
+	// Specific force in the bike's frame, g: up, lateral, forward.
+	f_up = hypot(cos(theta), (1 - LEAN_RESIDUAL) * r->v * r->v * r->curve / G) + vib;
+	f_lat = LEAN_RESIDUAL * r->v * r->v * r->curve / G + 0.15 * vib;
+	f_fwd = a_long / G + sin(theta) + 0.3 * vib;
+
+	r->acc_up += (f_up - r->acc_up) * r->dlpf;
+	r->acc_lat += (f_lat - r->acc_lat) * r->dlpf;
+	r->acc_fwd += (f_fwd - r->acc_fwd) * r->dlpf;
+
+	r->v = fmax(0, r->v + a_long * dt);
+	r->x += r->v * dt;
+	r->t += dt;
+}
+
+static int quantise(ride *r, double g_val, double off, double noise){
+	double lsb = 16384 >> o.afs;
+	double c = floor((g_val + off + noise * gauss(r)) * lsb + 0.5);
+
+	return c > 32767 ? 32767 : c < -32768 ? -32768 : (int)c;
+}
+
+/*
+ * generate
+ * One ride into b. Returns the number of samples.
+ */
+static long generate(long k, buf *b){
+	ride r;
+	long n = (long)(o.seconds * o.rate_hz), i, j;
+	int per = o.sim_hz / o.rate_hz;
+	double mount = (o.kinds & KIND_MOUNT) ? 1 : 1.0 / 3;
+	double noise = NOISE_DENSITY * sqrt(o.dlpf_hz * M_PI / 2);
+
+	memset(&r, 0, sizeof(r));
+	r.rng = seedFor(o.seed, k);
+	r.dt = 1.0 / o.sim_hz;
+	r.dlpf = 1 - exp(-2 * M_PI * o.dlpf_hz * r.dt);
+	r.pitch = range(&r, -30, 30) * mount * M_PI / 180;
+	r.roll = range(&r, -20, 20) * mount * M_PI / 180;
+	r.off[0] = range(&r, -0.05, 0.05);
+	r.off[1] = range(&r, -0.05, 0.05);
+	r.off[2] = range(&r, -0.08, 0.08);
+	r.pothole_x = -log(1 - uniform(&r)) * 1000 / POTHOLES_PER_KM;
+	r.phase = STOP;
+	r.stop_until = range(&r, 1, 5);
+	r.acc_up = 1;
+
+	put(b, "# ridegen seed=%llu ride=%ld kinds=%d afs=%d pitch=%.1f roll=%.1f\n",
+			o.seed, k, o.kinds, o.afs, r.pitch * 180 / M_PI, r.roll * 180 / M_PI);
+	for (i = 0; i < n; i++){
+		double up, fwd, x, y;
+
+		for (j = 0; j < per; j++){
+			step(&r);
+		}
+		// Mounting: pitch about the lateral axis, then roll about forward.
+		up = r.acc_up * cos(r.pitch) - r.acc_fwd * sin(r.pitch);
+		fwd = r.acc_up * sin(r.pitch) + r.acc_fwd * cos(r.pitch);
+		x = up * cos(r.roll) - r.acc_lat * sin(r.roll);
+		y = up * sin(r.roll) + r.acc_lat * cos(r.roll);
+		put(b, "%d,%d,%d,%d\n", quantise(&r, x, r.off[0], noise), quantise(&r, y, r.off[1], noise),
+				quantise(&r, fwd, r.off[2], noise), r.phase == BRAKE);
+		r.braking += r.phase == BRAKE;
+	}
+
+	pthread_mutex_lock(&lock);
+	total_samples += n;
+	total_events += r.events;
+	total_braking += r.braking;
+	pthread_mutex_unlock(&lock);
+	return n;
+}
+
+static int writeRide(long k, const buf *b){
+	char path[4096];
+	FILE *f;
+
+	snprintf(path, sizeof(path), "%s/ride-%05ld.csv", o.dir, k);
+	f = fopen(path, "w");
+	if (!f){
+		perror(path);
+		return -1;
+	}
+	fprintf(f, "# rate_hz=%d\n", o.rate_hz);
+	fwrite(b->p, 1, b->len, f);
+	if (fclose(f)){
+		perror(path);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * worker
+ * Takes the next ride, generates it, and writes it (-o) or hands it to
+ * main() for stdout. Rides more than two per thread ahead of stdout
+ * wait, so memory stays bounded however many rides there are.
+ */
+static void *worker(void *arg){
+	buf b = { NULL, 0, 0 };
+
+	(void)arg;
+	for (;;){
+		long k;
+
+		pthread_mutex_lock(&lock);
+		while (!o.dir && next_ride < o.rides && next_ride >= written + 2 * n_workers && !failed){
+			pthread_cond_wait(&cond, &lock);
+		}
+		k = next_ride < o.rides && !failed ? next_ride++ : -1;
+		pthread_mutex_unlock(&lock);
+		if (k < 0){
+			break;
+		}
+
+		b.len = 0;
+		generate(k, &b);
+		if (o.dir){
+			if (writeRide(k, &b)){
+				pthread_mutex_lock(&lock);
+				failed = 1;
+				pthread_mutex_unlock(&lock);
+			}
+		} else {
+			pthread_mutex_lock(&lock);
+			done[k % (2 * n_workers)] = b;
+			pthread_cond_broadcast(&cond);
+			pthread_mutex_unlock(&lock);
+			b.p = NULL;
+			b.cap = 0;
+		}
+	}
+	free(b.p);
+	return NULL;
+}
+
+static int parseKinds(const char *s){
+	static const char *const names[] = { "descent", "cobbles", "mount", "stop" };
+	int kinds = 0;
+
+	while (*s){
+		size_t len = strcspn(s, ",");
+		int i;
+
+		for (i = 0; i < 4 && (strlen(names[i]) != len || strncmp(s, names[i], len)); i++);
+		if (i < 4){
+			kinds |= 1 << i;
+		} else if (len != 5 || strncmp(s, "mixed", 5)){
+			fprintf(stderr, "unknown kind '%.*s' (mixed, descent, cobbles, mount, stop)\n", (int)len, s);
+			return -1;
+		}
+		s += len + (s[len] == ',');
+	}
+	return kinds;
+}
+
+int main(int argc, char **argv){
+	pthread_t *threads;
+	struct timespec t0, t1;
+	double secs;
+	int c, i;
+
+	o.rides = 1;
+	o.seconds = 600;
+	o.seed = 1;
+	o.rate_hz = TRACE_DEFAULT_RATE;
+	o.dlpf_hz = 260;		// DLPF_CFG 0, as main() leaves it
+	o.sim_hz = 2000;
+	n_workers = sysconf(_SC_NPROCESSORS_ONLN);
+
+	while ((c = getopt(argc, argv, "n:d:s:k:a:r:b:i:j:o:")) != -1){
+		switch (c){
+		case 'n': o.rides = atol(optarg); break;
+		case 'd': o.seconds = atof(optarg); break;
+		case 's': o.seed = strtoull(optarg, NULL, 0); break;
+		case 'k':
+			o.kinds = parseKinds(optarg);
+			if (o.kinds < 0){
+				return 2;
+			}
+			break;
+		case 'a': o.afs = atoi(optarg); break;
+		case 'r': o.rate_hz = atoi(optarg); break;
+		case 'b': o.dlpf_hz = atof(optarg); break;
+		case 'i': o.sim_hz = atoi(optarg); break;
+		case 'j': n_workers = atoi(optarg); break;
+		case 'o': o.dir = optarg; break;
+		default:
+			fprintf(stderr, "usage: %s [-n rides] [-d seconds] [-s seed] [-k kinds] [-a afs_sel] "
+					"[-r rate_hz] [-b dlpf_hz] [-i sim_hz] [-j threads] [-o dir]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind != argc || o.rides < 1 || o.seconds <= 0 || o.afs < 0 || o.afs > 3
+			|| o.rate_hz < 1 || o.sim_hz < o.rate_hz || o.sim_hz % o.rate_hz || o.dlpf_hz <= 0){
+		fprintf(stderr, "%s: bad arguments (AFS_SEL 0 to 3, -i a multiple of -r)\n", argv[0]);
+		return 2;
+	}
+	if (n_workers < 1){
+		n_workers = 1;
+	}
+	if (o.dir && mkdir(o.dir, 0777) && errno != EEXIST){
+		perror(o.dir);
+		return 1;
+	}
+
+	done = calloc(2 * n_workers, sizeof(*done));
+	threads = calloc(n_workers, sizeof(*threads));
+	if (!o.dir){
+		printf("# rate_hz=%d\n", o.rate_hz);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < n_workers; i++){
+		pthread_create(&threads[i], NULL, worker, NULL);
+	}
+	if (!o.dir){
+		// Rides to stdout in order, as they come in.
+		pthread_mutex_lock(&lock);
+		while (written < o.rides){
+			buf *b = &done[written % (2 * n_workers)];
+
+			if (!b->p){
+				pthread_cond_wait(&cond, &lock);
+				continue;
+			}
+			pthread_mutex_unlock(&lock);
+			fwrite(b->p, 1, b->len, stdout);
+			free(b->p);
+			pthread_mutex_lock(&lock);
+			b->p = NULL;
+			written++;
+			pthread_cond_broadcast(&cond);
+		}
+		pthread_mutex_unlock(&lock);
+	}
+	for (i = 0; i < n_workers; i++){
+		pthread_join(threads[i], NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	if (fflush(stdout) || failed){
+		return 1;
+	}
+
+	secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+	fprintf(stderr, "%ld rides, %ld samples, %ld braking events, %.1f%% braking, "
+			"%d threads, %.2f s (%.0f samples/s)\n",
+			o.rides, total_samples, total_events, total_samples ? 100.0 * total_braking / total_samples : 0,
+			n_workers, secs, total_samples / secs);
+	return 0;
+}
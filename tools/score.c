@@ -0,0 +1,99 @@
+/*
+ * score.c
+ *
+ *  Trace scoring. See score.h.
+ */
+
+#include "score.h"
+
+#include <string.h>
+
+void scoreInit(score *s){
+	memset(s, 0, sizeof(*s));
+}
+
+/*
+ * scoreTrace
+ * Feeds every sample through detectStep(), updating the pitch every
+ * pitch_interval samples like main() does on the device, and scores the
+ * output.
+ */
+void scoreTrace(const trace *t, const detect_param *p, const replay_opts *o, score *s){
+	detect_state d;
+	score_run r;
+	long i;
+
+	detectInit(&d);
+	d.param = *p;
+	scoreRunInit(&r);
+
+	for (i = 0; i < t->n; i++){
+		const trace_sample *ts = &t->s[i];
+		accel_data a;
+
+		a.x = ts->x;
+		a.y = ts->y;
+		a.z = ts->z;
+
+		if (o->pitch_interval > 0 && i % o->pitch_interval == 0){
+			detectUpdatePitch(&d, &a);
+		}
+		scoreRunStep(&r, o, ts->brake, detectStep(&d, &a) == DETECT_BRAKE, s);
+	}
+}
+
+void scoreRunInit(score_run *r){
+	r->i = 0;
+	r->pending = -1;
+	r->prev_label = 0;
+	r->prev_light = 0;
+}
+
+/*
+ * scoreRunStep
+ * Flow:
+ * 1. On a labelled onset, start counting samples until the light is on.
+ * 2. A light switching on without a label is a false trigger.
+ * Nothing is counted during the warmup.
+ */
+void scoreRunStep(score_run *r, const replay_opts *o, char label, char light, score *s){
+	if (r->i >= o->warmup){
+		s->samples++;
+
+		if (label && !r->prev_label){
+			s->events++;
+			r->pending = r->i;
+		}
+		if (!label){
+			r->pending = -1;
+		}
+		if (r->pending >= 0 && light){
+			long latency = r->i - r->pending;
+
+			s->detected++;
+			s->latency_sum += latency;
+			if (latency > s->latency_max){
+				s->latency_max = latency;
+			}
+			r->pending = -1;
+		}
+		if (light && !r->prev_light && !label){
+			s->false_triggers++;
+		}
+	}
+
+	r->prev_label = label;
+	r->prev_light = light;
+	r->i++;
+}
+
+void scoreAdd(score *total, const score *s){
+	total->samples += s->samples;
+	total->events += s->events;
+	total->detected += s->detected;
+	total->latency_sum += s->latency_sum;
+	if (s->latency_max > total->latency_max){
+		total->latency_max = s->latency_max;
+	}
+	total->false_triggers += s->false_triggers;
+}
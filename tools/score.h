@@ -0,0 +1,43 @@
+/*
+ * score.h
+ *
+ *  Runs a ride trace through the firmware detection code (detect.c,
+ *  built with DETECT_TUNABLE) and scores the output against the labels.
+ */
+
+#ifndef SCORE_H_
+#define SCORE_H_
+
+#include <detect.h>
+#include "trace.h"
+
+typedef struct score_struct{
+	long samples;
+	long events;			// labelled brake onsets
+	long detected;			// ... that the light reacted to while the label was high
+	long latency_sum;		// samples from labelled onset to light on, over detected events
+	long latency_max;
+	long false_triggers;	// light switching on while the label is low
+} score;
+
+typedef struct replay_opts_struct{
+	int pitch_interval;		// samples between detectUpdatePitch() calls
+	long warmup;			// samples at the start that are not scored
+} replay_opts;
+
+// Incremental scoring of one light on/off sequence against its labels,
+// for tools that run the detector themselves.
+typedef struct score_run_struct{
+	long i;					// samples seen
+	long pending;			// sample index of an onset not yet detected, or -1
+	char prev_label;
+	char prev_light;
+} score_run;
+
+void scoreInit(score *s);
+void scoreTrace(const trace *t, const detect_param *p, const replay_opts *o, score *s);
+void scoreAdd(score *total, const score *s);
+void scoreRunInit(score_run *r);
+void scoreRunStep(score_run *r, const replay_opts *o, char label, char light, score *s);
+
+#endif /* SCORE_H_ */
@@ -0,0 +1,425 @@
+/*
+ * stack430.c
+ *
+ *  Worst-case stack depth of an MSP430 firmware image, from the code.
+ *
+ *  Every function reachable from the reset vector and from each
+ *  interrupt vector is walked instruction by instruction along every
+ *  path (jumps followed, both ways for conditional ones), keeping the
+ *  bytes it has below its entry SP: PUSH, POP (MOV @SP+), ADD/SUB of a
+ *  constant to SP. A CALL #f adds the return address and f's own worst
+ *  case; a BR #f out of the function is a tail call and adds only f's.
+ *  "MOV #x, SP" (the startup code) starts again from 0.
+ *
+ *  The total is the reset path's worst plus the deepest interrupt
+ *  (4 bytes for PC and SR, plus its handler), as an interrupt can come
+ *  at any point the reset path has GIE set. Handlers are assumed not to
+ *  nest, as none of ours set GIE.
+ *
+ *  What it cannot see makes the result a lower bound, and is flagged
+ *  with '?': calls through a pointer, computed branches (switch tables;
+ *  the code after them is still walked), SP set from a register, and
+ *  recursion.
+ *
+ *  Build (from the repository root):
+ *    cc -O2 -o stack430 tools/stack430.c tools/cpu430.c tools/elf430.c
+ *
+ *  Usage:
+ *    stack430 [-q] image.elf | object.o...
+ *
+ *  -q prints the total only (tools/footprint.sh).
+ */
+
+#include "cpu430.h"
+#include "elf430.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_FUNCS 256
+#define MAX_SITES 64			// call sites per function
+#define MAX_WORK 256			// pending branch targets per function
+#define MAX_DEPTH 1024			// a path deeper than this is a loop that pushes
+#define VECTORS 16
+#define RESET 15
+
+#define SP 1
+#define SR 2
+#define CG2 3
+
+enum{
+	F_INDIRECT = 1,			// call or branch through a pointer
+	F_SP_SET = 2,			// SP loaded from a register
+	F_RECURSIVE = 4,
+	F_UNBOUNDED = 8,		// pushes in a loop
+	F_ILLEGAL = 16,			// ran into something that is not an instruction
+};
+
+typedef struct func_struct{
+	unsigned int addr;
+	int frame;				// own worst, bytes below the entry SP
+	int worst;				// frame plus the deepest callee
+	int via;				// index of that callee, -1 for none
+	int own;				// what sweep() could not see here
+	int flags;				// own and inherited from callees
+	int busy;				// on the analysis stack
+} func;
+
+typedef struct site_struct{
+	unsigned int target;
+	int depth;				// bytes below entry SP at the call, return address included
+} site;
+
+static elf430 e;
+static cpu430 cpu;
+static func funcs[MAX_FUNCS];
+static int n_funcs;
+static short depth_at[0x10000];		// per address, -1 if not reached yet
+
+static unsigned int word(unsigned int addr){
+	return cpu.mem[addr & 0xFFFF] | (cpu.mem[(addr + 1) & 0xFFFF] << 8);
+}
+
+static int srcWords(int as, int reg){
+	if (as == 1){
+		return reg != CG2;
+	}
+	return as == 3 && reg == 0;		// #immediate
+}
+
+/*
+ * constant
+ * Value of a source operand that is a constant: #imm or the constant
+ * generators. Returns 0 if it is not one, with the value in *v.
+ */
+static int constant(unsigned int addr, int as, int reg, int *v){
+	if (reg == 0 && as == 3){
+		*v = (short)word(addr + 2);
+		return 1;
+	}
+	if (reg == SR && as >= 2){
+		*v = as == 2 ? 4 : 8;
+		return 1;
+	}
+	if (reg == CG2){
+		*v = as == 3 ? -1 : as;
+		return 1;
+	}
+	return 0;
+}
+
+static const char *name(unsigned int addr){
+	static char buf[8];
+	const elf430_sym *s = elf430At(&e, addr);
+
+	if (s && s->addr == addr){
+		return s->name;
+	}
+	snprintf(buf, sizeof(buf), "0x%04x", addr);
+	return buf;
+}
+
+static int inFunc(const elf430_sym *s, unsigned int entry, unsigned int addr){
+	if (!s){
+		return addr == entry;
+	}
+	return addr >= s->addr && addr < s->addr + s->size;
+}
+
+/*
+ * sweep
+ * Walks one function from its entry.
+ * Flow:
+ * 1. Work list of (address, depth); an address is walked again only if
+ *    it is reached deeper than before.
+ * 2. Track SP changes; RET and RETI end a path.
+ * 3. Calls and tail calls go to sites[] for later (the callee is not
+ *    walked here, depth_at[] is shared).
+ * Returns the number of call sites, with the own worst in f->frame.
+ */
+static int sweep(func *f, site *sites){
+	const elf430_sym *s = elf430At(&e, f->addr);
+	unsigned int work[MAX_WORK];
+	unsigned int lo = s ? s->addr : f->addr, hi = s ? s->addr + s->size : f->addr + 2;
+	int n_work = 0, n_sites = 0;
+	unsigned int a;
+
+	for (a = lo; a < hi; a++){
+		depth_at[a] = -1;
+	}
+	depth_at[f->addr] = 0;
+	work[n_work++] = f->addr;
+	f->frame = 0;
+
+	while (n_work){
+		unsigned int pc = work[--n_work];
+		int depth = depth_at[pc];
+
+		for (;;){
+			unsigned int op = word(pc);
+			unsigned int next = pc + 2, target = 0;
+			int is_jump = 0, ends = 0, call = 0, v;
+
+			if (depth > f->frame){
+				f->frame = depth;
+			}
+			if (depth > MAX_DEPTH){
+				f->own |= F_UNBOUNDED;
+				break;
+			}
+
+			if (op >= 0x4000){
+				int opcode = op >> 12, src = (op >> 8) & 0xF, ad = (op >> 7) & 1;
+				int as = (op >> 4) & 3, dst = op & 0xF;
+
+				next += 2 * (srcWords(as, src) + ad);
+				if (op == 0x4130){
+					ends = 1;								// RET
+				} else if (dst == 0 && !ad){
+					if (opcode == 4 && constant(pc, as, src, &v)){
+						target = v & 0xFFFF;				// BR #x
+						is_jump = 1;
+						ends = 1;
+					} else if (opcode != 9 && opcode != 0xB){
+						f->own |= F_INDIRECT;				// computed branch: go on after it
+					}
+				} else if (dst == SP && !ad){
+					if (opcode == 4){
+						if (constant(pc, as, src, &v)){
+							depth = 0;
+						} else {
+							f->own |= F_SP_SET;
+						}
+					} else if (opcode == 5 || opcode == 8){
+						if (constant(pc, as, src, &v)){
+							depth += opcode == 8 ? v : -v;
+						} else {
+							f->own |= F_SP_SET;
+						}
+					}
+				} else if (opcode == 4 && src == SP && as == 3){
+					depth -= 2;								// POP
+				}
+			} else if (op >= 0x2000){
+				int offset = op & 0x3FF;
+
+				if (offset & 0x200){
+					offset -= 0x400;
+				}
+				target = (pc + 2 + 2 * offset) & 0xFFFF;
+				is_jump = 1;
+				ends = ((op >> 10) & 7) == 7;				// JMP
+			} else if (op >= 0x1000 && op < 0x1400){
+				int opcode = (op >> 7) & 7, as = (op >> 4) & 3, reg = op & 0xF;
+
+				next += 2 * srcWords(as, reg);
+				if (opcode == 6){
+					ends = 1;								// RETI
+				} else if (opcode == 4){
+					depth += 2;								// PUSH
+				} else if (opcode == 5){
+					call = 1;
+					if (reg == 0 && as == 3){
+						target = word(pc + 2);
+					} else {
+						f->own |= F_INDIRECT;
+						target = 0;
+					}
+				} else if (opcode == 7){
+					f->own |= F_ILLEGAL;
+					break;
+				}
+			} else {
+				f->own |= F_ILLEGAL;
+				break;
+			}
+
+			if (depth > f->frame){
+				f->frame = depth;
+			}
+			if ((call && target) || (is_jump && !inFunc(s, f->addr, target))){
+				if (n_sites < MAX_SITES){
+					sites[n_sites].target = target;
+					sites[n_sites].depth = depth + (call ? 2 : 0);
+					n_sites++;
+				}
+				if (call && depth + 2 > f->frame){
+					f->frame = depth + 2;
+				}
+			} else if (call && depth + 2 > f->frame){
+				f->frame = depth + 2;						// through a pointer: the return address at least
+			} else if (is_jump && depth_at[target] < depth){
+				depth_at[target] = depth;
+				if (n_work < MAX_WORK){
+					work[n_work++] = target;
+				} else {
+					f->own |= F_UNBOUNDED;
+				}
+			}
+			if (ends || !inFunc(s, f->addr, next)){
+				break;
+			}
+			if (depth_at[next] >= depth){
+				break;
+			}
+			depth_at[next] = depth;
+			pc = next;
+		}
+	}
+	return n_sites;
+}
+
+/*
+ * analyse
+ * Worst case of the function at addr, callees included. Returns its
+ * index in funcs[], or -1 if the table is full.
+ */
+static int analyse(unsigned int addr){
+	site sites[MAX_SITES];
+	func *f;
+	int i, n, idx;
+
+	for (i = 0; i < n_funcs; i++){
+		if (funcs[i].addr == addr){
+			return i;
+		}
+	}
+	if (n_funcs == MAX_FUNCS){
+		return -1;
+	}
+	idx = n_funcs++;
+	f = &funcs[idx];
+	memset(f, 0, sizeof(*f));
+	f->addr = addr;
+	f->via = -1;
+	f->busy = 1;
+
+	n = sweep(f, sites);
+	f->worst = f->frame;
+	for (i = 0; i < n; i++){
+		int c = analyse(sites[i].target);
+
+		if (c < 0){
+			f->own |= F_INDIRECT;
+			continue;
+		}
+		if (funcs[c].busy){
+			f->own |= F_RECURSIVE;
+			continue;
+		}
+		f->flags |= funcs[c].flags;
+		if (sites[i].depth + funcs[c].worst > f->worst){
+			f->worst = sites[i].depth + funcs[c].worst;
+			f->via = c;
+		}
+	}
+	f->flags |= f->own;
+	f->busy = 0;
+	return idx;
+}
+
+static void printChain(int i){
+	printf("%s", name(funcs[i].addr));
+	for (i = funcs[i].via; i >= 0; i = funcs[i].via){
+		printf(" > %s", name(funcs[i].addr));
+	}
+}
+
+static const char *mark(int flags){
+	return flags ? "?" : "";
+}
+
+int main(int argc, char **argv){
+	int roots[VECTORS];
+	int quiet = 0, c, i, v, isr = -1, isr_bytes = 0, total;
+
+	while ((c = getopt(argc, argv, "q")) != -1){
+		switch (c){
+		case 'q': quiet = 1; break;
+		default:
+			fprintf(stderr, "usage: %s [-q] image.elf | object.o...\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind >= argc){
+		fprintf(stderr, "usage: %s [-q] image.elf | object.o...\n", argv[0]);
+		return 2;
+	}
+
+	elf430Init(&e);
+	for (i = optind; i < argc; i++){
+		if (elf430Load(&e, &cpu, argv[i])){
+			return 1;
+		}
+	}
+	if (elf430Link(&e, &cpu)){
+		return 1;
+	}
+	if (!e.is_image){
+		fprintf(stderr, "no reset vector: need a firmware image\n");
+		return 2;
+	}
+
+	for (v = 0; v < VECTORS; v++){
+		unsigned int addr = word(0xFFE0 + 2 * v);
+
+		roots[v] = -1;
+		if (addr && addr != 0xFFFF && !(addr & 1)){
+			roots[v] = analyse(addr);
+		}
+	}
+	if (roots[RESET] < 0){
+		fprintf(stderr, "reset vector: nothing to analyse\n");
+		return 1;
+	}
+	for (v = 0; v < RESET; v++){
+		if (roots[v] >= 0 && 4 + funcs[roots[v]].worst > isr_bytes){
+			isr_bytes = 4 + funcs[roots[v]].worst;
+			isr = v;
+		}
+	}
+	total = funcs[roots[RESET]].worst + isr_bytes;
+
+	if (quiet){
+		printf("%d%s\n", total, mark(funcs[roots[RESET]].flags | (isr >= 0 ? funcs[roots[isr]].flags : 0)));
+		elf430Free(&e);
+		return 0;
+	}
+
+	printf("%-24s %6s %6s\n", "function", "frame", "worst");
+	for (i = 0; i < n_funcs; i++){
+		printf("%-24s %6d %5d%-1s\n", name(funcs[i].addr), funcs[i].frame, funcs[i].worst, mark(funcs[i].flags));
+	}
+	printf("\n");
+	for (v = 0; v < VECTORS; v++){
+		if (roots[v] < 0){
+			continue;
+		}
+		printf("vector %2d %s%5d bytes: ", v, v == RESET ? "(reset) " : "        ",
+				funcs[roots[v]].worst + (v == RESET ? 0 : 4));
+		printChain(roots[v]);
+		printf("\n");
+	}
+	printf("\nstack: %d%s bytes worst case (reset path %d", total,
+			mark(funcs[roots[RESET]].flags | (isr >= 0 ? funcs[roots[isr]].flags : 0)), funcs[roots[RESET]].worst);
+	if (isr >= 0){
+		printf(" + vector %d %d", isr, isr_bytes);
+	}
+	printf(")\n");
+	for (i = 0; i < n_funcs; i++){
+		if (funcs[i].own){
+			int fl = funcs[i].own;
+
+			printf("? %s:%s%s%s%s%s\n", name(funcs[i].addr),
+					fl & F_INDIRECT ? " indirect call or branch" : "",
+					fl & F_SP_SET ? " SP set from a register" : "",
+					fl & F_RECURSIVE ? " recursion" : "",
+					fl & F_UNBOUNDED ? " pushes in a loop" : "",
+					fl & F_ILLEGAL ? " not an instruction" : "");
+		}
+	}
+	elf430Free(&e);
+	return 0;
+}
@@ -0,0 +1,123 @@
+/*
+ * teldec.c
+ *
+ *  Decoder for the telemetry stream (libs/telemetry.h, libs/suart.c).
+ *
+ *  Reads the raw byte stream from a file or serial port, finds frames by
+ *  their sync byte and checksum, and prints one line per good frame.
+ *  A bad checksum resynchronises on the next sync byte, so a corrupted
+ *  or partial frame costs only that frame. Sequence gaps are counted as
+ *  lost frames (on the wire), separately from frames the device had to
+ *  drop because the UART was still busy.
+ *
+ *  Build (from the repository root):
+ *    cc -O2 -Iauto_brake_light_2/libs -o teldec tools/teldec.c
+ *
+ *  Usage:
+ *    stty -F /dev/ttyACM0 9600 raw
+ *    teldec [-t] /dev/ttyACM0
+ *  -t prints the raw axes in the trace format (trace.h) instead, ready
+ *  for tools/replay once labelled.
+ */
+
+#include <telemetry.h>
+#include <detect.h>
+#include "trace.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static int word(const unsigned char *f, int off){
+	int v = f[off] | (f[off + 1] << 8);
+	return (v & 0x8000) ? v - 0x10000 : v;
+}
+
+int main(int argc, char **argv){
+	unsigned char buf[TEL_FRAME];
+	int have = 0;
+	int trace_out = 0;
+	int last_seq = -1;
+	long good = 0, bad = 0, lost = 0, dropped = 0;
+	FILE *in = stdin;
+	int c;
+
+	while ((c = getopt(argc, argv, "t")) != -1){
+		if (c == 't'){
+			trace_out = 1;
+		} else {
+			fprintf(stderr, "usage: %s [-t] [stream]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind < argc){
+		in = fopen(argv[optind], "rb");
+		if (!in){
+			perror(argv[optind]);
+			return 1;
+		}
+	}
+
+	if (trace_out){
+		printf("# rate_hz=%d\n", TRACE_DEFAULT_RATE);
+	} else {
+		printf("seq,raw_x,raw_y,raw_z,comp_z,cur_z,state,dropped,cycles,temp\n");
+	}
+
+	while ((c = fgetc(in)) != EOF){
+		unsigned char sum = 0;
+		int i;
+
+		if (have == 0 && c != TEL_SYNC){
+			continue;
+		}
+		buf[have++] = c;
+		if (have < TEL_FRAME){
+			continue;
+		}
+
+		for (i = 0; i < TEL_FRAME; i++){
+			sum += buf[i];
+		}
+		if (sum){
+			// Not a frame after all: rescan from the byte after this sync.
+			unsigned char *next = memchr(buf + 1, TEL_SYNC, TEL_FRAME - 1);
+
+			bad++;
+			have = 0;
+			if (next){
+				have = TEL_FRAME - (next - buf);
+				memmove(buf, next, have);
+			}
+			continue;
+		}
+		have = 0;
+		good++;
+
+		if (last_seq >= 0){
+			lost += (buf[TEL_SEQ] - last_seq - 1) & 0xFF;
+		}
+		last_seq = buf[TEL_SEQ];
+		dropped += buf[TEL_DROPPED];
+
+		if (trace_out){
+			printf("%d,%d,%d,0\n", word(buf, TEL_RAW_X), word(buf, TEL_RAW_Y), word(buf, TEL_RAW_Z));
+		} else {
+			printf("%d,%d,%d,%d,%d,%d,%s,%d,%u,", buf[TEL_SEQ],
+					word(buf, TEL_RAW_X), word(buf, TEL_RAW_Y), word(buf, TEL_RAW_Z),
+					word(buf, TEL_COMP_Z), word(buf, TEL_CUR_Z),
+					buf[TEL_STATE] == DETECT_BRAKE ? "brake" : "idle",
+					buf[TEL_DROPPED], buf[TEL_CYCLES] | (buf[TEL_CYCLES + 1] << 8));
+			if (word(buf, TEL_TEMP) == TEL_NO_TEMP){
+				printf("-\n");
+			} else {
+				printf("%d\n", word(buf, TEL_TEMP));
+			}
+		}
+		fflush(stdout);
+	}
+
+	fprintf(stderr, "%ld frames, %ld bad, %ld lost on the wire, %ld dropped on the device\n",
+			good, bad, lost, dropped);
+	return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * tempcal.c
+ *
+ *  Temperature drift calibration for TEMP_COMP (libs/tempcomp.h).
+ *
+ *  Fits a straight line through each axis against the raw TEMP_OUT
+ *  reading of a recording at rest, and prints the slopes as the
+ *  TEMPCOMP_X/Y/Z_DRIFT values (counts per table point) for config.h.
+ *  At rest the axes read gravity plus the zero-g offsets, and gravity
+ *  does not change with temperature, so the slope is the drift. Only
+ *  the slope is used: the pitch compensation takes out the offset at
+ *  whatever temperature the ride starts.
+ *
+ *  Recording: a build with TELEMETRY and TEMP_COMP (e.g. PROFILE_DEBUG
+ *  with -DTEMP_COMP=1) on the bench, at rest in its mounting
+ *  orientation, warming up from cold (an hour in the fridge) over at
+ *  least TEMPCOMP_STEP raw counts, about 12 degrees. The firmware reads
+ *  the temperature every TEMPCOMP_INTERVAL pitch updates (~30 s at
+ *  5 Hz), so the sweep wants the best part of an hour:
+ *    teldec /dev/ttyACM0 > rest.csv
+ *
+ *  Build (from the repository root):
+ *    cc -O2 -Iauto_brake_light_2/libs -o tempcal tools/tempcal.c -lm
+ *
+ *  Usage:
+ *    tempcal rest.csv
+ *
+ *  Samples where the detector saw braking (the board was moved) and
+ *  frames without a temperature are left out.
+ */
+
+#include <telemetry.h>
+#include <tempcomp.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define AXES 3
+#define PER_DEGREE (MPU6050_TEMP_RAW(1) - MPU6050_TEMP_RAW(0))
+
+static const char axis_name[AXES] = { 'X', 'Y', 'Z' };
+
+int main(int argc, char **argv){
+	FILE *in;
+	char line[256];
+	double n = 0, st = 0, stt = 0, sa[AXES] = { 0 }, sta[AXES] = { 0 }, saa[AXES] = { 0 };
+	int t_min = 0, t_max = 0;
+	long skipped = 0;
+	double var_t;
+	int i;
+
+	if (argc != 2){
+		fprintf(stderr, "usage: %s rest.csv\n", argv[0]);
+		return 2;
+	}
+	in = fopen(argv[1], "r");
+	if (!in){
+		perror(argv[1]);
+		return 1;
+	}
+
+	while (fgets(line, sizeof(line), in)){
+		int seq, a[AXES], t;
+		char state[8];
+
+		// seq,raw_x,raw_y,raw_z,comp_z,cur_z,state,dropped,cycles,temp
+		if (sscanf(line, "%d,%d,%d,%d,%*d,%*d,%7[a-z],%*d,%*u,%d",
+				&seq, &a[0], &a[1], &a[2], state, &t) != 6){
+			skipped++;		// the header, or a frame without a temperature
+			continue;
+		}
+		if (strcmp(state, "idle")){
+			skipped++;
+			continue;
+		}
+		if (!n || t < t_min){
+			t_min = t;
+		}
+		if (!n || t > t_max){
+			t_max = t;
+		}
+		n++;
+		st += t;
+		stt += (double)t * t;
+		for (i = 0; i < AXES; i++){
+			sa[i] += a[i];
+			sta[i] += (double)t * a[i];
+			saa[i] += (double)a[i] * a[i];
+		}
+	}
+	fclose(in);
+
+	if (n < 2 || t_max - t_min < TEMPCOMP_STEP){
+		fprintf(stderr, "%s: %.0f samples over %d raw counts of temperature, need at least %d\n",
+				argv[1], n, t_max - t_min, TEMPCOMP_STEP);
+		return 1;
+	}
+
+	fprintf(stderr, "%.0f samples (%ld skipped), %.1f to %.1f degrees\n", n, skipped,
+			MPU6050_GET_TEMPERATURE(t_min), MPU6050_GET_TEMPERATURE(t_max));
+	var_t = stt - st * st / n;
+	for (i = 0; i < AXES; i++){
+		double slope = (sta[i] - st * sa[i] / n) / var_t;
+		double var_a = saa[i] - sa[i] * sa[i] / n;
+		double resid = var_a - slope * (sta[i] - st * sa[i] / n);
+
+		fprintf(stderr, "%c: %+.2f counts per degree, residual %.1f counts rms\n", axis_name[i],
+				slope * PER_DEGREE, sqrt(resid > 0 ? resid / n : 0));
+		printf("#define TEMPCOMP_%c_DRIFT %ld\n", axis_name[i], lround(slope * TEMPCOMP_STEP));
+	}
+	return 0;
+}
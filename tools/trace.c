@@ -0,0 +1,389 @@
+/*
+ * trace.c
+ *
+ *  Ride trace loader. See trace.h for the format.
+ */
+
+#include "trace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef char trace_sample_is_8_bytes[sizeof(trace_sample) == 8 ? 1 : -1];
+typedef char trace_header_is_32_bytes[sizeof(trace_header) == 32 ? 1 : -1];
+typedef char trace_chunk_is_16_bytes[sizeof(trace_chunk) == 16 ? 1 : -1];
+
+int traceLoad(const char *path, trace *t){
+	FILE *f;
+	char line[256];
+	long cap = 1024;
+	long lineno = 0;
+
+	t->n = 0;
+	t->rate_hz = TRACE_DEFAULT_RATE;
+	t->in_place = 0;
+	t->s = malloc(cap * sizeof(*t->s));
+	if (!t->s){
+		return -1;
+	}
+
+	f = fopen(path, "r");
+	if (!f){
+		traceFree(t);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), f)){
+		trace_sample *s;
+		int x, y, z, brake;
+
+		lineno++;
+		if (line[0] == '#'){
+			sscanf(line, "# rate_hz=%d", &t->rate_hz);
+			continue;
+		}
+		if (strspn(line, " \t\r\n") == strlen(line)){
+			continue;
+		}
+
+		if (t->n == cap){
+			trace_sample *grown = realloc(t->s, 2 * cap * sizeof(*t->s));
+			if (!grown){
+				fclose(f);
+				traceFree(t);
+				return -1;
+			}
+			t->s = grown;
+			cap *= 2;
+		}
+
+		s = &t->s[t->n];
+		if (sscanf(line, "%d,%d,%d,%d", &x, &y, &z, &brake) != 4
+				|| x < -32768 || x > 32767 || y < -32768 || y > 32767 || z < -32768 || z > 32767){
+			fclose(f);
+			traceFree(t);
+			fprintf(stderr, "%s:%ld: expected x,y,z,brake with 16 bit axes\n", path, lineno);
+			errno = 0;
+			return -1;
+		}
+		s->x = x;
+		s->y = y;
+		s->z = z;
+		s->brake = brake != 0;
+		s->reserved = 0;
+		t->n++;
+	}
+
+	fclose(f);
+	return 0;
+}
+
+void traceFree(trace *t){
+	if (!t->in_place){
+		free(t->s);
+	}
+	t->s = NULL;
+	t->n = 0;
+}
+
+// Reports a format error; errno 0 tells the caller not to perror().
+static int bad(const char *path, const char *what){
+	fprintf(stderr, "%s: %s\n", path, what);
+	errno = 0;
+	return -1;
+}
+
+/*
+ * traceOpen
+ * Flow:
+ * 1. Map the whole file read-only; the kernel pages it in as the tools
+ *    walk it, nothing is copied.
+ * 2. Check the header, then every chunk against the file size, so the
+ *    tools can index without checks.
+ * 3. One trace per chunk, pointing at its samples.
+ */
+int traceOpen(const char *path, trace_file *f){
+	const unsigned char *p;
+	const trace_header *h;
+	const uint64_t *table;
+	struct stat st;
+	uint32_t i, events = 0;
+	int fd;
+
+	memset(f, 0, sizeof(*f));
+	fd = open(path, O_RDONLY);
+	if (fd < 0){
+		return -1;
+	}
+	if (fstat(fd, &st)){
+		close(fd);
+		return -1;
+	}
+	if (st.st_size < (off_t)sizeof(trace_header)){
+		close(fd);
+		return bad(path, "too short for a binary trace");
+	}
+	f->size = st.st_size;
+	f->map = mmap(NULL, f->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (f->map == MAP_FAILED){
+		f->map = NULL;
+		return -1;
+	}
+	madvise(f->map, f->size, MADV_WILLNEED);
+	p = f->map;
+	h = f->map;
+
+	if (memcmp(h->magic, TRACE_MAGIC, 4) || h->version != TRACE_VERSION || h->sample_size != sizeof(trace_sample)){
+		traceClose(f);
+		return bad(path, "not a binary trace of this version");
+	}
+	if (h->chunk_table % 8 || h->chunk_table > f->size || (f->size - h->chunk_table) / 8 < h->n_chunks
+			|| h->event_index % 4 || h->event_index > f->size
+			|| (f->size - h->event_index) / sizeof(trace_event) < h->n_events){
+		traceClose(f);
+		return bad(path, "index past the end of the file");
+	}
+	table = (const uint64_t *)(p + h->chunk_table);
+	f->events = (const trace_event *)(p + h->event_index);
+	f->n_events = h->n_events;
+	f->n_chunks = h->n_chunks;
+	f->chunks = calloc(h->n_chunks ? h->n_chunks : 1, sizeof(*f->chunks));
+	if (!f->chunks){
+		traceClose(f);
+		return -1;
+	}
+	for (i = 0; i < h->n_chunks; i++){
+		const trace_chunk *c;
+
+		if (table[i] % 8 || table[i] > f->size - sizeof(trace_chunk)){
+			traceClose(f);
+			return bad(path, "chunk past the end of the file");
+		}
+		c = (const trace_chunk *)(p + table[i]);
+		if ((f->size - table[i] - sizeof(trace_chunk)) / sizeof(trace_sample) < c->n
+				|| c->first_event != events || c->n_events > h->n_events - events){
+			traceClose(f);
+			return bad(path, "chunk does not match the file");
+		}
+		events += c->n_events;
+		f->chunks[i].s = (trace_sample *)(c + 1);
+		f->chunks[i].n = c->n;
+		f->chunks[i].rate_hz = c->rate_hz ? c->rate_hz : TRACE_DEFAULT_RATE;
+		f->chunks[i].in_place = 1;
+	}
+	for (i = 0; i < h->n_events; i++){
+		const trace_event *e = &f->events[i];
+
+		if (e->chunk >= h->n_chunks || e->sample >= f->chunks[e->chunk].n){
+			traceClose(f);
+			return bad(path, "event outside its chunk");
+		}
+	}
+	return 0;
+}
+
+void traceClose(trace_file *f){
+	if (f->map){
+		munmap(f->map, f->size);
+	}
+	free(f->chunks);
+	memset(f, 0, sizeof(*f));
+}
+
+int traceWindow(const trace_file *f, long event, long before, long after, trace *w){
+	const trace_event *e;
+	const trace *c;
+	long from, to;
+
+	if (event < 0 || event >= f->n_events){
+		return -1;
+	}
+	e = &f->events[event];
+	c = &f->chunks[e->chunk];
+	from = (long)e->sample - before;
+	to = (long)e->sample + after;
+	from = from < 0 ? 0 : from;
+	to = to > c->n ? c->n : to;
+	w->s = c->s + from;
+	w->n = to > from ? to - from : 0;
+	w->rate_hz = c->rate_hz;
+	w->in_place = 1;
+	return 0;
+}
+
+static int put(FILE *f, const void *p, size_t n){
+	return fwrite(p, 1, n, f) == n ? 0 : -1;
+}
+
+/*
+ * traceWrite
+ * Flow:
+ * 1. Header with the counts, offsets filled in at the end.
+ * 2. Per trace, its chunk header and samples, collecting the onsets.
+ * 3. Chunk table and event index, then the header again.
+ */
+int traceWrite(const char *path, const trace *t, int n){
+	trace_header h;
+	uint64_t *table;
+	trace_event *events = NULL;
+	long n_events = 0, cap = 0;
+	FILE *f;
+	int i, err = 0;
+
+	table = malloc((n ? n : 1) * sizeof(*table));
+	f = fopen(path, "wb");
+	if (!table || !f){
+		free(table);
+		if (f){
+			fclose(f);
+		}
+		return -1;
+	}
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, TRACE_MAGIC, 4);
+	h.version = TRACE_VERSION;
+	h.sample_size = sizeof(trace_sample);
+	h.n_chunks = n;
+	err |= put(f, &h, sizeof(h));
+
+	for (i = 0; i < n && !err; i++){
+		trace_chunk c;
+		long j;
+
+		memset(&c, 0, sizeof(c));
+		c.n = t[i].n;
+		c.rate_hz = t[i].rate_hz;
+		c.first_event = n_events;
+		for (j = 0; j < t[i].n; j++){
+			if (t[i].s[j].brake && (!j || !t[i].s[j - 1].brake)){
+				if (n_events == cap){
+					trace_event *grown;
+
+					cap = cap ? 2 * cap : 256;
+					grown = realloc(events, cap * sizeof(*events));
+					if (!grown){
+						err = -1;
+						break;
+					}
+					events = grown;
+				}
+				events[n_events].chunk = i;
+				events[n_events].sample = j;
+				n_events++;
+			}
+		}
+		c.n_events = n_events - c.first_event;
+		table[i] = ftell(f);
+		err |= put(f, &c, sizeof(c));
+		err |= put(f, t[i].s, t[i].n * sizeof(*t[i].s));
+	}
+
+	h.chunk_table = ftell(f);
+	h.n_events = n_events;
+	err |= put(f, table, n * sizeof(*table));
+	h.event_index = ftell(f);
+	err |= put(f, events, n_events * sizeof(*events));
+	err |= fseek(f, 0, SEEK_SET);
+	err |= put(f, &h, sizeof(h));
+	err |= fclose(f);
+	free(table);
+	free(events);
+	if (err && !errno){
+		errno = EIO;
+	}
+	return err ? -1 : 0;
+}
+
+int traceIsBinary(const char *path){
+	char magic[4];
+	FILE *f = fopen(path, "rb");
+	int is;
+
+	if (!f){
+		return 0;
+	}
+	is = fread(magic, 1, 4, f) == 4 && !memcmp(magic, TRACE_MAGIC, 4);
+	fclose(f);
+	return is;
+}
+
+int traceSetAdd(trace_set *s, const char *path){
+	trace_file tf;
+	trace *grown;
+	trace_file *files;
+	int i;
+
+	if (!traceIsBinary(path)){
+		grown = realloc(s->t, (s->n + 1) * sizeof(*s->t));
+		if (!grown){
+			return -1;
+		}
+		s->t = grown;
+		if (traceLoad(path, &s->t[s->n])){
+			return -1;
+		}
+		s->n++;
+		return 0;
+	}
+
+	if (traceOpen(path, &tf)){
+		return -1;
+	}
+	grown = realloc(s->t, (s->n + tf.n_chunks + 1) * sizeof(*s->t));
+	if (grown){
+		s->t = grown;
+	}
+	files = realloc(s->files, (s->n_files + 1) * sizeof(*s->files));
+	if (files){
+		s->files = files;
+	}
+	if (!grown || !files){
+		traceClose(&tf);
+		return -1;
+	}
+	for (i = 0; i < tf.n_chunks; i++){
+		s->t[s->n++] = tf.chunks[i];
+	}
+	s->files[s->n_files++] = tf;
+	return 0;
+}
+
+void traceSetFree(trace_set *s){
+	int i;
+
+	for (i = 0; i < s->n; i++){
+		traceFree(&s->t[i]);
+	}
+	for (i = 0; i < s->n_files; i++){
+		traceClose(&s->files[i]);
+	}
+	free(s->t);
+	free(s->files);
+	memset(s, 0, sizeof(*s));
+}
+
+int traceSetOne(trace_set *s, const char *path){
+	if (traceSetAdd(s, path)){
+		return -1;
+	}
+	if (s->n != 1){
+		fprintf(stderr, "%s: %d traces, this tool runs one (trbconv -c picks a chunk)\n", path, s->n);
+		traceSetFree(s);
+		errno = 0;
+		return -1;
+	}
+	return 0;
+}
+
+void tracePerror(const char *path){
+	if (errno){
+		perror(path);
+	}
+}
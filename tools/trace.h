@@ -0,0 +1,134 @@
+/*
+ * trace.h
+ *
+ *  Ride traces for the host-side tools.
+ *
+ *  A trace is a text file with one sample per line:
+ *
+ *      x,y,z,brake
+ *
+ *  x/y/z are raw MPU-6050 accelerometer counts, exactly as readAccel()
+ *  would put them into accel_data. brake is the ground truth label:
+ *  1 while the rider is braking, 0 otherwise.
+ *  Lines starting with '#' are comments. A comment of the form
+ *  "# rate_hz=<n>" sets the sample rate, otherwise it is assumed to be
+ *  TRACE_DEFAULT_RATE.
+ *
+ *  Corpora are too big to parse every run, so there is also a binary
+ *  form (.trb, written by traceWrite(), converted by tools/trbconv)
+ *  that traceOpen() maps and the tools read in place. Little endian,
+ *  every field naturally aligned:
+ *
+ *      trace_header                      32 bytes
+ *      per trace: trace_chunk            16 bytes
+ *                 trace_sample[n]        8 bytes each, accel_data order
+ *      chunk table: uint64_t[n_chunks]   file offset of each trace_chunk
+ *      event index: trace_event[n_events]
+ *
+ *  A chunk is one trace (one ride, one CSV). The event index lists
+ *  every labelled brake onset (brake 0 -> 1, or 1 in the first sample)
+ *  in file order, and each chunk knows its slice of it, so a window
+ *  around any event is two lookups away (traceWindow()).
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TRACE_DEFAULT_RATE 5	// MPU6050_LP_WAKE_5HZ
+#define TRACE_MAGIC "ABLT"
+#define TRACE_VERSION 1
+
+// Also the .trb record: 16 bit axes as the sensor reports them.
+typedef struct trace_sample_struct{
+	int16_t x;
+	int16_t y;
+	int16_t z;
+	char brake;
+	char reserved;		// 0
+} trace_sample;
+
+typedef struct trace_struct{
+	trace_sample *s;
+	long n;
+	int rate_hz;
+	char in_place;		// s points into a mapped .trb: traceFree() leaves it
+} trace;
+
+typedef struct trace_header_struct{
+	char magic[4];				// TRACE_MAGIC
+	uint16_t version;			// TRACE_VERSION
+	uint16_t sample_size;		// sizeof(trace_sample)
+	uint32_t n_chunks;
+	uint32_t n_events;
+	uint64_t chunk_table;		// file offsets
+	uint64_t event_index;
+} trace_header;
+
+typedef struct trace_chunk_struct{
+	uint32_t n;					// samples
+	uint16_t rate_hz;
+	uint16_t reserved;
+	uint32_t first_event;		// this chunk's events in the index
+	uint32_t n_events;
+} trace_chunk;
+
+typedef struct trace_event_struct{
+	uint32_t chunk;
+	uint32_t sample;			// first sample with brake 1
+} trace_event;
+
+typedef struct trace_file_struct{
+	void *map;
+	size_t size;
+	trace *chunks;				// one per chunk, samples in place
+	int n_chunks;
+	const trace_event *events;
+	long n_events;
+} trace_file;
+
+// Traces from several files, CSV or .trb, for the tools that take many.
+typedef struct trace_set_struct{
+	trace *t;
+	int n;
+	trace_file *files;			// kept mapped while the set lives
+	int n_files;
+} trace_set;
+
+#ifdef __cplusplus
+extern "C" {		// check16 is C++, the loader stays C
+#endif
+
+// Returns 0 on success, -1 on failure: with errno set, or with errno 0
+// after a message on stderr (use tracePerror()).
+int traceLoad(const char *path, trace *t);
+void traceFree(trace *t);
+
+// Maps a .trb file and checks its structure. Returns 0, or -1 as traceLoad().
+int traceOpen(const char *path, trace_file *f);
+void traceClose(trace_file *f);
+// Samples [onset - before, onset + after) of an event, clipped to its
+// chunk, in place. Returns 0, or -1 if there is no such event.
+int traceWindow(const trace_file *f, long event, long before, long after, trace *w);
+// Writes n traces as one .trb file. Returns 0, or -1 with errno set.
+int traceWrite(const char *path, const trace *t, int n);
+// 1 if the file starts with TRACE_MAGIC.
+int traceIsBinary(const char *path);
+
+// Adds a CSV as one trace, or every chunk of a .trb. Returns 0, or -1.
+int traceSetAdd(trace_set *s, const char *path);
+void traceSetFree(trace_set *s);
+// The tools that run one trace: path must hold exactly one (a CSV, or a
+// single chunk .trb). Returns 0, or -1 as traceLoad().
+int traceSetOne(trace_set *s, const char *path);
+
+// perror() for the calls above, if errno says anything.
+void tracePerror(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,156 @@
+/*
+ * trbconv.c
+ *
+ *  Converter for binary traces (.trb, see trace.h).
+ *
+ *  Turns CSV traces into one .trb file, one chunk per CSV in the order
+ *  given, with the event index of brake onsets built on the way; and
+ *  reads a .trb back: the chunk and event list, whole chunks as CSV, or
+ *  the window around one event as CSV (straight from the index, without
+ *  touching the rest of the file).
+ *
+ *  Build (from the repository root):
+ *    cc -O2 -o trbconv tools/trbconv.c tools/trace.c
+ *
+ *  Usage:
+ *    trbconv -o corpus.trb trace.csv...
+ *    trbconv -l corpus.trb
+ *    trbconv [-c chunk] corpus.trb > trace.csv
+ *    trbconv -e event [-w before:after] corpus.trb > window.csv
+ *
+ *  replay, tune, batch, check16, latency, battlife and faultbench take
+ *  .trb files wherever they take CSV.
+ */
+
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define WINDOW 25		// samples either side of an event, 5 s at 5 Hz
+
+static void printTrace(const trace *t){
+	long i;
+
+	printf("# rate_hz=%d\n", t->rate_hz);
+	for (i = 0; i < t->n; i++){
+		printf("%d,%d,%d,%d\n", t->s[i].x, t->s[i].y, t->s[i].z, t->s[i].brake);
+	}
+}
+
+static int convert(const char *out, char **in, int n){
+	trace *t = calloc(n, sizeof(*t));
+	long samples = 0;
+	int i, err = 0;
+
+	for (i = 0; i < n && !err; i++){
+		if (traceLoad(in[i], &t[i])){
+			tracePerror(in[i]);
+			err = 1;
+			break;
+		}
+		samples += t[i].n;
+	}
+	if (!err && traceWrite(out, t, n)){
+		perror(out);
+		err = 1;
+	}
+	if (!err){
+		fprintf(stderr, "%s: %d traces, %ld samples\n", out, n, samples);
+	}
+	while (i-- > 0){
+		traceFree(&t[i]);
+	}
+	free(t);
+	return err;
+}
+
+static void list(const trace_file *f){
+	long *events = calloc(f->n_chunks + 1, sizeof(*events));
+	long k;
+	int i;
+
+	for (k = 0; k < f->n_events; k++){
+		events[f->events[k].chunk]++;
+	}
+	printf("%-6s %9s %7s %7s\n", "chunk", "samples", "rate", "events");
+	for (i = 0; i < f->n_chunks; i++){
+		printf("%-6d %9ld %7d %7ld\n", i, f->chunks[i].n, f->chunks[i].rate_hz, events[i]);
+	}
+	free(events);
+	printf("\n%-6s %6s %9s\n", "event", "chunk", "sample");
+	for (k = 0; k < f->n_events; k++){
+		printf("%-6ld %6u %9u\n", k, f->events[k].chunk, f->events[k].sample);
+	}
+}
+
+static void usage(const char *argv0){
+	fprintf(stderr, "usage: %s -o out.trb trace.csv...\n"
+			"       %s -l | [-c chunk] | -e event [-w before:after] file.trb\n", argv0, argv0);
+}
+
+int main(int argc, char **argv){
+	const char *out = NULL;
+	long event = -1, before = WINDOW, after = WINDOW;
+	int chunk = -1, do_list = 0;
+	trace_file f;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "o:lc:e:w:")) != -1){
+		switch (c){
+		case 'o': out = optarg; break;
+		case 'l': do_list = 1; break;
+		case 'c': chunk = atoi(optarg); break;
+		case 'e': event = atol(optarg); break;
+		case 'w':
+			if (sscanf(optarg, "%ld:%ld", &before, &after) != 2 || before < 0 || after < 0){
+				fprintf(stderr, "-w: expected before:after in samples\n");
+				return 2;
+			}
+			break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	if (optind >= argc || (!out && optind + 1 != argc)){
+		usage(argv[0]);
+		return 2;
+	}
+	if (out){
+		return convert(out, argv + optind, argc - optind);
+	}
+
+	if (traceOpen(argv[optind], &f)){
+		tracePerror(argv[optind]);
+		return 1;
+	}
+	if (do_list){
+		list(&f);
+	} else if (event >= 0){
+		trace w;
+
+		if (traceWindow(&f, event, before, after, &w)){
+			fprintf(stderr, "%s: no event %ld (%ld events)\n", argv[optind], event, f.n_events);
+			traceClose(&f);
+			return 1;
+		}
+		printf("# event %ld: chunk %u sample %u\n", event, f.events[event].chunk, f.events[event].sample);
+		printTrace(&w);
+	} else if (chunk >= 0){
+		if (chunk >= f.n_chunks){
+			fprintf(stderr, "%s: no chunk %d (%d chunks)\n", argv[optind], chunk, f.n_chunks);
+			traceClose(&f);
+			return 1;
+		}
+		printTrace(&f.chunks[chunk]);
+	} else {
+		for (i = 0; i < f.n_chunks; i++){
+			printf("# chunk %d\n", i);
+			printTrace(&f.chunks[i]);
+		}
+	}
+	traceClose(&f);
+	return 0;
+}
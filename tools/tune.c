@@ -0,0 +1,334 @@
+/*
+ * tune.c
+ *
+ *  Parameter sweep tuner. Runs every trace in a directory (each .csv,
+ *  and each chunk of each .trb, read in place) through the firmware
+ *  detection code (detect.c) for each candidate parameter set, and
+ *  prints the Pareto front of onset latency against false trigger rate.
+ *
+ *  Candidates are either the full grid below or, with -r, that many
+ *  random draws from the same ranges. The coefficients are kept to
+ *  powers of two so that the divides in smoothFilter() stay shifts on
+ *  the device.
+ *
+ *  The sweep is spread over all cores with a small work-stealing pool:
+ *  each worker starts with an equal slice of the candidates and, once it
+ *  runs dry, steals half of the biggest remaining slice. Evaluation time
+ *  varies between candidates, so static slices alone leave cores idle
+ *  at the end.
+ *
+ *  Build (from the repository root):
+ *    cc -O2 -pthread -DDETECT_TUNABLE -Iauto_brake_light_2/libs -o tune \
+ *        tools/tune.c tools/score.c tools/trace.c \
+ *        auto_brake_light_2/libs/detect.c auto_brake_light_2/libs/tempcomp.c
+ *
+ *  Usage:
+ *    tune [-j threads] [-r random_count] [-s seed] [-p pitch_interval]
+ *         [-w warmup] [-m miss_penalty] trace_dir
+ */
+
+#include <detect.h>
+#include "score.h"
+#include "trace.h"
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct candidate_struct{
+	detect_param p;
+	score s;
+	double latency;		// mean samples, missed events counted as miss_penalty
+	double fp_rate;		// false triggers per hour
+} candidate;
+
+typedef struct slice_struct{
+	pthread_mutex_t lock;
+	long lo, hi;		// candidates [lo, hi) still to do
+} slice;
+
+static trace_set set;
+static trace *traces;
+static int n_traces;
+static candidate *cands;
+static long n_cands;
+static slice *slices;
+static int n_workers;
+static replay_opts opts;
+static int miss_penalty = 50;
+
+static const int accel_coeffs[] = { 2, 4, 8, 16, 32 };
+static const int comp_coeffs[] = { 8, 16, 32, 64 };
+#define THRESH_MIN 500
+#define THRESH_MAX 6000
+#define THRESH_STEP 250
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+// Every .csv and every chunk of every .trb in dir.
+static int loadTraces(const char *dir){
+	DIR *d = opendir(dir);
+	struct dirent *e;
+
+	if (!d){
+		perror(dir);
+		return -1;
+	}
+	while ((e = readdir(d))){
+		char path[4096];
+		size_t len = strlen(e->d_name);
+
+		if (len < 4 || (strcmp(e->d_name + len - 4, ".csv") && strcmp(e->d_name + len - 4, ".trb"))){
+			continue;
+		}
+		snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+		if (traceSetAdd(&set, path)){
+			tracePerror(path);
+			closedir(d);
+			return -1;
+		}
+	}
+	closedir(d);
+	traces = set.t;
+	n_traces = set.n;
+	return 0;
+}
+
+static void makeGrid(const detect_param *defaults){
+	size_t a, c;
+	int t;
+
+	n_cands = COUNT(accel_coeffs) * COUNT(comp_coeffs)
+			* ((THRESH_MAX - THRESH_MIN) / THRESH_STEP + 1);
+	cands = calloc(n_cands, sizeof(*cands));
+	n_cands = 0;
+
+	for (a = 0; a < COUNT(accel_coeffs); a++)
+	for (c = 0; c < COUNT(comp_coeffs); c++)
+	for (t = THRESH_MIN; t <= THRESH_MAX; t += THRESH_STEP){
+		detect_param *p = &cands[n_cands++].p;
+
+		*p = *defaults;
+		p->accel_coeff = accel_coeffs[a];
+		p->comp_coeff = comp_coeffs[c];
+		p->threshold = t;
+	}
+}
+
+static void makeRandom(const detect_param *defaults, long count, unsigned int seed){
+	long i;
+
+	srand(seed);
+	n_cands = count;
+	cands = calloc(n_cands, sizeof(*cands));
+	for (i = 0; i < count; i++){
+		detect_param *p = &cands[i].p;
+
+		*p = *defaults;
+		p->accel_coeff = accel_coeffs[rand() % COUNT(accel_coeffs)];
+		p->comp_coeff = comp_coeffs[rand() % COUNT(comp_coeffs)];
+		p->threshold = THRESH_MIN + rand() % (THRESH_MAX - THRESH_MIN + 1);
+	}
+}
+
+static void evaluate(candidate *c){
+	double hours = 0;
+	int i;
+
+	scoreInit(&c->s);
+	for (i = 0; i < n_traces; i++){
+		scoreTrace(&traces[i], &c->p, &opts, &c->s);
+		hours += (double)(traces[i].n - opts.warmup) / traces[i].rate_hz / 3600.0;
+	}
+	c->latency = c->s.events
+			? (double)(c->s.latency_sum + (c->s.events - c->s.detected) * miss_penalty) / c->s.events
+			: 0.0;
+	c->fp_rate = hours > 0 ? c->s.false_triggers / hours : 0.0;
+}
+
+// Take one candidate from our own slice, from the front.
+static long popOwn(slice *s){
+	long i = -1;
+
+	pthread_mutex_lock(&s->lock);
+	if (s->lo < s->hi){
+		i = s->lo++;
+	}
+	pthread_mutex_unlock(&s->lock);
+	return i;
+}
+
+// Steal the back half of the biggest other slice into ours.
+static int steal(int self){
+	int victim = -1;
+	long best = 1;
+	long lo, hi;
+	int i;
+
+	for (i = 0; i < n_workers; i++){
+		long left = slices[i].hi - slices[i].lo;	// racy peek, re-checked under the lock
+
+		if (i != self && left > best){
+			best = left;
+			victim = i;
+		}
+	}
+	if (victim < 0){
+		// Nothing worth splitting; take any single leftover.
+		for (i = 0; i < n_workers; i++){
+			if (i != self && slices[i].hi > slices[i].lo){
+				victim = i;
+				break;
+			}
+		}
+		if (victim < 0){
+			return 0;
+		}
+	}
+
+	pthread_mutex_lock(&slices[victim].lock);
+	hi = slices[victim].hi;
+	lo = hi - (hi - slices[victim].lo + 1) / 2;
+	slices[victim].hi = lo;
+	pthread_mutex_unlock(&slices[victim].lock);
+	if (lo >= hi){
+		return 1;	// lost the race, look again
+	}
+
+	pthread_mutex_lock(&slices[self].lock);
+	slices[self].lo = lo;
+	slices[self].hi = hi;
+	pthread_mutex_unlock(&slices[self].lock);
+	return 1;
+}
+
+static void *worker(void *arg){
+	int self = (int)(long)arg;
+
+	for (;;){
+		long i = popOwn(&slices[self]);
+
+		if (i >= 0){
+			evaluate(&cands[i]);
+		} else if (!steal(self)){
+			return NULL;
+		}
+	}
+}
+
+static int byLatency(const void *a, const void *b){
+	const candidate *x = *(const candidate * const *)a;
+	const candidate *y = *(const candidate * const *)b;
+
+	if (x->latency != y->latency){
+		return x->latency < y->latency ? -1 : 1;
+	}
+	return x->fp_rate < y->fp_rate ? -1 : x->fp_rate > y->fp_rate;
+}
+
+static void printFront(int rate_hz){
+	candidate **sorted = malloc(n_cands * sizeof(*sorted));
+	double best_fp = -1;
+	long i;
+
+	for (i = 0; i < n_cands; i++){
+		sorted[i] = &cands[i];
+	}
+	qsort(sorted, n_cands, sizeof(*sorted), byLatency);
+
+	printf("%7s %7s %9s %8s %8s %9s %9s\n",
+			"accel", "comp", "threshold",
+			"lat", "lat_ms", "missed", "false/h");
+	// Sorted by latency, so a point is on the front iff it has fewer
+	// false triggers than everything before it.
+	for (i = 0; i < n_cands; i++){
+		candidate *c = sorted[i];
+
+		if (best_fp >= 0 && c->fp_rate >= best_fp){
+			continue;
+		}
+		best_fp = c->fp_rate;
+		printf("%7d %7d %9d %8.2f %8.0f %9ld %9.2f\n",
+				c->p.accel_coeff, c->p.comp_coeff, c->p.threshold,
+				c->latency, c->latency * 1000.0 / rate_hz,
+				c->s.events - c->s.detected, c->fp_rate);
+	}
+	free(sorted);
+}
+
+int main(int argc, char **argv){
+	detect_state defaults;
+	pthread_t *threads;
+	long random_count = 0;
+	unsigned int seed = 1;
+	struct timespec t0, t1;
+	int c, i;
+
+	opts.pitch_interval = PITCH_INTERVAL;
+	opts.warmup = 0;
+	n_workers = sysconf(_SC_NPROCESSORS_ONLN);
+
+	while ((c = getopt(argc, argv, "j:r:s:p:w:m:")) != -1){
+		switch (c){
+		case 'j': n_workers = atoi(optarg); break;
+		case 'r': random_count = atol(optarg); break;
+		case 's': seed = strtoul(optarg, NULL, 0); break;
+		case 'p': opts.pitch_interval = atoi(optarg); break;
+		case 'w': opts.warmup = atol(optarg); break;
+		case 'm': miss_penalty = atoi(optarg); break;
+		default:
+			fprintf(stderr, "usage: %s [-j threads] [-r random_count] [-s seed] "
+					"[-p pitch_interval] [-w warmup] [-m miss_penalty] trace_dir\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind != argc - 1){
+		fprintf(stderr, "usage: %s [options] trace_dir\n", argv[0]);
+		return 2;
+	}
+	if (n_workers < 1){
+		n_workers = 1;
+	}
+
+	if (loadTraces(argv[optind])){
+		return 1;
+	}
+	if (!n_traces){
+		fprintf(stderr, "%s: no .csv or .trb traces\n", argv[optind]);
+		return 1;
+	}
+
+	detectInit(&defaults);
+	if (random_count > 0){
+		makeRandom(&defaults.param, random_count, seed);
+	} else {
+		makeGrid(&defaults.param);
+	}
+
+	slices = calloc(n_workers, sizeof(*slices));
+	threads = calloc(n_workers, sizeof(*threads));
+	for (i = 0; i < n_workers; i++){
+		pthread_mutex_init(&slices[i].lock, NULL);
+		slices[i].lo = n_cands * i / n_workers;
+		slices[i].hi = n_cands * (i + 1) / n_workers;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < n_workers; i++){
+		pthread_create(&threads[i], NULL, worker, (void *)(long)i);
+	}
+	for (i = 0; i < n_workers; i++){
+		pthread_join(threads[i], NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	fprintf(stderr, "%ld candidates x %d traces on %d threads in %.2f s\n",
+			n_cands, n_traces, n_workers,
+			(t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9);
+	printFront(traces[0].rate_hz);
+	return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * vmpu.c
+ *
+ *  Virtual MPU-6050. See vmpu.h.
+ */
+
+#include "vmpu.h"
+
+#include <mpu6050.h>
+
+#include <string.h>
+
+// Bus phases after a START.
+enum{
+	PH_IDLE,		// not addressed
+	PH_ADDRESS,		// next byte is the slave address
+	PH_POINTER,		// addressed for write, next byte is the register pointer
+	PH_WRITE,		// further bytes are register writes
+	PH_READ			// addressed for read
+};
+
+void vmpuInit(vmpu *m){
+	memset(m, 0, sizeof(*m));
+	vmpuPowerOn(m);
+}
+
+void vmpuPowerOn(vmpu *m){
+	memset(m->reg, 0, sizeof(m->reg));
+	m->reg[MPU6050_PWR_MGMT_1] = 0x40;		// power-on reset values
+	m->reg[MPU6050_WHO_AM_I] = MPU6050_I2C_ADDRESS;
+	m->ptr = 0;
+	m->phase = PH_IDLE;
+	m->int_line = 0;
+	m->int_until = 0;
+	m->int_at = 0;
+	m->fifo_head = 0;
+	m->fifo_count = 0;
+}
+
+static void raiseInt(vmpu *m, unsigned long long now){
+	m->int_line = 1;
+	m->int_until = (m->reg[MPU6050_INT_PIN_CFG] & MPU6050_LATCH_INT_EN)
+			? 0 : now + VMPU_INT_PULSE;
+}
+
+static void setWord(vmpu *m, int reg, int v){
+	m->reg[reg] = (v >> 8) & 0xFF;
+	m->reg[reg + 1] = v & 0xFF;
+}
+
+static void fifoPush(vmpu *m, int first, int n){
+	int i;
+
+	for (i = 0; i < n; i++){
+		if (m->fifo_count == VMPU_FIFO_SIZE){
+			m->fifo_head = (m->fifo_head + 1) % VMPU_FIFO_SIZE;		// oldest goes
+			m->fifo_count--;
+			m->fifo_lost++;
+			m->reg[MPU6050_INT_STATUS] |= MPU6050_FIFO_OFLOW_INT;
+		}
+		m->fifo[(m->fifo_head + m->fifo_count++) % VMPU_FIFO_SIZE] = m->reg[first + i];
+	}
+}
+
+void vmpuSample(vmpu *m, int x, int y, int z, int temp, unsigned long long now){
+	setWord(m, MPU6050_ACCEL_XOUT_H, x);
+	setWord(m, MPU6050_ACCEL_XOUT_H + 2, y);
+	setWord(m, MPU6050_ACCEL_XOUT_H + 4, z);
+	setWord(m, MPU6050_TEMP_OUT_H, temp);
+	m->samples++;
+	m->fresh = 0;
+	if (m->reg[MPU6050_USER_CTRL] & MPU6050_FIFO_EN){
+		if (m->reg[MPU6050_FIFO_ENABLE] & MPU6050_ACCEL_FIFO_EN){
+			fifoPush(m, MPU6050_ACCEL_XOUT_H, 6);
+		}
+		if (m->reg[MPU6050_FIFO_ENABLE] & MPU6050_TEMP_FIFO_EN){
+			fifoPush(m, MPU6050_TEMP_OUT_H, 2);
+		}
+	}
+
+	if (m->reg[MPU6050_INT_STATUS] & MPU6050_DATA_RDY_INT){
+		m->overruns++;
+	}
+	m->reg[MPU6050_INT_STATUS] |= MPU6050_DATA_RDY_INT;
+	if (m->reg[MPU6050_INT_ENABLE] & MPU6050_DATA_RDY_EN){
+		if (m->int_delay){
+			m->int_at = now + m->int_delay;
+		} else {
+			raiseInt(m, now);
+		}
+	}
+	m->int_delay = 0;
+}
+
+void vmpuTick(vmpu *m, unsigned long long now){
+	if (m->int_at && now >= m->int_at){
+		m->int_at = 0;
+		raiseInt(m, now);
+	}
+	if (m->int_line && m->int_until && now >= m->int_until){
+		m->int_line = 0;
+	}
+}
+
+void vmpuStart(vmpu *m){
+	m->phase = PH_ADDRESS;
+}
+
+int vmpuWrite(vmpu *m, unsigned char b){
+	switch (m->phase){
+	case PH_ADDRESS:
+		if ((b >> 1) != MPU6050_I2C_ADDRESS){
+			m->phase = PH_IDLE;
+			return 0;
+		}
+		m->phase = (b & 1) ? PH_READ : PH_POINTER;
+		return 1;
+	case PH_POINTER:
+		m->ptr = b & 0x7F;
+		m->phase = PH_WRITE;
+		return 1;
+	case PH_WRITE:
+		if (m->ptr != MPU6050_WHO_AM_I && m->ptr != MPU6050_INT_STATUS
+				&& (m->ptr < MPU6050_ACCEL_XOUT_H || m->ptr > MPU6050_TEMP_OUT_H + 1)){
+			m->reg[m->ptr] = b;
+		}
+		if (m->ptr == MPU6050_USER_CTRL && (b & MPU6050_FIFO_RESET)){
+			if (!(b & MPU6050_FIFO_EN)){
+				m->fifo_head = 0;
+				m->fifo_count = 0;
+			}
+			m->reg[MPU6050_USER_CTRL] &= ~MPU6050_FIFO_RESET;		// self-clearing
+		}
+		if (m->ptr != MPU6050_FIFO_R_W){
+			m->ptr = (m->ptr + 1) & 0x7F;
+		}
+		return 1;
+	}
+	return 0;
+}
+
+unsigned char vmpuRead(vmpu *m){
+	unsigned char b;
+
+	if (m->phase != PH_READ){
+		return 0xFF;		// nobody drives SDA
+	}
+	if (m->ptr == MPU6050_FIFO_R_W){
+		b = 0;
+		if (m->fifo_count){
+			b = m->fifo[m->fifo_head];
+			m->fifo_head = (m->fifo_head + 1) % VMPU_FIFO_SIZE;
+			m->fifo_count--;
+		}
+		m->reads++;
+		return b;		// the pointer stays on FIFO_R_W
+	}
+	if (m->ptr == MPU6050_FIFO_COUNTH){
+		setWord(m, MPU6050_FIFO_COUNTH, m->fifo_count);		// latched for COUNTL
+	}
+	b = m->reg[m->ptr];
+	if (m->ptr == MPU6050_INT_STATUS){
+		m->reg[MPU6050_INT_STATUS] = 0;
+		if (!m->int_until){
+			m->int_line = 0;	// latched until read
+		}
+	}
+	if (m->ptr >= MPU6050_ACCEL_XOUT_H && m->ptr <= MPU6050_ACCEL_XOUT_H + 7){
+		m->fresh |= 1 << (m->ptr - MPU6050_ACCEL_XOUT_H);
+	}
+	m->ptr = (m->ptr + 1) & 0x7F;
+	m->reads++;
+	return b;
+}
+
+void vmpuSpoil(vmpu *m){
+	int last = (m->ptr - 1) & 0x7F;
+
+	if (last >= MPU6050_ACCEL_XOUT_H && last <= MPU6050_ACCEL_XOUT_H + 7){
+		m->fresh &= ~(1 << (last - MPU6050_ACCEL_XOUT_H));
+	}
+}
+
+void vmpuStop(vmpu *m){
+	m->phase = PH_IDLE;
+}
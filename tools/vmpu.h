@@ -0,0 +1,64 @@
+/*
+ * vmpu.h
+ *
+ *  Virtual MPU-6050 for the simulator tools.
+ *
+ *  An I2C slave at MPU6050_I2C_ADDRESS with the register file from
+ *  mpu6050.h: register pointer with auto-increment, writes into the
+ *  register file, and the data ready interrupt (INT pin, latched or
+ *  50 us pulse per INT_PIN_CFG, cleared by reading INT_STATUS), and
+ *  the FIFO: with USER_CTRL FIFO_EN and FIFO_EN ACCEL (and TEMP) each
+ *  sample goes in as the sensor orders it, FIFO_COUNT is latched by
+ *  reading FIFO_COUNTH, FIFO_R_W pops without moving the register
+ *  pointer, FIFO_RESET (with FIFO_EN off) empties it, and an overflow
+ *  drops the oldest bytes and sets FIFO_OFLOW_INT.
+ *  Samples are pushed in by the tool with vmpuSample(); nothing is
+ *  measured or filtered. 'fresh' records which data bytes of the
+ *  current sample the master has read from the data registers, so a
+ *  tool can tell whether a sample made it through (not for FIFO reads).
+ *
+ *  The I2C side works on whole bytes: the bus master model (g2231.c)
+ *  turns START/STOP conditions and shifted bytes into the calls below.
+ */
+
+#ifndef VMPU_H_
+#define VMPU_H_
+
+#define VMPU_INT_PULSE 50	// cycles at 1 MHz the INT pin stays high when not latched
+#define VMPU_FIFO_SIZE 1024
+
+typedef struct vmpu_struct{
+	unsigned char reg[128];
+	unsigned char ptr;				// register pointer
+	int phase;						// see vmpu.c
+	int int_line;					// INT pin level
+	unsigned long long int_until;	// end of a non-latched pulse
+	unsigned long long int_at;		// INT still to be raised at this cycle, 0 if none
+	long int_delay;					// raise INT this long after the next vmpuSample()
+	unsigned char fresh;			// bit n: ACCEL_XOUT_H + n read intact since the last sample
+	unsigned char fifo[VMPU_FIFO_SIZE];
+	int fifo_head, fifo_count;		// oldest byte, bytes in the FIFO
+
+	long samples;					// vmpuSample() calls
+	long overruns;					// samples that replaced unread data
+	long reads;						// data bytes read by the master
+	long fifo_lost;					// bytes dropped on FIFO overflow
+} vmpu;
+
+void vmpuInit(vmpu *m);
+// Register file back to its power-on values, counters kept.
+void vmpuPowerOn(vmpu *m);
+// New sample (raw counts) at time now; raises data ready.
+void vmpuSample(vmpu *m, int x, int y, int z, int temp, unsigned long long now);
+// Raises a delayed INT, drops a non-latched INT pulse once it is over.
+void vmpuTick(vmpu *m, unsigned long long now);
+
+// I2C, byte level. vmpuWrite() returns 1 for ACK, 0 for NACK.
+void vmpuStart(vmpu *m);
+int vmpuWrite(vmpu *m, unsigned char b);
+unsigned char vmpuRead(vmpu *m);
+void vmpuStop(vmpu *m);
+// The byte just read did not reach the master intact (fault injection).
+void vmpuSpoil(vmpu *m);
+
+#endif /* VMPU_H_ */